@@ -0,0 +1,361 @@
+/*
+ * Measures keystroke-to-present latency of both PresentModes. It runs the
+ * loop of `Application::exec` and the frame pacing of `Terminal` on a
+ * HeadlessWindow through FrameRequests, typing into a LinuxPseudoTerminal
+ * whose child echoes every key.
+ *
+ *   present_latency [--keys <count>] [--refresh <hz>] [--max-fps <count>]
+ *                   [--frame-cost-us <time>]
+ *
+ * Building a frame is stood in for by spinning `--frame-cost-us`. VSync
+ * presents block until the next vblank of a `--refresh` display, which is
+ * when the frame counts as shown. LowLatency presents return at once.
+ * Scan-out and the display's own delay come on top in both modes.
+ */
+#include "im_app/frame_requests.h"
+#include "platforms/headless/headless_window.h"
+#include "platforms/linux/linux_child_reaper.h"
+#include "platforms/linux/linux_pty.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Marks the child, which echoes its input with the tty in raw mode
+constexpr const char* g_child_env = "PRESENT_LATENCY_CHILD";
+// Sent by the child once its tty is raw
+constexpr char g_ready = '!';
+// Same as `g_frames_per_wakeup` in application.cpp
+constexpr int g_frames_per_wakeup = 2;
+// Same as `Terminal::g_echo_window` and `Terminal::g_echo_wait`
+constexpr auto g_echo_window = std::chrono::milliseconds(50);
+constexpr auto g_echo_wait = std::chrono::microseconds(2000);
+// Time between two keys, like fast typing
+constexpr auto g_min_key_interval = std::chrono::milliseconds(20);
+constexpr auto g_max_key_interval = std::chrono::milliseconds(60);
+
+enum class Mode : uint8_t {
+    VSync,
+    LowLatency,
+};
+
+struct BenchOptions {
+    size_t keys{500};             // --keys <count>
+    double refresh_rate{60};      // --refresh <hz>
+    uint32_t max_frame_rate{240}; // --max-fps <count>, 0 is uncapped
+    // --frame-cost-us <time>
+    std::chrono::microseconds frame_cost{500};
+};
+
+double to_ms(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+int run_echo_child() {
+    termios attributes;
+    tcgetattr(STDIN_FILENO, &attributes);
+    cfmakeraw(&attributes);
+    tcsetattr(STDIN_FILENO, TCSANOW, &attributes);
+    ::write(STDOUT_FILENO, &g_ready, 1);
+    char buffer[256];
+    ssize_t got;
+    while ((got = ::read(STDIN_FILENO, buffer, sizeof(buffer))) > 0) {
+        ::write(STDOUT_FILENO, buffer, static_cast<size_t>(got));
+    }
+    return EXIT_SUCCESS;
+}
+
+void spin_for(Clock::duration duration) {
+    auto end = Clock::now() + duration;
+    while (Clock::now() < end) {
+    }
+}
+
+// One run of `--keys` keystrokes in one mode.
+class LatencyRun {
+  public:
+    LatencyRun(Mode mode, const BenchOptions& options,
+               ImApp::PseudoTerminal& pty)
+        : m_mode(mode), m_options(options), m_pty(pty),
+          m_window({.title = "latency", .width = 800, .height = 600,
+                    .no_border = false}) {}
+
+    std::vector<Clock::duration> run() {
+        m_start = Clock::now();
+        m_next_frame_slot = m_start;
+        std::thread reader(&LatencyRun::_read_output, this);
+        std::thread typist(&LatencyRun::_type, this);
+        _main_loop();
+        typist.join();
+        m_should_stop = true;
+        m_pty.wake();
+        reader.join();
+        return m_samples;
+    }
+
+  private:
+    Mode m_mode;
+    const BenchOptions& m_options;
+    ImApp::PseudoTerminal& m_pty;
+    ImApp::HeadlessWindow m_window;
+    ImApp::FrameRequests m_requests;
+    Clock::time_point m_start;
+    std::atomic<bool> m_should_stop{false};
+    std::atomic<bool> m_typed_all{false};
+    std::vector<Clock::duration> m_samples;
+
+    // Key presses not yet picked up by a frame, like GLFW's event queue
+    std::mutex m_input_mutex;
+    std::deque<Clock::time_point> m_key_presses;
+
+    // Snapshots `Terminal`'s parser publishes, one per read here
+    std::mutex m_output_mutex;
+    std::condition_variable m_output_published;
+    uint64_t m_sequence{0};
+    std::atomic<int64_t> m_last_key_time{0};
+    std::atomic<bool> m_urgent_frame_requested{false};
+
+    // `Terminal::EchoProbe`
+    Clock::time_point m_key_time;
+    uint64_t m_key_sequence{0};
+    bool m_awaiting{false};
+    Clock::time_point m_next_frame_slot;
+
+    void _type() {
+        uint32_t seed = 1;
+        std::chrono::microseconds span =
+            g_max_key_interval - g_min_key_interval;
+        for (size_t i = 0; i < m_options.keys; i++) {
+            seed = seed * 1103515245 + 12345;
+            std::this_thread::sleep_for(g_min_key_interval +
+                                        span * (seed >> 16) / 65536);
+            {
+                std::lock_guard<std::mutex> lock(m_input_mutex);
+                m_key_presses.push_back(Clock::now());
+            }
+            m_window.post_empty_event();
+        }
+        m_typed_all = true;
+        m_window.post_empty_event();
+    }
+
+    bool _has_input() {
+        std::lock_guard<std::mutex> lock(m_input_mutex);
+        return !m_key_presses.empty();
+    }
+
+    // `Terminal::_read_output` and `_parse_output` in one.
+    void _read_output() {
+        char buffer[4096];
+        while (!m_should_stop) {
+            if (!m_pty.wait_readable(-1)) {
+                if (!m_pty.is_valid()) {
+                    break;
+                }
+                continue;
+            }
+            size_t total = 0, got;
+            while ((got = m_pty.read(buffer, sizeof(buffer))) > 0) {
+                total += got;
+            }
+            if (total == 0) {
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_output_mutex);
+                m_sequence++;
+            }
+            m_output_published.notify_all();
+            auto now = Clock::now();
+            auto key_time = Clock::time_point(
+                Clock::duration(m_last_key_time.load()));
+            if (m_mode == Mode::LowLatency && now - key_time < g_echo_window) {
+                m_urgent_frame_requested = true;
+            }
+            if (m_requests.request()) {
+                m_window.post_empty_event();
+            }
+        }
+    }
+
+    // `Application::_wait_for_frame_slot`
+    void _wait_for_frame_slot() {
+        while (!m_urgent_frame_requested.exchange(false)) {
+            auto remaining = m_next_frame_slot - Clock::now();
+            if (remaining <= Clock::duration::zero()) {
+                break;
+            }
+            m_window.wait_events(
+                std::chrono::duration<double>(remaining).count());
+        }
+        m_next_frame_slot = Clock::now();
+        if (m_options.max_frame_rate > 0) {
+            m_next_frame_slot +=
+                std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(
+                        1.0 / m_options.max_frame_rate));
+        }
+    }
+
+    // Blocks until the next vblank after now, like a VSync swap.
+    void _wait_for_vblank() {
+        auto period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / m_options.refresh_rate));
+        auto since_start = Clock::now() - m_start;
+        std::this_thread::sleep_until(m_start +
+                                      (since_start / period + 1) * period);
+    }
+
+    // `Application::exec` with `Terminal::render` as its only layer.
+    void _main_loop() {
+        int pending_frames = g_frames_per_wakeup;
+        // Keys typed before an earlier one was echoed share its sample.
+        while (!m_typed_all || m_awaiting || _has_input()) {
+            if (pending_frames == 0) {
+                bool input = m_requests.wait(
+                    [this](double timeout_seconds) {
+                        m_window.wait_events(timeout_seconds);
+                    },
+                    [this]() { return _has_input(); });
+                pending_frames = input ? g_frames_per_wakeup : 1;
+            }
+            pending_frames--;
+            if (m_mode == Mode::LowLatency) {
+                _wait_for_frame_slot();
+            }
+            bool sent = _handle_keys();
+            std::unique_lock<std::mutex> lock(m_output_mutex);
+            if (sent && m_mode == Mode::LowLatency) {
+                // `Terminal::_wait_for_echo`
+                m_output_published.wait_for(lock, g_echo_wait, [this]() {
+                    return m_sequence > m_key_sequence;
+                });
+            }
+            bool drawn = m_awaiting && m_sequence > m_key_sequence;
+            lock.unlock();
+            spin_for(m_options.frame_cost);
+            if (m_mode == Mode::VSync) {
+                _wait_for_vblank();
+            }
+            if (drawn) {
+                m_awaiting = false;
+                m_samples.push_back(Clock::now() - m_key_time);
+            }
+        }
+    }
+
+    // `Terminal::_handle_keyboard_input`, true if keys were sent
+    bool _handle_keys() {
+        std::deque<Clock::time_point> presses;
+        {
+            std::lock_guard<std::mutex> lock(m_input_mutex);
+            presses.swap(m_key_presses);
+        }
+        if (presses.empty()) {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_output_mutex);
+            m_last_key_time = Clock::now().time_since_epoch().count();
+            if (!m_awaiting) {
+                // From the press, which is what the user perceives
+                m_key_time = presses.front();
+                m_key_sequence = m_sequence;
+                m_awaiting = true;
+            }
+        }
+        std::string keys(presses.size(), 'x');
+        m_pty.write(keys.data(), keys.size());
+        return true;
+    }
+};
+
+BenchOptions parse_options(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--keys" && i + 1 < argc) {
+            options.keys = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--refresh" && i + 1 < argc) {
+            options.refresh_rate = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--max-fps" && i + 1 < argc) {
+            options.max_frame_rate = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--frame-cost-us" && i + 1 < argc) {
+            options.frame_cost = std::chrono::microseconds(
+                std::strtoull(argv[++i], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "Ignoring unknown argument '%s'.\n", argv[i]);
+        }
+    }
+    return options;
+}
+
+bool run_mode(Mode mode, const char* name, const BenchOptions& options) {
+    ImApp::LinuxPseudoTerminal pty;
+    if (!pty.launch(24, 80)) {
+        return false;
+    }
+    char byte = 0;
+    while (byte != g_ready) {
+        while (pty.read(&byte, 1) == 0) {
+            if (!pty.wait_readable(-1) && !pty.is_valid()) {
+                return false;
+            }
+        }
+    }
+    LatencyRun run(mode, options, pty);
+    auto samples = run.run();
+    if (samples.empty()) {
+        return false;
+    }
+    std::ranges::sort(samples);
+    std::printf("%-12s key to present p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+                name, to_ms(samples[samples.size() / 2]),
+                to_ms(samples[samples.size() * 99 / 100]),
+                to_ms(samples.back()));
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    if (std::getenv(g_child_env)) {
+        return run_echo_child();
+    }
+    ImApp::ChildReaper::block_child_signal();
+    auto options = parse_options(argc, argv);
+
+    char self[4096];
+    ssize_t self_size = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (self_size <= 0) {
+        std::perror("present_latency: readlink");
+        return EXIT_FAILURE;
+    }
+    self[self_size] = '\0';
+    setenv("SHELL", self, 1);
+    setenv(g_child_env, "1", 1);
+
+    std::printf("%zu keys, %.0f Hz display, %u frames/s cap, %.2f ms per "
+                "frame\n",
+                options.keys, options.refresh_rate, options.max_frame_rate,
+                to_ms(options.frame_cost));
+    if (!run_mode(Mode::VSync, "vsync", options) ||
+        !run_mode(Mode::LowLatency, "low latency", options)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,482 @@
+/*
+ * Measures PTY output throughput and keystroke echo latency of
+ * LinuxPseudoTerminal, read the way `Terminal::_read_output` does, against
+ * a plain blocking `::read` loop on a master of its own, and against the
+ * reader `Terminal` had before, which slept 1 ms after every read. Last,
+ * it times launch to first output, posix_spawn against fork and exec,
+ * with `--heap-mb` of touched memory standing in for the GUI's.
+ *
+ *   pty_bench [--mb <size>] [--sleep-mb <size>] [--echoes <count>]
+ *             [--spawns <count>] [--heap-mb <size>]
+ *
+ * The child on the other end is this executable again. It either floods
+ * its output or echoes its input, with the tty in raw mode. Which
+ * LinuxPseudoTerminal backend runs depends on IM_APP_IO_URING.
+ */
+#include "platforms/linux/linux_child_reaper.h"
+#include "platforms/linux/linux_pty.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// What the child does, `flood:<bytes>` or `echo`
+constexpr const char* g_child_env = "PTY_BENCH_CHILD";
+// `Terminal` reads into ByteRing slots of this size
+constexpr size_t g_read_size = 4096;
+constexpr size_t g_flood_chunk = 64 * 1024;
+// Sent by the echoing child once its tty is raw
+constexpr char g_ready = '!';
+// What the old `Terminal::_read_output` slept after every read
+constexpr auto g_sleep_loop_delay = std::chrono::milliseconds(1);
+
+struct BenchOptions {
+    size_t megabytes{256};       // --mb <size>
+    size_t sleep_megabytes{8};   // --sleep-mb <size>, for the 1 ms loop
+    size_t echoes{2000};         // --echoes <count>
+    size_t spawns{200};          // --spawns <count>
+    size_t heap_megabytes{1024}; // --heap-mb <size>
+};
+
+struct Throughput {
+    size_t bytes{0};
+    size_t wakeups{0}; // blocking reads or `wait_readable` returns
+    Clock::duration elapsed{};
+    double cpu_ms{0}; // of the reading thread
+};
+
+double to_ms(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+double thread_cpu_ms() {
+    rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    auto ms = [](const timeval& time) {
+        return time.tv_sec * 1000.0 + time.tv_usec / 1000.0;
+    };
+    return ms(usage.ru_utime) + ms(usage.ru_stime);
+}
+
+void make_raw(int fd) {
+    termios attributes;
+    tcgetattr(fd, &attributes);
+    cfmakeraw(&attributes);
+    tcsetattr(fd, TCSANOW, &attributes);
+}
+
+int run_child(std::string_view mode) {
+    make_raw(STDIN_FILENO);
+    if (mode.starts_with("flood:")) {
+        size_t left = std::strtoull(mode.data() + 6, nullptr, 10);
+        std::vector<char> chunk(g_flood_chunk);
+        for (size_t i = 0; i < chunk.size(); i++) {
+            chunk[i] = static_cast<char>(' ' + i % 95);
+        }
+        while (left > 0) {
+            ssize_t written = ::write(STDOUT_FILENO, chunk.data(),
+                                      std::min(left, chunk.size()));
+            if (written <= 0) {
+                return EXIT_FAILURE;
+            }
+            left -= static_cast<size_t>(written);
+        }
+        return EXIT_SUCCESS;
+    }
+    // Input sent before the tty was raw would come back twice.
+    ::write(STDOUT_FILENO, &g_ready, 1);
+    char buffer[256];
+    ssize_t got;
+    while ((got = ::read(STDIN_FILENO, buffer, sizeof(buffer))) > 0) {
+        ::write(STDOUT_FILENO, buffer, static_cast<size_t>(got));
+    }
+    return EXIT_SUCCESS;
+}
+
+// A blocking master with the child on its slave, the baseline.
+struct RawPty {
+    int master{-1};
+    pid_t pid{-1};
+
+    bool spawn(const char* self) {
+        master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+        if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+            return false;
+        }
+        std::string slave_name = ptsname(master);
+        pid = fork();
+        if (pid == 0) {
+            setsid();
+            int slave = open(slave_name.c_str(), O_RDWR);
+            ioctl(slave, TIOCSCTTY, 0);
+            dup2(slave, STDIN_FILENO);
+            dup2(slave, STDOUT_FILENO);
+            dup2(slave, STDERR_FILENO);
+            close(slave);
+            execl(self, self, nullptr);
+            _exit(EXIT_FAILURE);
+        }
+        return pid > 0;
+    }
+
+    ~RawPty() {
+        if (master >= 0) {
+            close(master);
+        }
+        if (pid > 0) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+    }
+};
+
+Throughput read_blocking(RawPty& pty) {
+    Throughput result;
+    char buffer[g_read_size];
+    double cpu_start = thread_cpu_ms();
+    auto start = Clock::now();
+    ssize_t got;
+    while ((got = ::read(pty.master, buffer, sizeof(buffer))) > 0) {
+        result.bytes += static_cast<size_t>(got);
+        result.wakeups++;
+    }
+    result.elapsed = Clock::now() - start;
+    result.cpu_ms = thread_cpu_ms() - cpu_start;
+    return result;
+}
+
+// The old loop of `Terminal::_read_output`, one read into a 4096 byte
+// buffer and a 1 ms sleep per iteration.
+Throughput read_sleep_loop(RawPty& pty) {
+    Throughput result;
+    char buffer[g_read_size];
+    double cpu_start = thread_cpu_ms();
+    auto start = Clock::now();
+    ssize_t got;
+    while ((got = ::read(pty.master, buffer, sizeof(buffer) - 1)) > 0) {
+        result.bytes += static_cast<size_t>(got);
+        result.wakeups++;
+        std::this_thread::sleep_for(g_sleep_loop_delay);
+    }
+    result.elapsed = Clock::now() - start;
+    result.cpu_ms = thread_cpu_ms() - cpu_start;
+    return result;
+}
+
+// The loop of `Terminal::_read_output`, without the ring.
+Throughput read_pty(ImApp::PseudoTerminal& pty) {
+    Throughput result;
+    char buffer[g_read_size];
+    double cpu_start = thread_cpu_ms();
+    auto start = Clock::now();
+    while (true) {
+        if (!pty.wait_readable(-1)) {
+            if (!pty.is_valid()) {
+                break;
+            }
+            continue;
+        }
+        result.wakeups++;
+        size_t total = 0, got;
+        while ((got = pty.read(buffer, sizeof(buffer))) > 0) {
+            total += got;
+        }
+        if (total == 0) {
+            break;
+        }
+        result.bytes += total;
+    }
+    result.elapsed = Clock::now() - start;
+    result.cpu_ms = thread_cpu_ms() - cpu_start;
+    return result;
+}
+
+void report_throughput(const char* name, const Throughput& result) {
+    double seconds = to_ms(result.elapsed) / 1000.0;
+    std::printf("%-10s %8.0f MB/s %9zu wakeups %8.0f ms CPU %6.2f ms CPU/MB\n",
+                name, result.bytes / 1e6 / seconds, result.wakeups,
+                result.cpu_ms, result.cpu_ms / (result.bytes / 1e6));
+}
+
+void report_latency(const char* name, std::vector<Clock::duration>& samples,
+                    const char* what = "echo") {
+    std::sort(samples.begin(), samples.end());
+    std::printf("%-10s %s p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", name,
+                what,
+                to_ms(samples[samples.size() / 2]),
+                to_ms(samples[samples.size() * 99 / 100]),
+                to_ms(samples.back()));
+}
+
+std::vector<Clock::duration> echo_blocking(RawPty& pty, size_t count) {
+    std::vector<Clock::duration> samples;
+    char byte = 0;
+    while (byte != g_ready) {
+        if (::read(pty.master, &byte, 1) != 1) {
+            return samples;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        auto start = Clock::now();
+        if (::write(pty.master, &byte, 1) != 1 ||
+            ::read(pty.master, &byte, 1) != 1) {
+            break;
+        }
+        samples.push_back(Clock::now() - start);
+    }
+    return samples;
+}
+
+// Echoes with the old reader on a thread of its own, as `Terminal` ran it.
+// A key typed while the reader sleeps waits for the sleep to end.
+std::vector<Clock::duration> echo_sleep_loop(RawPty& pty, size_t count) {
+    std::mutex mutex;
+    std::condition_variable arrived;
+    size_t received = 0;
+    bool hung_up = false;
+    std::thread reader([&]() {
+        char buffer[g_read_size];
+        ssize_t got;
+        while ((got = ::read(pty.master, buffer, sizeof(buffer) - 1)) > 0) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                received += static_cast<size_t>(got);
+            }
+            arrived.notify_one();
+            std::this_thread::sleep_for(g_sleep_loop_delay);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        hung_up = true;
+        arrived.notify_one();
+    });
+    auto wait_for = [&](size_t bytes) {
+        std::unique_lock<std::mutex> lock(mutex);
+        arrived.wait(lock, [&]() { return received >= bytes || hung_up; });
+        return received >= bytes;
+    };
+
+    std::vector<Clock::duration> samples;
+    if (wait_for(1)) {
+        for (size_t i = 0; i < count; i++) {
+            auto start = Clock::now();
+            if (::write(pty.master, &g_ready, 1) != 1 || !wait_for(i + 2)) {
+                break;
+            }
+            samples.push_back(Clock::now() - start);
+        }
+    }
+    // Hanging up is the only way to get the reader out of its read.
+    kill(pty.pid, SIGKILL);
+    reader.join();
+    return samples;
+}
+
+std::vector<Clock::duration> echo_pty(ImApp::PseudoTerminal& pty,
+                                      size_t count) {
+    std::vector<Clock::duration> samples;
+    char byte = 0;
+    while (byte != g_ready) {
+        while (pty.read(&byte, 1) == 0) {
+            if (!pty.wait_readable(-1) && !pty.is_valid()) {
+                return samples;
+            }
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        auto start = Clock::now();
+        pty.write(&byte, 1);
+        while (pty.read(&byte, 1) == 0) {
+            if (!pty.wait_readable(-1) && !pty.is_valid()) {
+                return samples;
+            }
+        }
+        samples.push_back(Clock::now() - start);
+    }
+    return samples;
+}
+
+// Launch to the echoing child's first byte, with fork and exec.
+std::vector<Clock::duration> spawn_fork(const char* self, size_t count) {
+    std::vector<Clock::duration> samples;
+    for (size_t i = 0; i < count; i++) {
+        auto start = Clock::now();
+        RawPty raw;
+        char byte;
+        if (!raw.spawn(self) || ::read(raw.master, &byte, 1) != 1) {
+            break;
+        }
+        samples.push_back(Clock::now() - start);
+    }
+    return samples;
+}
+
+// Launch to the echoing child's first byte, with `LinuxPseudoTerminal`.
+std::vector<Clock::duration> spawn_pty(size_t count) {
+    std::vector<Clock::duration> samples;
+    for (size_t i = 0; i < count; i++) {
+        auto start = Clock::now();
+        ImApp::LinuxPseudoTerminal pty;
+        if (!pty.launch(24, 80)) {
+            break;
+        }
+        char byte;
+        while (pty.read(&byte, 1) == 0) {
+            if (!pty.wait_readable(-1) && !pty.is_valid()) {
+                return samples;
+            }
+        }
+        samples.push_back(Clock::now() - start);
+    }
+    return samples;
+}
+
+BenchOptions parse_options(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--mb" && i + 1 < argc) {
+            options.megabytes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--sleep-mb" && i + 1 < argc) {
+            options.sleep_megabytes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--echoes" && i + 1 < argc) {
+            options.echoes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--spawns" && i + 1 < argc) {
+            options.spawns = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--heap-mb" && i + 1 < argc) {
+            options.heap_megabytes = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "Ignoring unknown argument '%s'.\n", argv[i]);
+        }
+    }
+    return options;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    if (const char* mode = std::getenv(g_child_env)) {
+        return run_child(mode);
+    }
+    ImApp::ChildReaper::block_child_signal();
+    auto options = parse_options(argc, argv);
+
+    char self[4096];
+    ssize_t self_size = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (self_size <= 0) {
+        std::perror("pty_bench: readlink");
+        return EXIT_FAILURE;
+    }
+    self[self_size] = '\0';
+    setenv("SHELL", self, 1);
+
+#if defined(IM_APP_IO_URING)
+    const char* backend = "io_uring";
+#else
+    const char* backend = "poll";
+#endif
+    size_t flood_size = options.megabytes * 1000 * 1000;
+    std::printf("%zu MB of output (%zu MB for the 1 ms loop), %zu echoes, "
+                "LinuxPseudoTerminal on %s\n",
+                options.megabytes, options.sleep_megabytes, options.echoes,
+                backend);
+
+    std::string flood = "flood:" + std::to_string(flood_size);
+    setenv(g_child_env, flood.c_str(), 1);
+    {
+        RawPty raw;
+        if (!raw.spawn(self)) {
+            std::perror("pty_bench: spawn");
+            return EXIT_FAILURE;
+        }
+        report_throughput("::read", read_blocking(raw));
+    }
+    std::string sleep_flood =
+        "flood:" + std::to_string(options.sleep_megabytes * 1000 * 1000);
+    setenv(g_child_env, sleep_flood.c_str(), 1);
+    {
+        RawPty raw;
+        if (!raw.spawn(self)) {
+            std::perror("pty_bench: spawn");
+            return EXIT_FAILURE;
+        }
+        report_throughput("1 ms loop", read_sleep_loop(raw));
+    }
+    setenv(g_child_env, flood.c_str(), 1);
+    {
+        ImApp::LinuxPseudoTerminal pty;
+        if (!pty.launch(24, 80)) {
+            return EXIT_FAILURE;
+        }
+        report_throughput("pty", read_pty(pty));
+    }
+
+    setenv(g_child_env, "echo", 1);
+    {
+        RawPty raw;
+        if (!raw.spawn(self)) {
+            std::perror("pty_bench: spawn");
+            return EXIT_FAILURE;
+        }
+        auto samples = echo_blocking(raw, options.echoes);
+        if (samples.empty()) {
+            return EXIT_FAILURE;
+        }
+        report_latency("::read", samples);
+    }
+    {
+        RawPty raw;
+        if (!raw.spawn(self)) {
+            std::perror("pty_bench: spawn");
+            return EXIT_FAILURE;
+        }
+        auto samples = echo_sleep_loop(raw, options.echoes);
+        if (samples.empty()) {
+            return EXIT_FAILURE;
+        }
+        report_latency("1 ms loop", samples);
+    }
+    {
+        ImApp::LinuxPseudoTerminal pty;
+        if (!pty.launch(24, 80)) {
+            return EXIT_FAILURE;
+        }
+        auto samples = echo_pty(pty, options.echoes);
+        if (samples.empty()) {
+            return EXIT_FAILURE;
+        }
+        report_latency("pty", samples);
+    }
+
+    // Touched, so fork has page tables to copy like it has in the GUI.
+    std::vector<char> heap(options.heap_megabytes * 1000 * 1000, 1);
+    std::printf("%zu launches with %zu MB of heap\n", options.spawns,
+                options.heap_megabytes);
+    auto samples = spawn_fork(self, options.spawns);
+    if (samples.empty()) {
+        return EXIT_FAILURE;
+    }
+    report_latency("fork", samples, "first output");
+    samples = spawn_pty(options.spawns);
+    if (samples.empty()) {
+        return EXIT_FAILURE;
+    }
+    report_latency("pty", samples, "first output");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,178 @@
+/*
+ * Records a scripted session in the format of `im_neovim --record`, without
+ * a window, so the replays for `--replay` and im_neovim_bench can be made
+ * the same way on any box.
+ *
+ *   record_session --out <file> [--rows <count>] [--cols <count>]
+ *                  [--settle-ms <time>] <keys>...
+ *
+ * It launches $SHELL on a LinuxPseudoTerminal and types each <keys> in
+ * turn. The next one is typed once the output has been quiet for
+ * `--settle-ms`. `\r`, `\n`, `\e`, `\\` and `\xHH` are unescaped, so
+ *
+ *   record_session --out vim.rec 'vim file.cpp\r' '\x04' '\x04'
+ *
+ * opens a file and scrolls down twice.
+ */
+#include "im_neovim/logging.h"
+#include "im_neovim/session_recording.h"
+#include "platforms/linux/linux_child_reaper.h"
+#include "platforms/linux/linux_pty.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct RecordOptions {
+    std::filesystem::path path;            // --out <file>
+    uint16_t rows{50};                     // --rows <count>
+    uint16_t cols{200};                    // --cols <count>
+    std::chrono::milliseconds settle{500}; // --settle-ms <time>
+    std::vector<std::string> keys;
+};
+
+int hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+std::string unescape(std::string_view keys) {
+    std::string out;
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (keys[i] != '\\' || i + 1 == keys.size()) {
+            out += keys[i];
+            continue;
+        }
+        char c = keys[++i];
+        if (c == 'r') {
+            out += '\r';
+        } else if (c == 'n') {
+            out += '\n';
+        } else if (c == 'e') {
+            out += '\033';
+        } else if (c == 'x' && i + 2 < keys.size() &&
+                   hex_digit(keys[i + 1]) >= 0 &&
+                   hex_digit(keys[i + 2]) >= 0) {
+            out += static_cast<char>(hex_digit(keys[i + 1]) * 16 +
+                                     hex_digit(keys[i + 2]));
+            i += 2;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+bool parse_options(int argc, char** argv, RecordOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            options.path = argv[++i];
+        } else if (arg == "--rows" && i + 1 < argc) {
+            options.rows = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--cols" && i + 1 < argc) {
+            options.cols = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--settle-ms" && i + 1 < argc) {
+            options.settle = std::chrono::milliseconds(
+                std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            options.keys.push_back(unescape(arg));
+        }
+    }
+    return !options.path.empty() && options.rows > 0 && options.cols > 0;
+}
+
+// `Terminal::_read_output`, recording instead of parsing.
+void record_output(ImApp::PseudoTerminal& pty,
+                   ImNeovim::SessionRecorder& recorder,
+                   std::atomic<int64_t>& last_output,
+                   const std::atomic<bool>& should_stop) {
+    char buffer[4096];
+    while (!should_stop) {
+        if (!pty.wait_readable(-1)) {
+            if (!pty.is_valid()) {
+                break;
+            }
+            continue;
+        }
+        size_t got, total = 0;
+        while ((got = pty.read(buffer, sizeof(buffer))) > 0) {
+            recorder.record(buffer, got);
+            total += got;
+        }
+        if (total == 0) {
+            break; // Hung up
+        }
+        last_output = Clock::now().time_since_epoch().count();
+    }
+}
+
+void wait_until_quiet(const std::atomic<int64_t>& last_output,
+                      std::chrono::milliseconds settle) {
+    while (true) {
+        auto last = Clock::time_point(Clock::duration(last_output.load()));
+        auto remaining = last + settle - Clock::now();
+        if (remaining <= Clock::duration::zero()) {
+            return;
+        }
+        std::this_thread::sleep_for(remaining);
+    }
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    spdlog::stdout_color_mt(IM_NVIM_LOGGER_NAME);
+    RecordOptions options;
+    if (!parse_options(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "usage: record_session --out <file> [--rows <count>] "
+                     "[--cols <count>] [--settle-ms <time>] <keys>...\n");
+        return EXIT_FAILURE;
+    }
+    ImApp::ChildReaper::block_child_signal();
+
+    ImNeovim::SessionRecorder recorder(options.path, options.rows,
+                                       options.cols);
+    ImApp::LinuxPseudoTerminal pty;
+    if (!recorder.is_open() || !pty.launch(options.rows, options.cols)) {
+        return EXIT_FAILURE;
+    }
+    std::atomic<int64_t> last_output{Clock::now().time_since_epoch().count()};
+    std::atomic<bool> should_stop{false};
+    std::thread reader(record_output, std::ref(pty), std::ref(recorder),
+                       std::ref(last_output), std::cref(should_stop));
+
+    wait_until_quiet(last_output, options.settle);
+    for (const auto& keys : options.keys) {
+        // Quiet is counted from the keys, not from the last output.
+        last_output = Clock::now().time_since_epoch().count();
+        pty.write(keys.data(), keys.size());
+        wait_until_quiet(last_output, options.settle);
+    }
+    should_stop = true;
+    pty.wake();
+    reader.join();
+    pty.terminate();
+    std::printf("Recorded %zu bytes at %ux%u to '%s'.\n",
+                recorder.recorded_size(), options.cols, options.rows,
+                options.path.string().c_str());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+/*
+ * Replays a byte stream through Terminal on the headless backend and
+ * reports parse throughput (`_write_to_buffer`) in MB/s and render
+ * throughput (`_render_buffer`) in frames/s.
+ *
+ *   im_neovim_bench [--mb <size>] [--chunk <bytes>] [--replay <file>]
+ *
+ * Without `--replay` it generates colored `ls`/compiler-like output, the
+ * same for every run.
+ */
+#include "im_neovim/gui/terminal.h"
+#include "im_neovim/logging.h"
+#include "im_neovim/session_recording.h"
+#include <algorithm>
+#include <cstdlib>
+#include <im_app/application.h>
+#include <im_app/layer.h>
+#include <im_app/memory_pty.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <string_view>
+
+namespace ImNeovim {
+struct BenchOptions {
+    size_t megabytes{64};              // --mb <size>
+    size_t chunk_size{4096};           // --chunk <bytes>, one PTY read each
+    std::filesystem::path replay_path; // --replay <file>
+};
+
+static std::string generate_output(size_t size) {
+    static constexpr std::string_view g_words[] = {
+        "main.cpp", "terminal.cpp", "warning:", "error:", "note:",
+        "unused",   "variable",     "─│┌┐",     "include", "日本語",
+    };
+    static constexpr int g_colors[] = {31, 32, 33, 34, 35, 36, 90, 1};
+    std::string output;
+    output.reserve(size + 256);
+    uint32_t seed = 1;
+    auto next = [&seed]() {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 16;
+    };
+    while (output.size() < size) {
+        int words = 4 + next() % 12;
+        for (int i = 0; i < words; i++) {
+            if (next() % 3 == 0) {
+                output += "\033[";
+                output += std::to_string(g_colors[next() % 8]);
+                output += 'm';
+                output += g_words[next() % 10];
+                output += "\033[0m ";
+            } else {
+                output += g_words[next() % 10];
+                output += ' ';
+            }
+        }
+        output += "\r\n";
+    }
+    return output;
+}
+
+class BenchLayer : public ImApp::Layer {
+  public:
+    explicit BenchLayer(const SessionReplay& replay)
+        : m_pty(replay.pty), m_terminal(replay.pty) {
+        // The window's size must not change what is measured.
+        m_terminal.set_fixed_size(replay.cols, replay.rows);
+        m_pty->set_resize_handler([this](uint16_t rows, uint16_t cols) {
+            m_terminal.set_fixed_size(cols, rows);
+        });
+    }
+
+    void on_imgui_render() override {
+        if (m_done) {
+            return;
+        }
+        if (m_frames == 0) {
+            m_start = std::chrono::steady_clock::now();
+        }
+        m_terminal.render();
+        m_frames++;
+        auto stats = m_terminal.throughput_stats();
+        if (stats.parsed_bytes < m_pty->total_size()) {
+            return;
+        }
+        using Seconds = std::chrono::duration<double>;
+        double wall = Seconds(std::chrono::steady_clock::now() - m_start)
+                          .count();
+        double parse = Seconds(stats.parse_time).count();
+        double render = Seconds(stats.render_time).count();
+        double megabytes = stats.parsed_bytes / (1024.0 * 1024.0);
+        LOG_INFO("Parsed {:.1f} MB: {:.1f} MB/s of parse time, {:.1f} MB/s "
+                 "wall clock.",
+                 megabytes, megabytes / parse, megabytes / wall);
+        LOG_INFO("Rendered {} frames: {:.0f} frames/s of render time, {:.0f} "
+                 "frames/s wall clock.",
+                 stats.rendered_frames, stats.rendered_frames / render,
+                 m_frames / wall);
+        m_done = true;
+        IM_APP.exit();
+    }
+
+    // Render as fast as possible until the stream is parsed.
+    bool needs_frame() const override { return true; }
+
+  private:
+    std::shared_ptr<ImApp::MemoryPseudoTerminal> m_pty;
+    Terminal m_terminal;
+    std::chrono::steady_clock::time_point m_start;
+    size_t m_frames{0};
+    bool m_done{false};
+};
+
+static BenchOptions parse_bench_options(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--mb" && i + 1 < argc) {
+            options.megabytes = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--chunk" && i + 1 < argc) {
+            options.chunk_size = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--replay" && i + 1 < argc) {
+            options.replay_path = argv[++i];
+        } else {
+            LOG_WARN("Ignoring unknown argument '{}'.", arg);
+        }
+    }
+    return options;
+}
+} // namespace ImNeovim
+
+namespace ImApp {
+Application* create_im_app(int argc, char** argv) {
+    spdlog::stdout_color_mt(IM_NVIM_LOGGER_NAME);
+    auto options = ImNeovim::parse_bench_options(argc, argv);
+    ImNeovim::SessionReplay replay{
+        .pty = nullptr,
+        .rows = ImNeovim::Terminal::g_default_rows,
+        .cols = ImNeovim::Terminal::g_default_cols,
+    };
+    if (!options.replay_path.empty()) {
+        auto recording = ImNeovim::open_session_replay(
+            options.replay_path, MemoryPseudoTerminal::Timing::FullSpeed);
+        if (!recording) {
+            std::exit(EXIT_FAILURE);
+        }
+        replay = std::move(*recording);
+    } else {
+        replay.pty = MemoryPseudoTerminal::from_bytes(
+            ImNeovim::generate_output(options.megabytes * 1024 * 1024),
+            std::max<size_t>(options.chunk_size, 1));
+    }
+    AppSpec app_spec{
+        .name = "ImNeovim bench",
+        .graphics_backend = Headless,
+    };
+    auto* app = new Application(app_spec);
+    app->push_layer(std::make_shared<ImNeovim::BenchLayer>(replay));
+    return app;
+}
+} // namespace ImApp
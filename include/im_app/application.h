@@ -1,6 +1,11 @@
 #pragma once
 
+#include "im_app/cell_grid_renderer.h"
+#include "im_app/frame_profiler.h"
+#include "im_app/frame_requests.h"
 #include "im_app/layer.h"
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -10,6 +15,27 @@ namespace ImApp {
 enum GraphicsBackend : uint8_t {
     PerformanceFirst,
     CompatibilityFirst,
+    // No window or GPU, frames are built but never drawn. For benchmarks
+    // and CI machines without a display.
+    Headless,
+};
+
+/*
+ * How frames are paced, trading keystroke-to-photon latency for power.
+ * The figures below are from a key press to presenting the frame showing
+ * its echo, measured with bench/present_latency at 60 Hz and a 0.5 ms
+ * frame. Scan-out and the display's own delay come on top.
+ */
+enum PresentMode : uint8_t {
+    // Waits for vertical sync. Input is sampled when a frame starts and the
+    // frame is shown at the vblank after it. The echo usually lands in the
+    // next frame, 1-3 refresh intervals (p50 25 ms, p99 49 ms).
+    VSync,
+    // No vertical sync, at most `max_frame_rate` frames per second. Input is
+    // polled right before a frame is built and output arriving shortly
+    // after a keystroke skips the cap, about one frame's cost (p50 0.7 ms,
+    // p99 under 5 ms), at the cost of tearing and more GPU time.
+    LowLatency,
 };
 
 struct AppSpec {
@@ -18,6 +44,8 @@ struct AppSpec {
     uint32_t main_window_height = 720;
     bool main_window_no_border = true;
     GraphicsBackend graphics_backend = PerformanceFirst;
+    PresentMode present_mode = VSync;
+    uint32_t max_frame_rate = 240; // LowLatency only, 0 is uncapped
 };
 
 class ImGuiRenderer;
@@ -34,6 +62,18 @@ class Application {
 
     int exec();
     void exit();
+    // Frames are only rendered after input, a request or a layer asking
+    // for one. Renders a frame after `delay`, or as soon as possible.
+    // Thread-safe.
+    void request_frame(std::chrono::steady_clock::duration delay = {});
+    // Requests a frame that also skips the LowLatency frame-rate cap, for
+    // output the user is waiting on such as a keystroke's echo.
+    void request_urgent_frame();
+
+    const AppSpec& get_app_spec() const { return m_app_spec; }
+    FrameProfiler& get_frame_profiler() { return m_frame_profiler; }
+    // Returns nullptr when the graphics backend has no cell grid renderer.
+    std::unique_ptr<CellGridRenderer> create_cell_grid_renderer();
 
     static Application& get() { return *_s_application; }
 
@@ -54,13 +94,24 @@ class Application {
     AppSpec m_app_spec;
     std::vector<std::shared_ptr<Layer>> m_layer_stack;
     bool m_is_running = false;
+    // Frames left to render before waiting for events again
+    int m_pending_frames = 0;
+    FrameRequests m_frame_requests;
+    std::atomic<bool> m_urgent_frame_requested{false};
+    // LowLatency: the earliest time the frame-rate cap allows a new frame
+    std::chrono::steady_clock::time_point m_next_frame_slot;
     std::shared_ptr<Window> m_window = nullptr;
     std::shared_ptr<GraphicsContext> m_graphics_context = nullptr;
     std::shared_ptr<ImGuiRenderer> m_imgui_renderer = nullptr;
+    FrameProfiler m_frame_profiler;
     static Application* _s_application;
 
     void _initialize();
     void _finalize();
+    // Returns true if the frame may be for input.
+    bool _wait_for_frame();
+    bool _has_pending_input() const;
+    void _wait_for_frame_slot();
 };
 
 extern Application* create_im_app(int argc, char** argv);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <imgui.h>
+
+namespace ImApp {
+/*
+ * Draws a grid of equally sized cells, such as a terminal screen, with one
+ * instanced draw call instead of quads in an ImGui draw list. The cells
+ * live on the GPU and only rows set since the last draw are uploaded.
+ * Created by `Application::create_cell_grid_renderer`, which returns
+ * nullptr for backends without one.
+ */
+class CellGridRenderer {
+  public:
+    enum CellFlags : uint32_t {
+        CellBackground = 1 << 0, // Fills the cell with `bg`
+        CellUnderline = 1 << 1,
+        CellWideRight = 1 << 2, // Right half of a glyph two cells wide
+    };
+
+    struct Cell {
+        uint32_t glyph{0}; // Index into the glyph table, 0 draws no glyph
+        ImU32 fg{0};
+        ImU32 bg{0};
+        uint32_t flags{0};
+    };
+
+    // Where a glyph is drawn, relative to the top left of its cell, and
+    // where it is in the font atlas.
+    struct Glyph {
+        ImVec2 p0;
+        ImVec2 p1;
+        ImVec2 uv0;
+        ImVec2 uv1;
+    };
+
+    CellGridRenderer() = default;
+    virtual ~CellGridRenderer() = default;
+    CellGridRenderer(const CellGridRenderer&) = delete;
+    CellGridRenderer& operator=(const CellGridRenderer&) = delete;
+
+    // Resizes the grid, all cells become empty.
+    virtual void resize(int cols, int rows) = 0;
+    // Copies `cols` cells into `row`, uploaded by the next draw.
+    virtual void set_row(int row, const Cell* cells) = 0;
+    // Index 0 is reserved for empty cells.
+    virtual void set_glyph(uint32_t index, const Glyph& glyph) = 0;
+    // Adds a callback to `draw_list` that draws the grid at `pos` with
+    // glyphs from `atlas`, clipped to the current clip rect.
+    virtual void draw(ImDrawList* draw_list, const ImVec2& pos,
+                      const ImVec2& cell_size, ImTextureRef atlas) = 0;
+};
+} // namespace ImApp
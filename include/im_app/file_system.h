@@ -1,10 +1,34 @@
 #pragma once
 
+#include <cstddef>
 #include <filesystem>
+#include <memory>
 
 namespace ImApp {
 struct FileSystem {
     static std::filesystem::path executable_path();
     static std::filesystem::path local_app_data_path();
 };
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+  public:
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    // Returns nullptr if the file can't be opened or mapped.
+    static std::shared_ptr<MappedFile> open(const std::filesystem::path& path);
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+  private:
+    MappedFile() = default;
+
+    const char* m_data{nullptr};
+    size_t m_size{0};
+};
 } // namespace ImApp
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "im_app/trace.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace ImApp {
+/*
+ * Times the stages of every frame `Application::exec` renders and keeps the
+ * last `g_capacity` frames in a ring buffer. Only the main thread may use it.
+ */
+class FrameProfiler {
+  public:
+    enum Stage : uint8_t {
+        StageEvents,      // Window::on_update
+        StageUpdate,      // Layer::on_update
+        StageNewFrame,    // ImGuiRenderer::new_frame
+        StageImGui,       // Layer::on_imgui_render
+        StageBuildDraw,   // ImGui::Render
+        StageRenderDraw,  // ImGuiRenderer::render
+        StageSwap,        // GraphicsContext::swap_buffers
+        StageFrame,       // All of the above
+        StageCount,
+    };
+
+    // Layers beyond this are only counted in the stage totals
+    static constexpr size_t g_max_layers = 8;
+    // Stages, then `on_update` and `on_imgui_render` of each layer
+    static constexpr size_t g_column_count = StageCount + 2 * g_max_layers;
+    static constexpr size_t g_capacity = 512;
+
+    // Adds the time until it is destroyed to a column of the current frame,
+    // and to the trace while tracing.
+    class ScopedTimer {
+      public:
+        ScopedTimer(FrameProfiler& profiler, size_t column)
+            : m_profiler(profiler), m_column(column),
+              m_start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+            auto end = std::chrono::steady_clock::now();
+            m_profiler._add(m_column, end - m_start);
+            if (Tracer::is_enabled() && m_column < g_column_count) {
+                Tracer::instance().record(column_name(m_column), m_start,
+                                          end);
+            }
+        }
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+      private:
+        FrameProfiler& m_profiler;
+        size_t m_column;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    struct Summary {
+        float p50_ms{0.0f};
+        float p99_ms{0.0f};
+        float max_ms{0.0f};
+    };
+
+    FrameProfiler();
+
+    void begin_frame();
+    void end_frame();
+    ScopedTimer time(Stage stage) { return {*this, stage}; }
+    ScopedTimer time_layer_update(size_t layer) {
+        return {*this, _layer_column(layer, 0)};
+    }
+    ScopedTimer time_layer_imgui(size_t layer) {
+        return {*this, _layer_column(layer, 1)};
+    }
+
+    size_t frame_count() const { return m_count; }
+    Summary summary(size_t column) const;
+    static const char* column_name(size_t column);
+    // Writes one line per recorded frame, oldest first, times in ms.
+    bool export_csv(const std::filesystem::path& path) const;
+
+    bool is_overlay_visible() const { return m_overlay_visible; }
+    void set_overlay_visible(bool visible) { m_overlay_visible = visible; }
+    // Draws the overlay window if it is visible, must be called between
+    // ImGui::NewFrame and ImGui::Render.
+    void render_overlay();
+
+  private:
+    using Frame = std::array<float, g_column_count>;
+
+    std::vector<Frame> m_frames;
+    size_t m_next{0};
+    size_t m_count{0};
+    Frame m_current{};
+    std::chrono::steady_clock::time_point m_frame_start;
+    size_t m_used_columns{StageCount};
+    bool m_overlay_visible{false};
+
+    void _add(size_t column, std::chrono::steady_clock::duration duration);
+    // Layers past `g_max_layers` are timed into a column nobody reads.
+    size_t _layer_column(size_t layer, size_t kind) {
+        if (layer >= g_max_layers) {
+            return g_column_count;
+        }
+        return StageCount + layer * 2 + kind;
+    }
+    // Values of `column` from the oldest frame to the newest
+    std::vector<float> _column_values(size_t column) const;
+};
+} // namespace ImApp
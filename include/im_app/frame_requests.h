@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ImApp {
+/*
+ * Frames requested from any thread for a main loop that sleeps in between.
+ * Only the earliest request is kept, and a delayed request only wakes the
+ * main thread when it would otherwise sleep past the requested time.
+ */
+class FrameRequests {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // Asks for a frame after `delay`. Returns true if the main thread sleeps
+    // past that and has to be woken up.
+    bool request(Clock::duration delay = {});
+
+    // Main thread. Sleeps in `wait_events(timeout_seconds)`, where a
+    // negative timeout waits forever, until a requested frame is due or
+    // something else woke it up. Wakeups that only moved the deadline up go
+    // back to sleep unless `has_input()` is true. Returns true if the frame
+    // may be for input rather than only for requests.
+    template <typename WaitEvents, typename HasInput>
+    bool wait(WaitEvents&& wait_events, HasInput&& has_input) {
+        while (!_take_due()) {
+            Clock::time_point next = _begin_wait();
+            Clock::time_point now = Clock::now();
+            if (next > now) {
+                wait_events(next == Clock::time_point::max()
+                                ? -1.0
+                                : std::chrono::duration<double>(next - now)
+                                      .count());
+            }
+            _end_wait();
+            bool due = _take_due();
+            bool shortened = m_wait_shortened.exchange(false);
+            bool input = has_input();
+            if (due || !shortened || input) {
+                return input || !due;
+            }
+        }
+        return false;
+    }
+
+  private:
+    static constexpr int64_t g_no_request = INT64_MAX;
+    static constexpr int64_t g_awake = INT64_MIN;
+    // Timed waits may return this much before their deadline
+    static constexpr std::chrono::milliseconds g_wait_slack{1};
+
+    // steady_clock ticks of the earliest request
+    std::atomic<int64_t> m_next{g_no_request};
+    // steady_clock ticks the main thread sleeps until
+    std::atomic<int64_t> m_sleep_until{g_awake};
+    // Set when the main thread is woken up only to sleep less long
+    std::atomic<bool> m_wait_shortened{false};
+
+    Clock::time_point _begin_wait();
+    void _end_wait();
+    // Drops the requests that are due, returns true if there were any.
+    bool _take_due();
+};
+} // namespace ImApp
@@ -9,5 +9,11 @@ class Layer {
     virtual void on_detach() {}
     virtual void on_update() {}
     virtual void on_imgui_render() {}
+    // Polled after every frame. Returning true renders another frame even
+    // without input, e.g. while an animation runs. Work that finishes on
+    // another thread should call `Application::request_frame` instead.
+    virtual bool needs_frame() const { return false; }
+    // Called once the frame was handed to the display.
+    virtual void on_frame_presented() {}
 };
 } // namespace ImApp
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "im_app/pty.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ImApp {
+/*
+ * PseudoTerminal that replays a prerecorded byte stream instead of running
+ * a child process, for reproducible parse and render measurements.
+ *
+ * Every `read` returns bytes from a single chunk, so chunk boundaries are
+ * preserved. Once the stream is exhausted the terminal reports a hangup
+ * the same way a real PTY does: readable, but `read` returns nothing.
+ */
+class MemoryPseudoTerminal : public PseudoTerminal {
+  public:
+    enum class Timing : uint8_t {
+        FullSpeed, // hand out chunks as fast as they are read
+        Recorded,  // hand out chunks at their timestamps
+    };
+
+    struct Chunk {
+        std::chrono::nanoseconds timestamp{0}; // since the stream started
+        std::string_view data;
+        // Size the terminal was resized to before `data`, 0 if it wasn't
+        uint16_t rows{0};
+        uint16_t cols{0};
+    };
+    // Called from `read` with a chunk's size before its data is handed out.
+    using ResizeHandler = std::function<void(uint16_t rows, uint16_t cols)>;
+
+    // `storage` keeps the memory behind the chunks alive.
+    MemoryPseudoTerminal(std::vector<Chunk> chunks,
+                         std::shared_ptr<const void> storage, Timing timing);
+    // Splits `bytes` into chunks of `chunk_size`, replayed at full speed.
+    static std::shared_ptr<MemoryPseudoTerminal> from_bytes(std::string bytes,
+                                                            size_t chunk_size);
+
+    virtual bool launch(uint16_t row, uint16_t col) override;
+    virtual void terminate() override;
+    virtual bool is_valid() override;
+    virtual size_t write(const void* buff, size_t size) override;
+    virtual size_t read(void* buff, size_t size) override;
+    virtual bool wait_readable(int timeout_ms) override;
+    virtual void wake() override;
+    virtual bool resize(uint16_t row, uint16_t col) override;
+
+    // Must be set before the first `read`.
+    void set_resize_handler(ResizeHandler handler) {
+        m_resize_handler = std::move(handler);
+    }
+
+    size_t total_size() const { return m_total_size; }
+    // Bytes the terminal sent back, e.g. keys and device replies.
+    size_t written_size() const { return m_written_size; }
+    bool is_finished() const { return m_finished; }
+
+  private:
+    std::vector<Chunk> m_chunks;
+    std::shared_ptr<const void> m_storage;
+    Timing m_timing;
+    size_t m_total_size{0};
+    ResizeHandler m_resize_handler;
+
+    // Replay position, only touched by the reading thread
+    size_t m_chunk_index{0};
+    size_t m_chunk_offset{0};
+    std::chrono::steady_clock::time_point m_start_time;
+
+    std::atomic<bool> m_launched{false};
+    std::atomic<bool> m_finished{false};
+    std::atomic<size_t> m_written_size{0};
+
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake_cv;
+    bool m_woken{false};
+
+    bool _is_next_chunk_due() const;
+    void _next_chunk();
+};
+} // namespace ImApp
@@ -11,8 +11,16 @@ class PseudoTerminal {
     virtual bool launch(uint16_t row, uint16_t col) = 0;
     virtual void terminate() = 0;
     virtual bool is_valid() = 0;
+    // Queues `size` bytes for the child without blocking and returns how
+    // many were accepted. Fewer than `size` means the queue is full and the
+    // rest should be retried later.
     virtual size_t write(const void* buff, size_t size) = 0;
     virtual size_t read(void* buff, size_t size) = 0;
+    // Blocks until `read` has data to return, `wake` is called from another
+    // thread or `timeout_ms` elapses (negative waits forever). Returns true
+    // only when the PTY is readable.
+    virtual bool wait_readable(int timeout_ms) = 0;
+    virtual void wake() = 0;
     virtual bool resize(uint16_t row, uint16_t col) = 0;
 
     static std::shared_ptr<PseudoTerminal> create();
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "im_app/pty.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace ImApp {
+/*
+ * Keeps `size` shells launched ahead of time, so taking a terminal from the
+ * pool skips opening the PTY and spawning the shell, and usually the
+ * shell's own startup as well.
+ *
+ * A background thread launches replacements whenever a PTY is taken, and
+ * drops idle shells that exited on their own. Idle PTYs are launched at the
+ * pool's geometry and resized when taken.
+ */
+class PseudoTerminalPool {
+  public:
+    // How long `acquire` waits for a shell that is still being launched
+    static constexpr std::chrono::seconds g_acquire_timeout{2};
+    // How often idle shells are checked for having exited
+    static constexpr std::chrono::seconds g_prune_period{1};
+
+    PseudoTerminalPool(size_t size, uint16_t row, uint16_t col);
+    ~PseudoTerminalPool();
+    PseudoTerminalPool(const PseudoTerminalPool&) = delete;
+    PseudoTerminalPool(PseudoTerminalPool&&) = delete;
+    PseudoTerminalPool& operator=(const PseudoTerminalPool&) = delete;
+    PseudoTerminalPool& operator=(PseudoTerminalPool&&) = delete;
+
+    // Returns a launched PTY of the given size. While the pool is refilling
+    // it waits up to `g_acquire_timeout` for one. An empty pool that can't
+    // refill hands out a PTY that is not launched yet.
+    std::shared_ptr<PseudoTerminal> acquire(uint16_t row, uint16_t col);
+
+    size_t size() const { return m_size; }
+    size_t idle_count();
+
+  private:
+    size_t m_size;
+    uint16_t m_row;
+    uint16_t m_col;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::shared_ptr<PseudoTerminal>> m_idle;
+    // True from construction until the refill thread stops. Set before the
+    // thread starts, so `acquire` never mistakes a pool that has not
+    // launched its first shell yet for an empty one.
+    bool m_refilling{false};
+    bool m_should_stop{false};
+    std::thread m_refill_thread;
+
+    void _refill();
+    void _prune_exited();
+};
+} // namespace ImApp
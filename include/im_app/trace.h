@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ImApp {
+/*
+ * Records timed spans into per-thread buffers and writes them as a Chrome
+ * trace, which chrome://tracing and ui.perfetto.dev can open. Recording takes
+ * no locks, and while tracing is off a span costs one relaxed load.
+ */
+class Tracer {
+  public:
+    // Spans per thread and trace, later ones are dropped
+    static constexpr size_t g_events_per_thread = 1 << 18;
+
+    static Tracer& instance();
+
+    // Starts a new trace, dropping the previous one.
+    void start();
+    // Stops recording and writes the trace to `path`.
+    bool stop(const std::filesystem::path& path);
+
+    static bool is_enabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+    // Names the calling thread in traces.
+    void set_thread_name(const char* name);
+    // `name` must outlive the trace, e.g. a string literal.
+    void record(const char* name, std::chrono::steady_clock::time_point begin,
+                std::chrono::steady_clock::time_point end);
+
+  private:
+    struct ThreadBuffer;
+
+    inline static std::atomic<bool> s_enabled{false};
+    // Buffers of all threads that ever recorded, kept after they exit
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> m_buffers;
+    // Bumped by `start`, buffers from an older trace are reset on use.
+    std::atomic<uint32_t> m_generation{0};
+    std::chrono::steady_clock::time_point m_start_time;
+
+    Tracer() = default;
+    ThreadBuffer& _thread_buffer();
+};
+
+// Records the time until the end of the scope as a span named `name`.
+class TraceScope {
+  public:
+    explicit TraceScope(const char* name)
+        : m_name(Tracer::is_enabled() ? name : nullptr) {
+        if (m_name) {
+            m_begin = std::chrono::steady_clock::now();
+        }
+    }
+    ~TraceScope() {
+        if (m_name) {
+            Tracer::instance().record(m_name, m_begin,
+                                      std::chrono::steady_clock::now());
+        }
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+  private:
+    const char* m_name;
+    std::chrono::steady_clock::time_point m_begin;
+};
+} // namespace ImApp
+
+#define IM_APP_TRACE_CONCAT_IMPL(a, b) a##b
+#define IM_APP_TRACE_CONCAT(a, b) IM_APP_TRACE_CONCAT_IMPL(a, b)
+#define IM_APP_TRACE_SCOPE(name)                                               \
+    ::ImApp::TraceScope IM_APP_TRACE_CONCAT(im_app_trace_scope_, __LINE__)(name)
@@ -2,6 +2,12 @@
 #include "im_app/graphics_context.h"
 #include "im_app/imgui_renderer.h"
 #include "im_app/window.h"
+#include "platforms/headless/headless_context.h"
+#include "platforms/headless/headless_imgui_renderer.h"
+#include "platforms/headless/headless_window.h"
+#include <algorithm>
+#include <imgui.h>
+#include <imgui_internal.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 #include <stdexcept>
@@ -9,6 +15,9 @@
 namespace ImApp {
 Application* Application::_s_application = nullptr;
 
+// ImGui needs a couple of frames to settle hover and click state after input.
+static constexpr int g_frames_per_wakeup = 2;
+
 static void initialize_spdlog();
 static void finalize_spdlog();
 
@@ -28,26 +37,128 @@ Application::~Application() {
 
 int Application::exec() {
     m_is_running = true;
+    Tracer::instance().set_thread_name("Main");
+    m_pending_frames = g_frames_per_wakeup;
     // Main loop
     while (m_is_running) {
+        if (m_pending_frames == 0) {
+            // Requested frames need no settling, input does.
+            m_pending_frames = _wait_for_frame() ? g_frames_per_wakeup : 1;
+        }
+        m_pending_frames--;
+        if (m_app_spec.present_mode == LowLatency) {
+            // Sleep before polling, so the frame uses the freshest input.
+            _wait_for_frame_slot();
+        }
+        m_frame_profiler.begin_frame();
         if (m_window) {
+            auto timer = m_frame_profiler.time(FrameProfiler::StageEvents);
             m_window->on_update();
         }
+        {
+            auto timer = m_frame_profiler.time(FrameProfiler::StageUpdate);
+            for (size_t i = 0; i < m_layer_stack.size(); i++) {
+                auto layer_timer = m_frame_profiler.time_layer_update(i);
+                m_layer_stack[i]->on_update();
+            }
+        }
+        {
+            auto timer = m_frame_profiler.time(FrameProfiler::StageNewFrame);
+            m_imgui_renderer->new_frame();
+        }
+        {
+            auto timer = m_frame_profiler.time(FrameProfiler::StageImGui);
+            for (size_t i = 0; i < m_layer_stack.size(); i++) {
+                auto layer_timer = m_frame_profiler.time_layer_imgui(i);
+                m_layer_stack[i]->on_imgui_render();
+            }
+        }
+        m_frame_profiler.render_overlay();
+        {
+            auto timer = m_frame_profiler.time(FrameProfiler::StageBuildDraw);
+            ImGui::Render();
+        }
+        {
+            auto timer =
+                m_frame_profiler.time(FrameProfiler::StageRenderDraw);
+            m_imgui_renderer->render(m_window);
+        }
+        {
+            auto timer = m_frame_profiler.time(FrameProfiler::StageSwap);
+            m_graphics_context->swap_buffers();
+        }
+        m_frame_profiler.end_frame();
         for (auto& layer : m_layer_stack) {
-            layer->on_update();
+            layer->on_frame_presented();
         }
-        m_imgui_renderer->new_frame();
         for (auto& layer : m_layer_stack) {
-            layer->on_imgui_render();
+            if (layer->needs_frame()) {
+                m_pending_frames = std::max(m_pending_frames, 1);
+            }
         }
-        m_imgui_renderer->render(m_window);
-        m_graphics_context->swap_buffers();
     }
     return 0;
 }
 
 void Application::exit() { m_is_running = false; }
 
+void Application::request_frame(std::chrono::steady_clock::duration delay) {
+    // The main thread checks for requests before it waits, so it only
+    // needs waking if it would sleep past the requested time.
+    if (m_frame_requests.request(delay) && m_window) {
+        m_window->post_empty_event();
+    }
+}
+
+void Application::request_urgent_frame() {
+    m_urgent_frame_requested = true;
+    request_frame();
+}
+
+void Application::_wait_for_frame_slot() {
+    while (!m_urgent_frame_requested.exchange(false)) {
+        auto remaining = m_next_frame_slot - std::chrono::steady_clock::now();
+        if (remaining <= std::chrono::steady_clock::duration::zero()) {
+            break;
+        }
+        // Events that arrive meanwhile are dispatched right away and reach
+        // ImGui with this frame.
+        m_window->wait_events(
+            std::chrono::duration<double>(remaining).count());
+    }
+    auto now = std::chrono::steady_clock::now();
+    m_next_frame_slot = now;
+    if (m_app_spec.max_frame_rate > 0) {
+        m_next_frame_slot += std::chrono::duration_cast<
+            std::chrono::steady_clock::duration>(std::chrono::duration<double>(
+            1.0 / m_app_spec.max_frame_rate));
+    }
+}
+
+bool Application::_wait_for_frame() {
+    uint32_t width = m_window->get_width();
+    uint32_t height = m_window->get_height();
+    return m_frame_requests.wait(
+        [this](double timeout_seconds) {
+            // Input, a request from another thread or the timeout wake us.
+            IM_APP_TRACE_SCOPE("Application::wait_for_frame");
+            m_window->wait_events(timeout_seconds);
+        },
+        [&]() {
+            return width != m_window->get_width() ||
+                   height != m_window->get_height() || _has_pending_input();
+        });
+}
+
+bool Application::_has_pending_input() const {
+    const ImGuiContext* context = ImGui::GetCurrentContext();
+    return context && context->InputEventsQueue.Size > 0;
+}
+
+std::unique_ptr<CellGridRenderer> Application::create_cell_grid_renderer() {
+    return m_imgui_renderer->create_cell_grid_renderer();
+}
+
 void Application::_initialize() {
     initialize_spdlog();
     WindowProps window_props = {m_app_spec.name, m_app_spec.main_window_width,
@@ -59,10 +170,17 @@ void Application::_initialize() {
         window_props.enable_dpi_awareness = false;
     }
 #endif
+    if (m_app_spec.graphics_backend == Headless) {
+        m_window = std::make_shared<HeadlessWindow>(window_props);
+        m_graphics_context = std::make_shared<HeadlessContext>();
+        m_imgui_renderer = std::make_shared<HeadlessImGuiRenderer>(m_window);
+        return;
+    }
     m_window = Window::create(window_props);
     m_graphics_context =
         GraphicsContext::create(m_window, m_app_spec.graphics_backend);
     m_graphics_context->initialize();
+    m_graphics_context->set_vsync(m_app_spec.present_mode == VSync);
     m_imgui_renderer =
         ImGuiRenderer::create(m_window, m_app_spec.graphics_backend);
 }
@@ -0,0 +1,158 @@
+#include "im_app/frame_profiler.h"
+#include <algorithm>
+#include <cfloat>
+#include <fstream>
+#include <imgui.h>
+#include <spdlog/spdlog.h>
+#include <string>
+
+namespace ImApp {
+static constexpr const char* g_stage_names[FrameProfiler::StageCount] = {
+    "events",     "update",      "new_frame", "imgui",
+    "build_draw", "render_draw", "swap",      "frame",
+};
+static constexpr int g_histogram_bins = 32;
+
+FrameProfiler::FrameProfiler() : m_frames(g_capacity) {}
+
+void FrameProfiler::begin_frame() {
+    m_current.fill(0.0f);
+    m_frame_start = std::chrono::steady_clock::now();
+}
+
+void FrameProfiler::end_frame() {
+    _add(StageFrame, std::chrono::steady_clock::now() - m_frame_start);
+    m_frames[m_next] = m_current;
+    m_next = (m_next + 1) % g_capacity;
+    m_count = std::min(m_count + 1, g_capacity);
+}
+
+void FrameProfiler::_add(size_t column,
+                         std::chrono::steady_clock::duration duration) {
+    if (column >= g_column_count) {
+        return;
+    }
+    m_current[column] +=
+        std::chrono::duration<float, std::milli>(duration).count();
+    m_used_columns = std::max(m_used_columns, column + 1);
+}
+
+std::vector<float> FrameProfiler::_column_values(size_t column) const {
+    std::vector<float> values;
+    values.reserve(m_count);
+    size_t first = (m_next + g_capacity - m_count) % g_capacity;
+    for (size_t i = 0; i < m_count; i++) {
+        values.push_back(m_frames[(first + i) % g_capacity][column]);
+    }
+    return values;
+}
+
+FrameProfiler::Summary FrameProfiler::summary(size_t column) const {
+    Summary summary;
+    if (m_count == 0 || column >= g_column_count) {
+        return summary;
+    }
+    auto values = _column_values(column);
+    std::sort(values.begin(), values.end());
+    summary.p50_ms = values[(values.size() - 1) / 2];
+    summary.p99_ms = values[(values.size() - 1) * 99 / 100];
+    summary.max_ms = values.back();
+    return summary;
+}
+
+const char* FrameProfiler::column_name(size_t column) {
+    if (column < StageCount) {
+        return g_stage_names[column];
+    }
+    static const auto s_layer_names = []() {
+        std::array<std::string, 2 * g_max_layers> names;
+        for (size_t i = 0; i < names.size(); i++) {
+            names[i] = "layer" + std::to_string(i / 2) +
+                       (i % 2 == 0 ? ".update" : ".imgui");
+        }
+        return names;
+    }();
+    if (column >= g_column_count) {
+        return "";
+    }
+    return s_layer_names[column - StageCount].c_str();
+}
+
+bool FrameProfiler::export_csv(const std::filesystem::path& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        spdlog::error("[FrameProfiler] Can't open '{}'.", path.string());
+        return false;
+    }
+    for (size_t column = 0; column < m_used_columns; column++) {
+        file << (column > 0 ? "," : "") << column_name(column);
+    }
+    file << '\n';
+    size_t first = (m_next + g_capacity - m_count) % g_capacity;
+    for (size_t i = 0; i < m_count; i++) {
+        const Frame& frame = m_frames[(first + i) % g_capacity];
+        for (size_t column = 0; column < m_used_columns; column++) {
+            file << (column > 0 ? "," : "") << frame[column];
+        }
+        file << '\n';
+    }
+    spdlog::info("[FrameProfiler] Wrote {} frames to '{}'.", m_count,
+                 path.string());
+    return static_cast<bool>(file);
+}
+
+void FrameProfiler::render_overlay() {
+    if (!m_overlay_visible) {
+        return;
+    }
+    ImGui::SetNextWindowSize(ImVec2(520.0f, 0.0f), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Frame Profiler", &m_overlay_visible)) {
+        ImGui::End();
+        return;
+    }
+    ImGui::Text("Last %zu frames, times in ms", m_count);
+    if (ImGui::BeginTable("stages", 5,
+                          ImGuiTableFlags_RowBg |
+                              ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("Stage");
+        ImGui::TableSetupColumn("p50");
+        ImGui::TableSetupColumn("p99");
+        ImGui::TableSetupColumn("max");
+        ImGui::TableSetupColumn("Histogram",
+                                ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableHeadersRow();
+        for (size_t column = 0; column < m_used_columns; column++) {
+            Summary stats = summary(column);
+            // Distribution of the column over [0, max]
+            std::array<float, g_histogram_bins> bins{};
+            if (stats.max_ms > 0.0f) {
+                for (float value : _column_values(column)) {
+                    int bin = static_cast<int>(value / stats.max_ms *
+                                               (g_histogram_bins - 1));
+                    bins[bin] += 1.0f;
+                }
+            }
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(column_name(column));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.p50_ms);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.p99_ms);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.max_ms);
+            ImGui::TableNextColumn();
+            ImGui::PushID(static_cast<int>(column));
+            ImGui::PlotHistogram("", bins.data(), g_histogram_bins, 0,
+                                 nullptr, 0.0f, FLT_MAX,
+                                 ImVec2(-FLT_MIN, ImGui::GetFrameHeight()));
+            ImGui::PopID();
+        }
+        ImGui::EndTable();
+    }
+    if (ImGui::Button("Export CSV")) {
+        export_csv(std::filesystem::current_path() / "frame_profile.csv");
+    }
+    ImGui::End();
+}
+} // namespace ImApp
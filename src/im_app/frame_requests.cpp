@@ -0,0 +1,49 @@
+#include "im_app/frame_requests.h"
+
+namespace ImApp {
+bool FrameRequests::request(Clock::duration delay) {
+    Clock::time_point time = Clock::now() + delay;
+    int64_t ticks = time.time_since_epoch().count();
+    int64_t next = m_next.load();
+    while (ticks < next && !m_next.compare_exchange_weak(next, ticks)) {
+    }
+    // Pairs with `_begin_wait`, which publishes its deadline before it reads
+    // `m_next`: one of the two always sees the other. A frame within the
+    // slack of the deadline is served by that wakeup.
+    int64_t sleep_until = m_sleep_until.load();
+    int64_t slack = Clock::duration(g_wait_slack).count();
+    if (sleep_until == g_awake || ticks >= sleep_until - slack) {
+        return false;
+    }
+    if (delay > Clock::duration::zero()) {
+        m_wait_shortened = true;
+    }
+    return true;
+}
+
+FrameRequests::Clock::time_point FrameRequests::_begin_wait() {
+    // Until the real deadline is known, every request wakes us up.
+    m_sleep_until = g_no_request;
+    int64_t next = m_next.load();
+    m_sleep_until = next;
+    if (next == g_no_request) {
+        return Clock::time_point::max();
+    }
+    return Clock::time_point(Clock::duration(next));
+}
+
+void FrameRequests::_end_wait() { m_sleep_until = g_awake; }
+
+bool FrameRequests::_take_due() {
+    Clock::time_point now = Clock::now() + g_wait_slack;
+    int64_t ticks = now.time_since_epoch().count();
+    int64_t next = m_next.load();
+    // A request made meanwhile is only ever earlier, so it is due as well.
+    while (next <= ticks) {
+        if (m_next.compare_exchange_weak(next, g_no_request)) {
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace ImApp
@@ -12,6 +12,8 @@ class GraphicsContext {
     virtual void initialize() = 0;
     virtual void finalize() = 0;
     virtual void swap_buffers() = 0;
+    // Vertical sync is on after `initialize`.
+    virtual void set_vsync(bool enabled) = 0;
     virtual void on_frame_buffer_size_changed(uint32_t width,
                                               uint32_t height) = 0;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "im_app/application.h"
+#include "im_app/cell_grid_renderer.h"
 #include <memory>
 
 namespace ImApp {
@@ -11,6 +12,9 @@ class ImGuiRenderer {
     virtual ~ImGuiRenderer() = default;
     virtual void new_frame() = 0;
     virtual void render(std::shared_ptr<Window>& window) = 0;
+    virtual std::unique_ptr<CellGridRenderer> create_cell_grid_renderer() {
+        return nullptr;
+    }
 
     static std::shared_ptr<ImGuiRenderer> create(std::shared_ptr<Window> window,
                                                  GraphicsBackend backend);
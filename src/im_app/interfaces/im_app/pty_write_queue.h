@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+namespace ImApp {
+/*
+ * Bounded FIFO of bytes on their way to a PTY.
+ *
+ * Any thread may `push`; a short return is the backpressure signal. A single
+ * writer thread hands the pending bytes to the device with `flush`, the copy
+ * happens without the lock held so pushing never waits on the device.
+ */
+class PtyWriteQueue {
+  public:
+    explicit PtyWriteQueue(size_t capacity);
+    PtyWriteQueue(const PtyWriteQueue&) = delete;
+    PtyWriteQueue(PtyWriteQueue&&) = delete;
+    PtyWriteQueue& operator=(const PtyWriteQueue&) = delete;
+    PtyWriteQueue& operator=(PtyWriteQueue&&) = delete;
+
+    // Copies as much of `data` as fits and returns the number of bytes taken.
+    size_t push(const void* data, size_t size);
+
+    // Pending bytes, split in two when they wrap around.
+    struct Pending {
+        const char* first;
+        size_t first_size;
+        const char* second;
+        size_t second_size;
+
+        size_t size() const { return first_size + second_size; }
+    };
+
+    // Only `push` runs concurrently and it never touches pending bytes, so
+    // they stay valid until dropped, e.g. for an asynchronous write.
+    Pending pending() const;
+    // Drops the first `size` pending bytes once they were written.
+    void drop(size_t size);
+
+    // Calls `sink(const char* first, size_t first_size, const char* second,
+    // size_t second_size)` with the pending bytes. `sink` returns how many
+    // bytes it wrote, which are dropped.
+    template <typename Sink> size_t flush(Sink&& sink) {
+        Pending bytes = pending();
+        if (bytes.size() == 0) {
+            return 0;
+        }
+        size_t written = sink(bytes.first, bytes.first_size, bytes.second,
+                              bytes.second_size);
+        drop(written);
+        return written;
+    }
+
+    // Blocks until bytes are pending. Returns false once closed.
+    bool wait_pending();
+    // Drops pending bytes and wakes `wait_pending` for shutdown.
+    void close();
+    // Drops pending bytes and reopens the queue for a new child.
+    void reset();
+
+    bool empty() const;
+    size_t size() const;
+    size_t capacity() const { return m_capacity; }
+    // Start of the storage all pending bytes live in, e.g. to register it
+    // with io_uring. It never moves.
+    const char* data() const { return m_data.get(); }
+
+  private:
+    std::unique_ptr<char[]> m_data;
+    size_t m_capacity;
+    size_t m_begin{0};
+    size_t m_size{0};
+    bool m_closed{false};
+    mutable std::mutex m_mutex;
+    std::condition_variable m_pending;
+};
+} // namespace ImApp
@@ -20,6 +20,11 @@ class Window {
   public:
     virtual ~Window() = default;
     virtual void on_update() = 0;
+    // Blocks until an event arrives, `post_empty_event` is called or
+    // `timeout_seconds` elapse. A negative timeout waits for an event.
+    virtual void wait_events(double timeout_seconds) = 0;
+    // Wakes `wait_events`, may be called from any thread.
+    virtual void post_empty_event() = 0;
     virtual void minimize() = 0;
     virtual void set_titlebar_hovered(bool hovered) = 0;
     virtual uint32_t get_width() const = 0;
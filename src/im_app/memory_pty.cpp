@@ -0,0 +1,126 @@
+#include "im_app/memory_pty.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ImApp {
+MemoryPseudoTerminal::MemoryPseudoTerminal(std::vector<Chunk> chunks,
+                                           std::shared_ptr<const void> storage,
+                                           Timing timing)
+    : m_chunks(std::move(chunks)), m_storage(std::move(storage)),
+      m_timing(timing) {
+    for (const auto& chunk : m_chunks) {
+        m_total_size += chunk.data.size();
+    }
+}
+
+std::shared_ptr<MemoryPseudoTerminal>
+MemoryPseudoTerminal::from_bytes(std::string bytes, size_t chunk_size) {
+    auto storage = std::make_shared<const std::string>(std::move(bytes));
+    std::string_view view = *storage;
+    std::vector<Chunk> chunks;
+    for (size_t offset = 0; offset < view.size(); offset += chunk_size) {
+        chunks.push_back({.data = view.substr(offset, chunk_size)});
+    }
+    return std::make_shared<MemoryPseudoTerminal>(
+        std::move(chunks), std::move(storage), Timing::FullSpeed);
+}
+
+bool MemoryPseudoTerminal::launch([[maybe_unused]] uint16_t row,
+                                  [[maybe_unused]] uint16_t col) {
+    m_chunk_index = 0;
+    m_chunk_offset = 0;
+    m_finished = false;
+    m_start_time = std::chrono::steady_clock::now();
+    m_launched = true;
+    return true;
+}
+
+void MemoryPseudoTerminal::terminate() {
+    m_launched = false;
+    wake();
+}
+
+bool MemoryPseudoTerminal::is_valid() { return m_launched; }
+
+size_t MemoryPseudoTerminal::write([[maybe_unused]] const void* buff,
+                                   size_t size) {
+    if (!m_launched) {
+        return 0;
+    }
+    m_written_size += size;
+    return size;
+}
+
+size_t MemoryPseudoTerminal::read(void* buff, size_t size) {
+    while (m_launched && _is_next_chunk_due()) {
+        const Chunk& chunk = m_chunks[m_chunk_index];
+        if (m_chunk_offset == 0 && chunk.rows != 0 && m_resize_handler) {
+            m_resize_handler(chunk.rows, chunk.cols);
+        }
+        if (chunk.data.empty()) {
+            _next_chunk(); // Only a resize
+            continue;
+        }
+        size_t count = std::min(size, chunk.data.size() - m_chunk_offset);
+        std::memcpy(buff, chunk.data.data() + m_chunk_offset, count);
+        m_chunk_offset += count;
+        if (m_chunk_offset == chunk.data.size()) {
+            _next_chunk();
+        }
+        return count;
+    }
+    return 0;
+}
+
+bool MemoryPseudoTerminal::wait_readable(int timeout_ms) {
+    if (!m_launched) {
+        return false;
+    }
+    // An exhausted stream reads like a hangup.
+    if (m_chunk_index == m_chunks.size() || _is_next_chunk_due()) {
+        return true;
+    }
+    auto due = m_start_time + m_chunks[m_chunk_index].timestamp;
+    if (timeout_ms >= 0) {
+        due = std::min(due, std::chrono::steady_clock::now() +
+                                std::chrono::milliseconds(timeout_ms));
+    }
+    std::unique_lock<std::mutex> lock(m_wake_mutex);
+    m_wake_cv.wait_until(lock, due, [this]() { return m_woken; });
+    if (m_woken) {
+        m_woken = false;
+        return false;
+    }
+    return _is_next_chunk_due();
+}
+
+void MemoryPseudoTerminal::wake() {
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        m_woken = true;
+    }
+    m_wake_cv.notify_all();
+}
+
+bool MemoryPseudoTerminal::resize([[maybe_unused]] uint16_t row,
+                                  [[maybe_unused]] uint16_t col) {
+    return true;
+}
+
+void MemoryPseudoTerminal::_next_chunk() {
+    m_chunk_index++;
+    m_chunk_offset = 0;
+    m_finished = m_chunk_index == m_chunks.size();
+}
+
+bool MemoryPseudoTerminal::_is_next_chunk_due() const {
+    if (m_chunk_index == m_chunks.size()) {
+        return false;
+    }
+    if (m_timing == Timing::FullSpeed) {
+        return true;
+    }
+    return std::chrono::steady_clock::now() - m_start_time >=
+           m_chunks[m_chunk_index].timestamp;
+}
+} // namespace ImApp
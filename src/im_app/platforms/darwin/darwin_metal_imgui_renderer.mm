@@ -44,7 +44,6 @@ void DarwinMetalImGuiRenderer::new_frame() {
 
 void DarwinMetalImGuiRenderer::render(std::shared_ptr<Window> &window) {
     // Rendering
-    ImGui::Render();
     ImGui_ImplMetal_RenderDrawData(ImGui::GetDrawData(), m_command_buffer,
                                    m_render_encoder);
 
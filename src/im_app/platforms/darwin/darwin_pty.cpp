@@ -1,21 +1,31 @@
 #include "darwin_pty.h"
-#include <csignal>  // For SIGTERM
-#include <errno.h>  // For errno
-#include <fcntl.h>  // For O_RDWR, O_RDWR
-#include <limits.h> // For PATH_MAX
-#include <pwd.h>    // For getpwuid
+#include <algorithm> // For std::max
+#include <csignal>   // For SIGTERM
+#include <errno.h>   // For errno
+#include <fcntl.h>   // For O_RDWR, O_RDWR
+#include <limits.h>  // For PATH_MAX
+#include <pwd.h>     // For getpwuid
 #include <spdlog/spdlog.h>
-#include <stdlib.h>    // For getenv, setenv, unsetenv, realpath
-#include <string.h>    // For strrchr, strcpy, strncpy, strerror
-#include <sys/ioctl.h> // For ioctl
-#include <termios.h>   // For termios
+#include <stdlib.h>     // For getenv, setenv, unsetenv, realpath
+#include <string.h>     // For strrchr, strcpy, strncpy, strerror
+#include <sys/ioctl.h>  // For ioctl
+#include <sys/select.h> // For select
+#include <sys/uio.h>    // For writev
+#include <termios.h>    // For termios
 #include <unistd.h>
 
 namespace ImApp {
 DarwinPseudoTerminal::~DarwinPseudoTerminal() {
+    _stop_writer();
     if (m_pty_fd >= 0) {
         close(m_pty_fd);
     }
+    for (int fd : {m_wake_pipe[0], m_wake_pipe[1], m_writer_wake_pipe[0],
+                   m_writer_wake_pipe[1]}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
     if (m_child_pid > 0) {
         kill(m_child_pid, SIGTERM);
     }
@@ -50,6 +60,20 @@ bool DarwinPseudoTerminal::launch(uint16_t row, uint16_t col) {
         m_pty_fd = -1;
         return false;
     }
+    // Reads are driven by `wait_readable`, so the master never blocks.
+    if (fcntl(m_pty_fd, F_SETFL, fcntl(m_pty_fd, F_GETFL) | O_NONBLOCK) < 0) {
+        spdlog::critical("Failed to make PTY master non-blocking!");
+        close(m_pty_fd);
+        m_pty_fd = -1;
+        return false;
+    }
+    if (!_open_wake_pipe(m_wake_pipe) ||
+        !_open_wake_pipe(m_writer_wake_pipe)) {
+        spdlog::critical("Failed to create wake pipe!");
+        close(m_pty_fd);
+        m_pty_fd = -1;
+        return false;
+    }
 
     m_child_pid = fork();
 
@@ -216,11 +240,13 @@ bool DarwinPseudoTerminal::launch(uint16_t row, uint16_t col) {
         exit(EXIT_FAILURE); // Or exit(127) for command not found / exec failure
     }
 
+    m_write_queue.reset();
+    m_writer_thread = std::thread(&DarwinPseudoTerminal::_write_pending, this);
     return true;
 }
 
 void DarwinPseudoTerminal::terminate() {
-
+    _stop_writer();
     if (m_pty_fd >= 0) {
         close(m_pty_fd);
     }
@@ -239,16 +265,51 @@ size_t DarwinPseudoTerminal::write(const void* buff, size_t size) {
     if (m_pty_fd < 0) {
         return 0;
     }
-    return ::write(m_pty_fd, buff, size);
+    // Never touch the fd here, the writer thread flushes once it is writable.
+    return m_write_queue.push(buff, size);
 }
 
 size_t DarwinPseudoTerminal::read(void* buff, size_t size) {
     if (m_pty_fd < 0) {
         return 0;
     }
-    return ::read(m_pty_fd, buff, size);
+    ssize_t bytes_read = ::read(m_pty_fd, buff, size);
+    // EAGAIN means drained, EIO means the child hung up.
+    return bytes_read > 0 ? static_cast<size_t>(bytes_read) : 0;
 }
 
+bool DarwinPseudoTerminal::wait_readable(int timeout_ms) {
+    if (m_pty_fd < 0) {
+        return false;
+    }
+    // poll() doesn't support PTY devices on macOS, select() does.
+    fd_set read_fds;
+    int result;
+    do {
+        FD_ZERO(&read_fds);
+        FD_SET(m_pty_fd, &read_fds);
+        FD_SET(m_wake_pipe[0], &read_fds);
+        struct timeval timeout = {
+            .tv_sec = timeout_ms / 1000,
+            .tv_usec = (timeout_ms % 1000) * 1000,
+        };
+        result = select(std::max(m_pty_fd, m_wake_pipe[0]) + 1, &read_fds,
+                        nullptr, nullptr, timeout_ms < 0 ? nullptr : &timeout);
+    } while (result < 0 && errno == EINTR);
+    if (result <= 0) {
+        return false;
+    }
+    if (FD_ISSET(m_wake_pipe[0], &read_fds)) {
+        char drain[64];
+        while (::read(m_wake_pipe[0], drain, sizeof(drain)) > 0) {
+        }
+        return false;
+    }
+    return FD_ISSET(m_pty_fd, &read_fds);
+}
+
+void DarwinPseudoTerminal::wake() { _signal_wake_pipe(m_wake_pipe); }
+
 bool DarwinPseudoTerminal::resize(uint16_t row, uint16_t col) {
     if (m_pty_fd < 0) {
         return false;
@@ -259,6 +320,88 @@ bool DarwinPseudoTerminal::resize(uint16_t row, uint16_t col) {
     return ioctl(m_pty_fd, TIOCSWINSZ, &ws) >= 0;
 }
 
+bool DarwinPseudoTerminal::_open_wake_pipe(int (&wake_pipe)[2]) {
+    if (wake_pipe[0] >= 0) {
+        return true;
+    }
+    if (pipe(wake_pipe) < 0) {
+        return false;
+    }
+    for (int fd : wake_pipe) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    return true;
+}
+
+void DarwinPseudoTerminal::_signal_wake_pipe(const int (&wake_pipe)[2]) {
+    if (wake_pipe[1] < 0) {
+        return;
+    }
+    char value = 1;
+    ::write(wake_pipe[1], &value, sizeof(value));
+}
+
+void DarwinPseudoTerminal::_write_pending() {
+    while (m_write_queue.wait_pending()) {
+        fd_set read_fds;
+        fd_set write_fds;
+        FD_ZERO(&read_fds);
+        FD_ZERO(&write_fds);
+        FD_SET(m_writer_wake_pipe[0], &read_fds);
+        FD_SET(m_pty_fd, &write_fds);
+        int result = select(std::max(m_pty_fd, m_writer_wake_pipe[0]) + 1,
+                            &read_fds, &write_fds, nullptr, nullptr);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            spdlog::error("PTY writer failed to select: {}", strerror(errno));
+            return;
+        }
+        if (FD_ISSET(m_writer_wake_pipe[0], &read_fds)) {
+            // Stopping, `wait_pending` sees the closed queue.
+            char drain[64];
+            while (::read(m_writer_wake_pipe[0], drain, sizeof(drain)) > 0) {
+            }
+            continue;
+        }
+        if (FD_ISSET(m_pty_fd, &write_fds)) {
+            _flush_writes();
+        }
+    }
+}
+
+void DarwinPseudoTerminal::_stop_writer() {
+    m_write_queue.close();
+    if (m_writer_thread.joinable()) {
+        // Unblock a select on a child that stopped reading.
+        _signal_wake_pipe(m_writer_wake_pipe);
+        m_writer_thread.join();
+    }
+}
+
+void DarwinPseudoTerminal::_flush_writes() {
+    m_write_queue.flush([this](const char* first, size_t first_size,
+                               const char* second, size_t second_size) {
+        struct iovec iov[2] = {
+            {.iov_base = const_cast<char*>(first), .iov_len = first_size},
+            {.iov_base = const_cast<char*>(second), .iov_len = second_size},
+        };
+        ssize_t written;
+        do {
+            written = writev(m_pty_fd, iov, second_size > 0 ? 2 : 1);
+        } while (written < 0 && errno == EINTR);
+        if (written < 0 && errno != EAGAIN) {
+            // The child hung up, drop the input instead of retrying.
+            return first_size + second_size;
+        }
+        // EAGAIN keeps the bytes queued until the child reads again, the
+        // rest of a partial write goes out on the next wakeup.
+        return written > 0 ? static_cast<size_t>(written) : size_t{0};
+    });
+}
+
 std::shared_ptr<PseudoTerminal> PseudoTerminal::create() {
     return std::make_shared<DarwinPseudoTerminal>();
 }
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "im_app/pty.h"
+#include "im_app/pty_write_queue.h"
+#include <atomic>
 #include <sys/types.h>
+#include <thread>
 
 namespace ImApp {
 class DarwinPseudoTerminal : public PseudoTerminal {
@@ -12,10 +15,26 @@ class DarwinPseudoTerminal : public PseudoTerminal {
     virtual bool is_valid() override;
     virtual size_t write(const void* buff, size_t size) override;
     virtual size_t read(void* buff, size_t size) override;
+    virtual bool wait_readable(int timeout_ms) override;
+    virtual void wake() override;
     virtual bool resize(uint16_t row, uint16_t col) override;
 
   private:
+    static constexpr size_t g_write_queue_capacity = 1024 * 1024;
+
     int m_pty_fd{-1};
     pid_t m_child_pid{-1};
+    int m_wake_pipe[2]{-1, -1}; // self-pipe used to interrupt `wait_readable`
+    // Input for the child. It has a thread of its own, so it keeps flowing
+    // while the reader is stalled on a full output ring.
+    PtyWriteQueue m_write_queue{g_write_queue_capacity};
+    std::thread m_writer_thread;
+    int m_writer_wake_pipe[2]{-1, -1}; // self-pipe used to stop the writer
+
+    static bool _open_wake_pipe(int (&wake_pipe)[2]);
+    static void _signal_wake_pipe(const int (&wake_pipe)[2]);
+    void _write_pending();
+    void _flush_writes();
+    void _stop_writer();
 };
 } // namespace ImApp
@@ -15,6 +15,16 @@ void DarwinWindow::on_update() {
     glfwPollEvents();
 }
 
+void DarwinWindow::wait_events(double timeout_seconds) {
+    if (timeout_seconds < 0.0) {
+        glfwWaitEvents();
+    } else {
+        glfwWaitEventsTimeout(timeout_seconds);
+    }
+}
+
+void DarwinWindow::post_empty_event() { glfwPostEmptyEvent(); }
+
 void DarwinWindow::minimize() {
     if (m_window) {
         glfwIconifyWindow(m_window);
@@ -42,13 +52,18 @@ uint32_t DarwinWindow::get_height() const {
 }
 
 void DarwinWindow::_initialize(const WindowProps& props) {
+    // GLFW lives as long as the window, headless apps never initialize it.
+    if (!glfwInit()) {
+        throw std::runtime_error("Failed to initialize glfw.");
+    }
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     float main_scale =
         ImGui_ImplGlfw_GetContentScaleForMonitor(glfwGetPrimaryMonitor());
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     m_window = glfwCreateWindow(static_cast<int>(props.width * main_scale),
                                 static_cast<int>(props.height * main_scale),
                                 props.title.c_str(), nullptr, nullptr);
     if (m_window == nullptr) {
+        glfwTerminate();
         throw std::runtime_error("Failed to create glfw window.");
     }
 }
@@ -57,6 +72,7 @@ void DarwinWindow::_finalize() {
     if (m_window) {
         glfwDestroyWindow(m_window);
     }
+    glfwTerminate();
 }
 
 std::shared_ptr<Window> Window::create(const WindowProps& props) {
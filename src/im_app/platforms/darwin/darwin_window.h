@@ -11,6 +11,8 @@ class DarwinWindow : public Window {
     explicit DarwinWindow(const WindowProps& props);
     virtual ~DarwinWindow() override;
     virtual void on_update() override;
+    virtual void wait_events(double timeout_seconds) override;
+    virtual void post_empty_event() override;
     virtual void minimize() override;
     virtual void set_titlebar_hovered(bool hovered) override;
     virtual uint32_t get_width() const override;
@@ -13,13 +13,8 @@ int main(int argc, char** argv) {
 #if defined(IM_APP_DEBUG)
     glfwSetErrorCallback(glfw_error_callback);
 #endif
-    if (!glfwInit()) {
-        spdlog::error("Failed to initialize glfw!");
-        return 1;
-    }
     auto* app = ImApp::create_im_app(argc, argv);
     auto returncode = app->exec();
     delete app;
-    glfwTerminate();
     return returncode;
 }
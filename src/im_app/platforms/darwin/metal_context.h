@@ -17,6 +17,7 @@ class MetalContext : public GraphicsContext {
     virtual void initialize() override;
     virtual void finalize() override;
     virtual void swap_buffers() override;
+    virtual void set_vsync(bool enabled) override;
     virtual void on_frame_buffer_size_changed(uint32_t width,
                                               uint32_t height) override;
 
@@ -31,6 +31,10 @@ void MetalContext::swap_buffers() {
     m_layer.drawableSize = CGSizeMake(width, height);
 }
 
+void MetalContext::set_vsync(bool enabled) {
+    m_layer.displaySyncEnabled = enabled;
+}
+
 void MetalContext::on_frame_buffer_size_changed(uint32_t width,
                                                 uint32_t height) {
     m_layer.drawableSize = CGSizeMake(width, height);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "im_app/graphics_context.h"
+
+namespace ImApp {
+// Nothing to present to, frames end with the ImGui draw data.
+class HeadlessContext : public GraphicsContext {
+  public:
+    virtual void initialize() override {}
+    virtual void finalize() override {}
+    virtual void swap_buffers() override {}
+    virtual void set_vsync(bool enabled) override {}
+    virtual void on_frame_buffer_size_changed(uint32_t width,
+                                              uint32_t height) override {}
+};
+} // namespace ImApp
@@ -0,0 +1,69 @@
+#include "headless_imgui_renderer.h"
+#include "im_app/window.h"
+#include <algorithm>
+
+namespace ImApp {
+HeadlessImGuiRenderer::HeadlessImGuiRenderer(std::shared_ptr<Window> window)
+    : m_window(std::move(window)),
+      m_last_frame(std::chrono::steady_clock::now()) {
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr; // Disable imgui.ini
+    io.BackendPlatformName = "im_app_headless";
+    io.BackendRendererName = "im_app_headless";
+    // Like a real backend, so the draw data has the same shape.
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasTextures;
+    ImGui::StyleColorsDark();
+}
+
+HeadlessImGuiRenderer::~HeadlessImGuiRenderer() {
+    for (ImTextureData* texture : ImGui::GetPlatformIO().Textures) {
+        if (texture->RefCount == 1) {
+            texture->SetTexID(ImTextureID_Invalid);
+            texture->SetStatus(ImTextureStatus_Destroyed);
+        }
+    }
+    ImGui::DestroyContext();
+}
+
+void HeadlessImGuiRenderer::new_frame() {
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(static_cast<float>(m_window->get_width()),
+                            static_cast<float>(m_window->get_height()));
+    auto now = std::chrono::steady_clock::now();
+    // ImGui asserts on a zero delta time.
+    io.DeltaTime = std::max(
+        std::chrono::duration<float>(now - m_last_frame).count(), 1e-6f);
+    m_last_frame = now;
+    ImGui::NewFrame();
+}
+
+void HeadlessImGuiRenderer::render(std::shared_ptr<Window>& window) {
+    ImDrawData* draw_data = ImGui::GetDrawData();
+    if (draw_data->Textures != nullptr) {
+        for (ImTextureData* texture : *draw_data->Textures) {
+            _update_texture(texture);
+        }
+    }
+}
+
+void HeadlessImGuiRenderer::_update_texture(ImTextureData* texture) {
+    switch (texture->Status) {
+    case ImTextureStatus_WantCreate:
+        texture->SetTexID(m_next_texture_id++);
+        texture->SetStatus(ImTextureStatus_OK);
+        break;
+    case ImTextureStatus_WantUpdates:
+        texture->SetStatus(ImTextureStatus_OK);
+        break;
+    case ImTextureStatus_WantDestroy:
+        texture->SetTexID(ImTextureID_Invalid);
+        texture->SetStatus(ImTextureStatus_Destroyed);
+        break;
+    default:
+        break;
+    }
+}
+} // namespace ImApp
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "im_app/imgui_renderer.h"
+#include <chrono>
+#include <imgui.h>
+
+namespace ImApp {
+/*
+ * Builds ImGui frames without drawing them. `ImGui::GetDrawData` stays
+ * valid after `render` until the next `new_frame`, so a benchmark can count
+ * what a real backend would have drawn.
+ */
+class HeadlessImGuiRenderer : public ImGuiRenderer {
+  public:
+    explicit HeadlessImGuiRenderer(std::shared_ptr<Window> window);
+    virtual ~HeadlessImGuiRenderer() override;
+    virtual void new_frame() override;
+    virtual void render(std::shared_ptr<Window>& window) override;
+
+  private:
+    std::shared_ptr<Window> m_window;
+    std::chrono::steady_clock::time_point m_last_frame;
+    // Textures only get an id, their pixels are never uploaded.
+    ImTextureID m_next_texture_id{1};
+
+    void _update_texture(ImTextureData* texture);
+};
+} // namespace ImApp
@@ -0,0 +1,27 @@
+#include "headless_window.h"
+#include <chrono>
+
+namespace ImApp {
+HeadlessWindow::HeadlessWindow(const WindowProps& props)
+    : m_width(props.width), m_height(props.height) {}
+
+void HeadlessWindow::wait_events(double timeout_seconds) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto has_event = [this]() { return m_has_event; };
+    if (timeout_seconds < 0.0) {
+        m_event_posted.wait(lock, has_event);
+    } else {
+        m_event_posted.wait_for(
+            lock, std::chrono::duration<double>(timeout_seconds), has_event);
+    }
+    m_has_event = false;
+}
+
+void HeadlessWindow::post_empty_event() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_has_event = true;
+    }
+    m_event_posted.notify_one();
+}
+} // namespace ImApp
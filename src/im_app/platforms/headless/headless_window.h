@@ -0,0 +1,31 @@
+#pragma once
+
+#include "im_app/window.h"
+#include <condition_variable>
+#include <mutex>
+
+namespace ImApp {
+/*
+ * A window without a display server, for benchmarks and CI. It never
+ * receives input, `wait_events` only returns on a timeout or
+ * `post_empty_event`.
+ */
+class HeadlessWindow : public Window {
+  public:
+    explicit HeadlessWindow(const WindowProps& props);
+    virtual void on_update() override {}
+    virtual void wait_events(double timeout_seconds) override;
+    virtual void post_empty_event() override;
+    virtual void minimize() override {}
+    virtual void set_titlebar_hovered(bool hovered) override {}
+    virtual uint32_t get_width() const override { return m_width; }
+    virtual uint32_t get_height() const override { return m_height; }
+
+  private:
+    uint32_t m_width;
+    uint32_t m_height;
+    std::mutex m_mutex;
+    std::condition_variable m_event_posted;
+    bool m_has_event{false};
+};
+} // namespace ImApp
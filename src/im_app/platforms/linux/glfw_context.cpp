@@ -49,6 +49,12 @@ void GlfwContext::initialize() {
 
 void GlfwContext::finalize() {}
 
+void GlfwContext::set_vsync(bool enabled) {
+    if (m_window) {
+        glfwSwapInterval(enabled ? 1 : 0);
+    }
+}
+
 void GlfwContext::swap_buffers() {
     if (m_window) {
         glfwSwapBuffers(m_window->get_glfw_window());
@@ -10,6 +10,7 @@ class GlfwContext : public GraphicsContext {
     virtual void initialize() override;
     virtual void finalize() override;
     virtual void swap_buffers() override;
+    virtual void set_vsync(bool enabled) override;
     virtual void on_frame_buffer_size_changed(uint32_t width,
                                               uint32_t height) override {}
 
@@ -1,5 +1,6 @@
 #include "glfw_opengl_imgui_renderer.h"
 #include "glfw_window.h"
+#include "opengl_cell_grid_renderer.h"
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
@@ -21,7 +22,6 @@ void GlfwOpenGLImGuiRenderer::render(std::shared_ptr<Window>& window) {
     if (!window) {
         return;
     }
-    ImGui::Render();
     glViewport(0, 0, static_cast<GLsizei>(window->get_width()),
                static_cast<GLsizei>(window->get_height()));
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -43,6 +43,11 @@ void GlfwOpenGLImGuiRenderer::render(std::shared_ptr<Window>& window) {
     }
 }
 
+std::unique_ptr<CellGridRenderer>
+GlfwOpenGLImGuiRenderer::create_cell_grid_renderer() {
+    return OpenGLCellGridRenderer::create();
+}
+
 void GlfwOpenGLImGuiRenderer::
     _initialize( // NOLINT(readability-convert-member-functions-to-static)
         std::shared_ptr<GlfwWindow> window) {
@@ -10,6 +10,8 @@ class GlfwOpenGLImGuiRenderer : public ImGuiRenderer {
     virtual ~GlfwOpenGLImGuiRenderer() override;
     virtual void new_frame() override;
     virtual void render(std::shared_ptr<Window>& window) override;
+    virtual std::unique_ptr<CellGridRenderer>
+    create_cell_grid_renderer() override;
 
   private:
     void _initialize(std::shared_ptr<GlfwWindow> window);
@@ -16,6 +16,16 @@ void GlfwWindow::on_update() {
     glfwPollEvents();
 }
 
+void GlfwWindow::wait_events(double timeout_seconds) {
+    if (timeout_seconds < 0.0) {
+        glfwWaitEvents();
+    } else {
+        glfwWaitEventsTimeout(timeout_seconds);
+    }
+}
+
+void GlfwWindow::post_empty_event() { glfwPostEmptyEvent(); }
+
 void GlfwWindow::minimize() {
     if (m_window) {
         glfwIconifyWindow(m_window);
@@ -43,12 +53,19 @@ uint32_t GlfwWindow::get_height() const {
 }
 
 void GlfwWindow::_initialize(const WindowProps& props) {
+    // GLFW lives as long as the window, headless apps never initialize it.
+    if (!glfwInit()) {
+        throw std::runtime_error("Failed to initialize glfw.");
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
     float main_scale =
         ImGui_ImplGlfw_GetContentScaleForMonitor(glfwGetPrimaryMonitor());
     m_window = glfwCreateWindow(static_cast<int>(props.width * main_scale),
                                 static_cast<int>(props.height * main_scale),
                                 props.title.c_str(), nullptr, nullptr);
     if (m_window == nullptr) {
+        glfwTerminate();
         throw std::runtime_error("Failed to create glfw window.");
     }
 }
@@ -57,6 +74,7 @@ void GlfwWindow::_finalize() {
     if (m_window) {
         glfwDestroyWindow(m_window);
     }
+    glfwTerminate();
 }
 
 std::shared_ptr<Window> Window::create(const WindowProps& props) {
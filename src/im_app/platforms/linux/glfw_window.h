@@ -10,6 +10,8 @@ class GlfwWindow : public Window {
     explicit GlfwWindow(const WindowProps& props);
     virtual ~GlfwWindow() override;
     virtual void on_update() override;
+    virtual void wait_events(double timeout_seconds) override;
+    virtual void post_empty_event() override;
     virtual void minimize() override;
     virtual void set_titlebar_hovered(bool hovered) override;
     virtual uint32_t get_width() const override;
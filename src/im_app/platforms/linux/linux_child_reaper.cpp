@@ -0,0 +1,157 @@
+#include "linux_child_reaper.h"
+#include <csignal>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <spdlog/spdlog.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace ImApp {
+ChildReaper& ChildReaper::instance() {
+    static ChildReaper reaper;
+    return reaper;
+}
+
+void ChildReaper::block_child_signal() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+ChildReaper::ChildReaper() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+    // Covers the calling thread in case `main` did not block it.
+    block_child_signal();
+    m_signal_fd = signalfd(-1, &signals, SFD_CLOEXEC | SFD_NONBLOCK);
+    m_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_signal_fd < 0 || m_wake_fd < 0) {
+        spdlog::error("Failed to create the child reaper's descriptors!");
+    }
+    m_thread = std::thread(&ChildReaper::_run, this);
+}
+
+ChildReaper::~ChildReaper() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_should_stop = true;
+    }
+    _signal_wake_fd();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    if (m_signal_fd >= 0) {
+        close(m_signal_fd);
+    }
+    if (m_wake_fd >= 0) {
+        close(m_wake_fd);
+    }
+}
+
+std::shared_ptr<const std::atomic<bool>> ChildReaper::watch(pid_t pid) {
+    auto exited = std::make_shared<std::atomic<bool>>(false);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_children.emplace(pid, Child{.kill_deadline = {}, .exited = exited});
+    // The child may have exited before it was watched, and its SIGCHLD
+    // would then have been consumed already.
+    _reap_exited();
+    return exited;
+}
+
+void ChildReaper::hang_up(pid_t pid) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_children.find(pid);
+        if (it == m_children.end() || it->second.kill_deadline) {
+            // Already reaped, so the pid may belong to someone else now.
+            return;
+        }
+        kill(pid, SIGHUP);
+        it->second.kill_deadline =
+            std::chrono::steady_clock::now() + g_hang_up_grace;
+    }
+    // Let the reaper thread pick up the new deadline.
+    _signal_wake_fd();
+}
+
+void ChildReaper::_signal_wake_fd() {
+    if (m_wake_fd >= 0) {
+        uint64_t value = 1;
+        ::write(m_wake_fd, &value, sizeof(value));
+    }
+}
+
+void ChildReaper::_run() {
+    while (true) {
+        int timeout_ms;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            timeout_ms = _next_timeout_ms();
+        }
+        pollfd fds[2] = {{.fd = m_signal_fd, .events = POLLIN},
+                         {.fd = m_wake_fd, .events = POLLIN}};
+        if (poll(fds, 2, timeout_ms) < 0 && errno != EINTR) {
+            spdlog::error("Child reaper failed to poll: {}", strerror(errno));
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            // Signals coalesce, one read covers any number of exits.
+            signalfd_siginfo info;
+            while (read(m_signal_fd, &info, sizeof(info)) > 0) {
+            }
+        }
+        if (fds[1].revents & POLLIN) {
+            uint64_t value;
+            ::read(m_wake_fd, &value, sizeof(value));
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_should_stop) {
+            return;
+        }
+        _reap_exited();
+        auto now = std::chrono::steady_clock::now();
+        for (auto& [pid, child] : m_children) {
+            if (child.kill_deadline && *child.kill_deadline <= now) {
+                spdlog::warn("Child {} ignored SIGHUP, killing it.", pid);
+                kill(pid, SIGKILL);
+                // Nothing left to escalate to, just wait for the exit.
+                child.kill_deadline =
+                    std::chrono::steady_clock::time_point::max();
+            }
+        }
+    }
+}
+
+void ChildReaper::_reap_exited() {
+    for (auto it = m_children.begin(); it != m_children.end();) {
+        pid_t result = waitpid(it->first, nullptr, WNOHANG);
+        if (result == it->first || (result < 0 && errno == ECHILD)) {
+            it->second.exited->store(true, std::memory_order_release);
+            it = m_children.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+int ChildReaper::_next_timeout_ms() {
+    auto next = std::chrono::steady_clock::time_point::max();
+    for (const auto& [pid, child] : m_children) {
+        if (child.kill_deadline) {
+            next = std::min(next, *child.kill_deadline);
+        }
+    }
+    if (next == std::chrono::steady_clock::time_point::max()) {
+        return -1;
+    }
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+        next - std::chrono::steady_clock::now());
+    return static_cast<int>(std::max<int64_t>(remaining.count(), 0));
+}
+} // namespace ImApp
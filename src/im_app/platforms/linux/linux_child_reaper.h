@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sys/types.h>
+#include <thread>
+#include <unordered_map>
+
+namespace ImApp {
+/*
+ * Reaps the shells started by LinuxPseudoTerminal from a single thread
+ * woken by SIGCHLD through a signalfd.
+ *
+ * SIGCHLD has to be blocked in every thread for the signalfd to see it, so
+ * `block_child_signal` must run in `main` before any thread is started.
+ * Children are only reaped once they are watched, so processes spawned by
+ * other libraries keep their exit status.
+ */
+class ChildReaper {
+  public:
+    static ChildReaper& instance();
+    static void block_child_signal();
+
+    ChildReaper(const ChildReaper&) = delete;
+    ChildReaper(ChildReaper&&) = delete;
+    ChildReaper& operator=(const ChildReaper&) = delete;
+    ChildReaper& operator=(ChildReaper&&) = delete;
+
+    // Reap `pid` as soon as it exits. The returned flag is set once it did.
+    std::shared_ptr<const std::atomic<bool>> watch(pid_t pid);
+    // Sends SIGHUP to a watched child and SIGKILL if it is still around
+    // after `g_hang_up_grace`. Returns immediately.
+    void hang_up(pid_t pid);
+
+  private:
+    static constexpr std::chrono::seconds g_hang_up_grace{2};
+
+    struct Child {
+        // Set once the child was asked to exit
+        std::optional<std::chrono::steady_clock::time_point> kill_deadline;
+        std::shared_ptr<std::atomic<bool>> exited;
+    };
+
+    int m_signal_fd{-1};
+    int m_wake_fd{-1}; // eventfd that rearms deadlines or stops `m_thread`
+    std::mutex m_mutex;
+    std::unordered_map<pid_t, Child> m_children;
+    bool m_should_stop{false};
+    std::thread m_thread;
+
+    ChildReaper();
+    ~ChildReaper();
+
+    void _run();
+    void _signal_wake_fd();
+    // Both called with `m_mutex` held
+    void _reap_exited();
+    int _next_timeout_ms();
+};
+} // namespace ImApp
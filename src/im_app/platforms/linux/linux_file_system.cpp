@@ -1,5 +1,8 @@
 #include "im_app/file_system.h"
+#include <fcntl.h>
 #include <pwd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <vector>
 
@@ -36,4 +39,38 @@ std::filesystem::path FileSystem::local_app_data_path() {
     auto ret = pw_dir / ".cache";
     return ret;
 }
+
+MappedFile::~MappedFile() {
+    if (m_data != nullptr) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+}
+
+std::shared_ptr<MappedFile>
+MappedFile::open(const std::filesystem::path& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return nullptr;
+    }
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->m_size = static_cast<size_t>(st.st_size);
+    if (file->m_size > 0) {
+        void* data = mmap(nullptr, file->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return nullptr;
+        }
+        // Replay reads the file front to back exactly once.
+        madvise(data, file->m_size, MADV_SEQUENTIAL);
+        file->m_data = static_cast<const char*>(data);
+    }
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+    return file;
+}
 } // namespace ImApp
@@ -1,23 +1,39 @@
 #include "linux_pty.h"
-#include <csignal>  // For SIGTERM
+#include "linux_child_reaper.h"
+#include <algorithm>
+#include <csignal>  // For sigset_t
 #include <errno.h>  // For errno
 #include <fcntl.h>  // For O_RDWR, O_RDWR
 #include <limits.h> // For PATH_MAX
+#include <poll.h>   // For poll
 #include <pwd.h>    // For getpwuid
+#include <spawn.h>  // For posix_spawn
 #include <spdlog/spdlog.h>
-#include <stdlib.h>    // For getenv, setenv, unsetenv, realpath
-#include <string.h>    // For strrchr, strcpy, strncpy, strerror
-#include <sys/ioctl.h> // For ioctl
-#include <termios.h>   // For termios
+#include <stdlib.h>      // For getenv
+#include <string.h>      // For strerror
+#include <string_view>
+#include <sys/eventfd.h> // For eventfd
+#include <sys/ioctl.h>   // For ioctl
+#include <sys/uio.h>     // For writev
+#include <termios.h>     // For termios
 #include <unistd.h>
 
 namespace ImApp {
 LinuxPseudoTerminal::~LinuxPseudoTerminal() {
+    _stop_writer();
+#if defined(IM_APP_IO_URING)
+    _uring_shutdown();
+#endif
     if (m_pty_fd >= 0) {
         close(m_pty_fd);
     }
+    for (int fd : {m_wake_fd, m_writer_wake_fd}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
     if (m_child_pid > 0) {
-        kill(m_child_pid, SIGTERM);
+        ChildReaper::instance().hang_up(m_child_pid);
     }
 }
 
@@ -25,8 +41,10 @@ bool LinuxPseudoTerminal::launch(uint16_t row, uint16_t col) {
     if (is_valid()) {
         return true;
     }
-    // Open PTY master
-    m_pty_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    // A shell that exited leaves its master and writer thread behind.
+    terminate();
+    // Open PTY master, never inherited by the child
+    m_pty_fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
     if (m_pty_fd < 0) {
         spdlog::critical("Failed to call posix_openpt!");
         return false;
@@ -50,198 +68,196 @@ bool LinuxPseudoTerminal::launch(uint16_t row, uint16_t col) {
         m_pty_fd = -1;
         return false;
     }
-
-    m_child_pid = fork();
-
-    if (m_child_pid < 0) {
-        spdlog::critical("Failed to fork current process!");
+    // Reads are driven by `wait_readable`, so the master never blocks.
+    if (fcntl(m_pty_fd, F_SETFL, fcntl(m_pty_fd, F_GETFL) | O_NONBLOCK) < 0) {
+        spdlog::critical("Failed to make PTY master non-blocking!");
         close(m_pty_fd);
         m_pty_fd = -1;
         return false;
     }
-
-    if (m_child_pid == 0) {
-        /* We are now in the forked child process. */
-        close(m_pty_fd); // Close master PTY in child
-
-        if (setsid() < 0) {
-            // Create new session, detach from parent's controlling TTY
-            spdlog::critical("Failed to call setsid!");
-            exit(EXIT_FAILURE);
-        }
-
-        // Open slave PTY
-        int slave_fd = open(slave_name, O_RDWR);
-        if (slave_fd < 0) {
-            spdlog::critical("Failed to slave PTY!");
-            exit(EXIT_FAILURE);
-        }
-
-        // Make the slave PTY the controlling terminal for this new session
-        if (ioctl(slave_fd, TIOCSCTTY, 0) < 0) {
-            // This can fail if the process is not a session leader and already
-            // has a controlling TTY. setsid() should make us a session leader.
-            spdlog::warn(
-                "ioctl TIOCSCTTY failed (can be non-fatal depending on "
-                "context)");
-        }
-
-        dup2(slave_fd, STDIN_FILENO);
-        dup2(slave_fd, STDOUT_FILENO);
-        dup2(slave_fd, STDERR_FILENO);
-
-        if (slave_fd > STDERR_FILENO) {
-            close(slave_fd);
-        }
-
-        // Configure terminal modes for the slave PTY
-        struct termios tios;
-        if (tcgetattr(STDIN_FILENO, &tios) < 0) {
-            spdlog::critical("tcgetattr failed on slave pty");
-            exit(EXIT_FAILURE);
-        }
-
-        // Set reasonable default modes (from st/typical terminal settings)
-        tios.c_iflag = ICRNL | IXON | IXANY | IMAXBEL | BRKINT;
-#if defined(IUTF8) // Common on Linux, good to enable if available
-        tios.c_iflag |= IUTF8;
-#endif
-        tios.c_oflag =
-            OPOST |
-            ONLCR; // OPOST: enable output processing, ONLCR: map NL to CR-NL
-
-        tios.c_cflag &= ~(CSIZE | PARENB); // Clear size and parity bits
-        tios.c_cflag |= CS8;               // 8 bits per character
-        tios.c_cflag |= CREAD;             // Enable receiver
-        tios.c_cflag |= HUPCL; // Hang up on last close (sends SIGHUP to
-                               // foreground process group)
-
-        // Standard local modes for interactive shells
-        tios.c_lflag =
-            ICANON | ISIG | IEXTEN | ECHO | ECHOE | ECHOK | ECHOCTL | ECHOKE;
-
-        if (tcsetattr(STDIN_FILENO, TCSANOW, &tios) < 0) {
-            spdlog::critical("tcsetattr failed on slave pty");
-            exit(EXIT_FAILURE);
+    for (int* fd : {&m_wake_fd, &m_writer_wake_fd}) {
+        if (*fd < 0) {
+            *fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
         }
-
-        // Set window size
-        struct winsize ws = {};
-        ws.ws_row = row;
-        ws.ws_col = col;
-        if (ioctl(STDIN_FILENO, TIOCSWINSZ, &ws) < 0) {
-            spdlog::warn(
-                "ioctl TIOCSWINSZ failed on slave pty (non-fatal, shell "
-                "might misbehave)");
-        }
-
-        // Prepare environment for the shell
-        setenv("TERM", "xterm-256color", 1);
-        // Unsetting these is often good as the login shell will set them
-        // appropriately
-        unsetenv("COLUMNS");
-        unsetenv("LINES");
-        // Optionally, clear other inherited variables that might cause issues,
-        // e.g., unsetenv("TERMCAP"); unsetenv("WINDOWID"); // Common in some
-        // terminal emulators
-
-        // Logic for Linux and other Unix-like systems (also launch as login
-        // shell)
-        char shell_path_buf[PATH_MAX];
-        const char* shell_env_val =
-            getenv("SHELL"); // SHELL env var is primary on Linux
-
-        if (shell_env_val && shell_env_val[0] != '\0') {
-            strncpy(shell_path_buf, shell_env_val, sizeof(shell_path_buf));
-            shell_path_buf[sizeof(shell_path_buf) - 1] = '\0';
-        } else {
-            struct passwd* pw_linux =
-                getpwuid(getuid()); // Fallback to passwd entry
-            if (pw_linux && pw_linux->pw_shell &&
-                pw_linux->pw_shell[0] != '\0') {
-                strncpy(shell_path_buf, pw_linux->pw_shell,
-                        sizeof(shell_path_buf));
-                shell_path_buf[sizeof(shell_path_buf) - 1] = '\0';
-            } else {
-                strncpy(shell_path_buf, "/bin/bash",
-                        sizeof(shell_path_buf)); // Absolute fallback for Linux
-                shell_path_buf[sizeof(shell_path_buf) - 1] = '\0';
-            }
-        }
-
-        char shell_argv0_login_linux[PATH_MAX + 1];
-        shell_argv0_login_linux[0] = '-';
-        const char* shell_basename_linux = strrchr(shell_path_buf, '/');
-        if (shell_basename_linux) {
-            strncpy(shell_argv0_login_linux + 1, shell_basename_linux + 1,
-                    sizeof(shell_argv0_login_linux) - 2);
-        } else {
-            strncpy(shell_argv0_login_linux + 1, shell_path_buf,
-                    sizeof(shell_argv0_login_linux) - 2);
+        if (*fd < 0) {
+            spdlog::critical("Failed to create wake eventfd!");
+            close(m_pty_fd);
+            m_pty_fd = -1;
+            return false;
         }
-        shell_argv0_login_linux[sizeof(shell_argv0_login_linux) - 1] = '\0';
+    }
 
-        char* const new_argv_linux[] = {shell_argv0_login_linux, nullptr};
+    // Everything the child needs is prepared here in the parent, so that
+    // posix_spawn can use vfork semantics and the child only has to exec.
+    int slave_fd = open(slave_name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (slave_fd < 0) {
+        spdlog::critical("Failed to open slave PTY!");
+        close(m_pty_fd);
+        m_pty_fd = -1;
+        return false;
+    }
+    _configure_slave(slave_fd, row, col);
+
+    std::string shell_path = _shell_path();
+    // A leading '-' in argv[0] launches a login shell
+    std::string shell_argv0 =
+        "-" + shell_path.substr(shell_path.find_last_of('/') + 1);
+    char* const argv[] = {shell_argv0.data(), nullptr};
+    std::vector<std::string> env_storage = _shell_environment();
+    std::vector<char*> envp;
+    envp.reserve(env_storage.size() + 1);
+    for (auto& entry : env_storage) {
+        envp.push_back(entry.data());
+    }
+    envp.push_back(nullptr);
 
 #if defined(IM_APP_DEBUG)
-        spdlog::debug("[PTY DEBUG] Linux/Other Shell Launch Information:");
-        struct passwd* pw_linux_debug = getpwuid(getuid());
-        spdlog::debug("  User's pw_shell (from getpwuid): '{}'",
-                      (pw_linux_debug && pw_linux_debug->pw_shell)
-                          ? pw_linux_debug->pw_shell
-                          : "(not found or empty)");
-        const char* env_shell_child_linux = getenv("SHELL");
-        spdlog::debug("  getenv(\"SHELL\") in child process: '{}'",
-                      env_shell_child_linux ? env_shell_child_linux
-                                            : "(not set or empty)");
-        spdlog::debug("  Path to be executed (shell_path_buf): '{}'",
-                      shell_path_buf);
-        spdlog::debug("  argv[0] for child shell (new_argv_linux[0]): '{}'",
-                      new_argv_linux[0] ? new_argv_linux[0] : "(NULL)");
+    spdlog::debug("[PTY DEBUG] Linux/Other Shell Launch Information:");
+    spdlog::debug("  Path to be executed: '{}'", shell_path);
+    spdlog::debug("  argv[0] for child shell: '{}'", shell_argv0);
 #endif
 
-        execv(shell_path_buf, new_argv_linux);
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init(&file_actions);
+    // Opened after setsid, so the slave becomes the controlling terminal.
+    posix_spawn_file_actions_addopen(&file_actions, STDIN_FILENO, slave_name,
+                                     O_RDWR, 0);
+    posix_spawn_file_actions_adddup2(&file_actions, STDIN_FILENO,
+                                     STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&file_actions, STDIN_FILENO,
+                                     STDERR_FILENO);
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 34)
+    // Don't leak the GL driver's or anyone else's descriptors to the shell.
+    posix_spawn_file_actions_addclosefrom_np(&file_actions, STDERR_FILENO + 1);
+#endif
 
-        spdlog::critical(
-            "FATAL: Failed to execv shell '{}' (intended argv[0]='{}'): {}",
-            shell_path_buf, new_argv_linux[0] ? new_argv_linux[0] : "(null)",
-            strerror(errno));
-        exit(127); // Standard exit code for command
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attr, &signals);
+    sigfillset(&signals);
+    posix_spawnattr_setsigdefault(&attr, &signals);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID |
+                                        POSIX_SPAWN_SETSIGMASK |
+                                        POSIX_SPAWN_SETSIGDEF);
+
+    int result = posix_spawn(&m_child_pid, shell_path.c_str(), &file_actions,
+                             &attr, argv, envp.data());
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&file_actions);
+    close(slave_fd);
+
+    if (result != 0) {
+        spdlog::critical("Failed to spawn shell '{}': {}", shell_path,
+                         strerror(result));
+        m_child_pid = -1;
+        close(m_pty_fd);
+        m_pty_fd = -1;
+        return false;
     }
-
+    m_child_exited = ChildReaper::instance().watch(m_child_pid);
+    m_write_queue.reset();
+#if defined(IM_APP_IO_URING)
+    _uring_init();
+    if (m_uring) {
+        // Input goes out as linked writes on the ring, no thread needed.
+        return true;
+    }
+#endif
+    _start_writer();
     return true;
 }
 
 void LinuxPseudoTerminal::terminate() {
-
+    // Never waits for the child: closing the master hangs up the session
+    // and the reaper takes care of the rest.
+    _stop_writer();
+#if defined(IM_APP_IO_URING)
+    _uring_shutdown();
+#endif
     if (m_pty_fd >= 0) {
         close(m_pty_fd);
     }
     m_pty_fd = -1;
     if (m_child_pid > 0) {
-        kill(m_child_pid, SIGTERM);
+        ChildReaper::instance().hang_up(m_child_pid);
     }
     m_child_pid = -1;
+    m_child_exited.reset();
 }
 
 bool LinuxPseudoTerminal::is_valid() {
-    return m_pty_fd >= 0 && m_child_pid > 0;
+    return m_pty_fd >= 0 && m_child_pid > 0 && m_child_exited &&
+           !m_child_exited->load(std::memory_order_acquire);
 }
 
 size_t LinuxPseudoTerminal::write(const void* buff, size_t size) {
     if (m_pty_fd < 0) {
         return 0;
     }
-    return ::write(m_pty_fd, buff, size);
+    // Never touch the fd here, the writer thread or io_uring flush on
+    // POLLOUT.
+    size_t accepted = m_write_queue.push(buff, size);
+#if defined(IM_APP_IO_URING)
+    std::lock_guard<std::mutex> lock(m_uring_mutex);
+    if (m_uring) {
+        if (!m_uring_waiting) {
+            // Nobody waits on the ring, e.g. the reader is stalled on a
+            // full output ring, so pick up finished writes here.
+            _uring_reap();
+        }
+        _uring_submit_writes();
+    }
+#endif
+    return accepted;
 }
 
 size_t LinuxPseudoTerminal::read(void* buff, size_t size) {
     if (m_pty_fd < 0) {
         return 0;
     }
-    return ::read(m_pty_fd, buff, size);
+#if defined(IM_APP_IO_URING)
+    if (m_uring) {
+        return _uring_read(buff, size);
+    }
+#endif
+    ssize_t bytes_read = ::read(m_pty_fd, buff, size);
+    // EAGAIN means drained, EIO means the child hung up.
+    return bytes_read > 0 ? static_cast<size_t>(bytes_read) : 0;
+}
+
+bool LinuxPseudoTerminal::wait_readable(int timeout_ms) {
+    if (m_pty_fd < 0) {
+        return false;
+    }
+#if defined(IM_APP_IO_URING)
+    if (m_uring) {
+        return _uring_wait_readable(timeout_ms);
+    }
+#endif
+    struct pollfd fds[2] = {
+        {.fd = m_pty_fd, .events = POLLIN, .revents = 0},
+        {.fd = m_wake_fd, .events = POLLIN, .revents = 0},
+    };
+    int result;
+    do {
+        result = poll(fds, 2, timeout_ms);
+    } while (result < 0 && errno == EINTR);
+    if (result <= 0) {
+        return false;
+    }
+    if (fds[1].revents & POLLIN) {
+        uint64_t value;
+        while (::read(m_wake_fd, &value, sizeof(value)) > 0) {
+        }
+        return false;
+    }
+    return (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
 }
 
+void LinuxPseudoTerminal::wake() { _signal_eventfd(m_wake_fd); }
+
 bool LinuxPseudoTerminal::resize(uint16_t row, uint16_t col) {
     if (m_pty_fd < 0) {
         return false;
@@ -252,6 +268,401 @@ bool LinuxPseudoTerminal::resize(uint16_t row, uint16_t col) {
     return ioctl(m_pty_fd, TIOCSWINSZ, &ws) >= 0;
 }
 
+void LinuxPseudoTerminal::_signal_eventfd(int fd) {
+    if (fd < 0) {
+        return;
+    }
+    uint64_t value = 1;
+    ::write(fd, &value, sizeof(value));
+}
+
+void LinuxPseudoTerminal::_write_pending() {
+    while (m_write_queue.wait_pending()) {
+        struct pollfd fds[2] = {
+            {.fd = m_pty_fd, .events = POLLOUT, .revents = 0},
+            {.fd = m_writer_wake_fd, .events = POLLIN, .revents = 0},
+        };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            spdlog::error("PTY writer failed to poll: {}", strerror(errno));
+            return;
+        }
+        if (fds[1].revents & POLLIN) {
+            // Stopping, `wait_pending` sees the closed queue.
+            uint64_t value;
+            ::read(m_writer_wake_fd, &value, sizeof(value));
+            continue;
+        }
+        if (fds[0].revents & (POLLOUT | POLLHUP | POLLERR)) {
+            _flush_writes();
+        }
+    }
+}
+
+void LinuxPseudoTerminal::_start_writer() {
+    m_writer_thread = std::thread(&LinuxPseudoTerminal::_write_pending, this);
+}
+
+void LinuxPseudoTerminal::_stop_writer() {
+    m_write_queue.close();
+    if (m_writer_thread.joinable()) {
+        // Unblock a poll on a child that stopped reading.
+        _signal_eventfd(m_writer_wake_fd);
+        m_writer_thread.join();
+    }
+}
+
+void LinuxPseudoTerminal::_flush_writes() {
+    m_write_queue.flush([this](const char* first, size_t first_size,
+                               const char* second, size_t second_size) {
+        struct iovec iov[2] = {
+            {.iov_base = const_cast<char*>(first), .iov_len = first_size},
+            {.iov_base = const_cast<char*>(second), .iov_len = second_size},
+        };
+        ssize_t written;
+        do {
+            written = writev(m_pty_fd, iov, second_size > 0 ? 2 : 1);
+        } while (written < 0 && errno == EINTR);
+        if (written < 0 && errno != EAGAIN) {
+            // The child hung up, drop the input instead of retrying.
+            return first_size + second_size;
+        }
+        // EAGAIN keeps the bytes queued until the child reads again, the
+        // rest of a partial write goes out on the next POLLOUT.
+        return written > 0 ? static_cast<size_t>(written) : size_t{0};
+    });
+}
+
+#if defined(IM_APP_IO_URING)
+void LinuxPseudoTerminal::_uring_init() {
+    auto uring = std::make_unique<LinuxUring>();
+    if (!uring->init(g_uring_entries, g_uring_buffer_count,
+                     g_uring_buffer_size)) {
+        spdlog::info("io_uring is unavailable, using poll for PTY I/O.");
+        return;
+    }
+    // The queue's storage never moves, so it is registered once per ring.
+    iovec queue_storage = {
+        .iov_base = const_cast<char*>(m_write_queue.data()),
+        .iov_len = m_write_queue.capacity(),
+    };
+    std::lock_guard<std::mutex> lock(m_uring_mutex);
+    m_uring_fixed_writes = uring->register_buffers(&queue_storage, 1);
+    if (!m_uring_fixed_writes) {
+        spdlog::info("Can't register PTY input buffers, using plain writes.");
+    }
+    m_uring = std::move(uring);
+    m_uring_reads.clear();
+    m_uring_read_armed = false;
+    m_uring_wake_armed = false;
+    m_uring_hung_up = false;
+    m_uring_unsupported = false;
+    m_uring_woken = false;
+    m_uring_writes_in_flight = 0;
+    m_uring_written = 0;
+    m_uring_write_failed = false;
+}
+
+void LinuxPseudoTerminal::_uring_shutdown() {
+    // Closing the ring cancels the requests still in flight.
+    std::lock_guard<std::mutex> lock(m_uring_mutex);
+    m_uring.reset();
+    m_uring_reads.clear();
+}
+
+void LinuxPseudoTerminal::_uring_fall_back() {
+    _uring_shutdown();
+    // Input the ring did not confirm is sent again by the writer thread.
+    _start_writer();
+}
+
+bool LinuxPseudoTerminal::_uring_wait_readable(int timeout_ms) {
+    bool unsupported = false;
+    for (int pass = 0;; pass++) {
+        {
+            std::lock_guard<std::mutex> lock(m_uring_mutex);
+            _uring_reap();
+            if (m_uring_woken) {
+                m_uring_woken = false;
+                return false;
+            }
+            if (!m_uring_reads.empty() || m_uring_hung_up) {
+                return true;
+            }
+            if (pass > 0 && timeout_ms >= 0) {
+                return false;
+            }
+            unsupported = m_uring_unsupported;
+            if (unsupported || !_uring_arm_reads()) {
+                break;
+            }
+            // From here on completions are left to the `wait` below.
+            m_uring_waiting = true;
+        }
+        int result = m_uring->wait(timeout_ms);
+        std::lock_guard<std::mutex> lock(m_uring_mutex);
+        m_uring_waiting = false;
+        if (result < 0) {
+            spdlog::error("io_uring_enter failed: {}", strerror(-result));
+            return false;
+        }
+    }
+    if (unsupported) {
+        // `init` probed for multishot reads, but fall back for good if the
+        // kernel still rejects them on this fd.
+        spdlog::info("io_uring rejected a multishot read, using poll.");
+    } else {
+        spdlog::error("io_uring submission queue is stuck, using poll.");
+    }
+    _uring_fall_back();
+    return wait_readable(timeout_ms);
+}
+
+bool LinuxPseudoTerminal::_uring_arm_reads() {
+    if (!m_uring_read_armed) {
+        io_uring_sqe* sqe = _uring_get_sqe();
+        if (sqe == nullptr) {
+            return false;
+        }
+        sqe->opcode = LinuxUring::g_op_read_multishot;
+        sqe->fd = m_pty_fd;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = LinuxUring::g_buffer_group;
+        sqe->user_data = UringRead;
+        m_uring_read_armed = true;
+    }
+    if (!m_uring_wake_armed) {
+        io_uring_sqe* sqe = _uring_get_sqe();
+        if (sqe == nullptr) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = m_wake_fd;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = UringWake;
+        m_uring_wake_armed = true;
+    }
+    return _uring_submit();
+}
+
+void LinuxPseudoTerminal::_uring_submit_writes() {
+    if (m_uring_writes_in_flight > 0) {
+        return;
+    }
+    PtyWriteQueue::Pending pending = m_write_queue.pending();
+    if (pending.size() == 0) {
+        return;
+    }
+    // POLLOUT first, so the writes on the non-blocking master don't fail
+    // with EAGAIN while the child is behind. A short write cancels the rest
+    // of the chain, which is resubmitted once it completed.
+    io_uring_sqe* poll = _uring_get_sqe();
+    if (poll == nullptr) {
+        return;
+    }
+    poll->opcode = IORING_OP_POLL_ADD;
+    poll->fd = m_pty_fd;
+    poll->poll32_events = POLLOUT;
+    poll->flags = IOSQE_IO_LINK;
+    poll->user_data = UringWritePoll;
+    m_uring_writes_in_flight = 1;
+    m_uring_written = 0;
+    m_uring_write_failed = false;
+    std::pair<const char*, size_t> segments[2] = {
+        {pending.first, pending.first_size},
+        {pending.second, pending.second_size},
+    };
+    for (auto [data, size] : segments) {
+        if (size == 0) {
+            continue;
+        }
+        io_uring_sqe* sqe = _uring_get_sqe();
+        if (sqe == nullptr) {
+            break;
+        }
+        sqe->opcode =
+            m_uring_fixed_writes ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->fd = m_pty_fd;
+        sqe->addr = reinterpret_cast<uint64_t>(data);
+        sqe->len = static_cast<uint32_t>(size);
+        sqe->buf_index = 0;
+        sqe->user_data = UringWrite;
+        if (data == pending.first && pending.second_size > 0) {
+            sqe->flags = IOSQE_IO_LINK;
+        }
+        m_uring_writes_in_flight++;
+    }
+    _uring_submit();
+}
+
+bool LinuxPseudoTerminal::_uring_submit() {
+    int result = m_uring->submit();
+    if (result < 0) {
+        spdlog::error("io_uring_enter failed: {}", strerror(-result));
+        return false;
+    }
+    return true;
+}
+
+io_uring_sqe* LinuxPseudoTerminal::_uring_get_sqe() {
+    io_uring_sqe* sqe = m_uring->get_sqe();
+    if (sqe == nullptr) {
+        // Full, hand the queued entries to the kernel to make room.
+        if (!_uring_submit()) {
+            return nullptr;
+        }
+        sqe = m_uring->get_sqe();
+    }
+    return sqe;
+}
+
+size_t LinuxPseudoTerminal::_uring_read(void* buff, size_t size) {
+    std::lock_guard<std::mutex> lock(m_uring_mutex);
+    // Completions that arrived since the last wait cost no system call.
+    _uring_reap();
+    char* out = static_cast<char*>(buff);
+    size_t count = 0;
+    while (count < size && !m_uring_reads.empty()) {
+        UringReadBuffer& read = m_uring_reads.front();
+        size_t chunk = std::min(size - count, read.size - read.offset);
+        std::memcpy(out + count, m_uring->buffer(read.id) + read.offset,
+                    chunk);
+        count += chunk;
+        read.offset += chunk;
+        if (read.offset == read.size) {
+            m_uring->recycle_buffer(read.id);
+            m_uring_reads.pop_front();
+        }
+    }
+    return count;
+}
+
+void LinuxPseudoTerminal::_uring_reap() {
+    m_uring->for_each_completion(
+        [this](const io_uring_cqe& cqe) { _uring_handle(cqe); });
+}
+
+void LinuxPseudoTerminal::_uring_handle(const io_uring_cqe& cqe) {
+    bool more = cqe.flags & IORING_CQE_F_MORE;
+    switch (cqe.user_data) {
+    case UringRead:
+        m_uring_read_armed = more;
+        if (cqe.res > 0) {
+            auto id =
+                static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            m_uring_reads.push_back(
+                {.id = id, .size = static_cast<size_t>(cqe.res), .offset = 0});
+        } else if (cqe.res == -EINVAL) {
+            m_uring_unsupported = true;
+        } else if (cqe.res != -ENOBUFS && cqe.res != -EAGAIN &&
+                   cqe.res != -EINTR) {
+            // EIO or end of file means the child hung up. Running out of
+            // buffers only needs a new read once `read` recycled some.
+            m_uring_hung_up = true;
+        }
+        break;
+    case UringWritePoll:
+    case UringWrite: {
+        if (cqe.user_data == UringWrite && cqe.res > 0) {
+            m_uring_written += static_cast<size_t>(cqe.res);
+        } else if (cqe.res < 0 && cqe.res != -ECANCELED &&
+                   cqe.res != -EAGAIN && cqe.res != -EINTR) {
+            m_uring_write_failed = true;
+        }
+        if (--m_uring_writes_in_flight > 0) {
+            break;
+        }
+        // The child hung up if a write failed, drop the input instead of
+        // retrying, like the writer thread does.
+        m_write_queue.drop(m_uring_write_failed ? m_write_queue.size()
+                                                : m_uring_written);
+        _uring_submit_writes();
+        break;
+    }
+    case UringWake: {
+        m_uring_wake_armed = more;
+        uint64_t value;
+        while (::read(m_wake_fd, &value, sizeof(value)) > 0) {
+        }
+        m_uring_woken = true;
+        break;
+    }
+    default:
+        break;
+    }
+}
+#endif
+
+void LinuxPseudoTerminal::_configure_slave(int slave_fd, uint16_t row,
+                                          uint16_t col) {
+    struct termios tios;
+    if (tcgetattr(slave_fd, &tios) < 0) {
+        spdlog::warn("tcgetattr failed on slave pty");
+        return;
+    }
+
+    // Set reasonable default modes (from st/typical terminal settings)
+    tios.c_iflag = ICRNL | IXON | IXANY | IMAXBEL | BRKINT;
+#if defined(IUTF8) // Common on Linux, good to enable if available
+    tios.c_iflag |= IUTF8;
+#endif
+    // OPOST: enable output processing, ONLCR: map NL to CR-NL
+    tios.c_oflag = OPOST | ONLCR;
+
+    tios.c_cflag &= ~(CSIZE | PARENB); // Clear size and parity bits
+    tios.c_cflag |= CS8;               // 8 bits per character
+    tios.c_cflag |= CREAD;             // Enable receiver
+    tios.c_cflag |= HUPCL; // Hang up on last close (sends SIGHUP to
+                           // foreground process group)
+
+    // Standard local modes for interactive shells
+    tios.c_lflag =
+        ICANON | ISIG | IEXTEN | ECHO | ECHOE | ECHOK | ECHOCTL | ECHOKE;
+
+    if (tcsetattr(slave_fd, TCSANOW, &tios) < 0) {
+        spdlog::warn("tcsetattr failed on slave pty");
+    }
+
+    struct winsize ws = {};
+    ws.ws_row = row;
+    ws.ws_col = col;
+    if (ioctl(slave_fd, TIOCSWINSZ, &ws) < 0) {
+        spdlog::warn("ioctl TIOCSWINSZ failed on slave pty (non-fatal, shell "
+                     "might misbehave)");
+    }
+}
+
+std::string LinuxPseudoTerminal::_shell_path() {
+    const char* shell_env_val =
+        getenv("SHELL"); // SHELL env var is primary on Linux
+    if (shell_env_val && shell_env_val[0] != '\0') {
+        return shell_env_val;
+    }
+    struct passwd* pw_linux = getpwuid(getuid()); // Fallback to passwd entry
+    if (pw_linux && pw_linux->pw_shell && pw_linux->pw_shell[0] != '\0') {
+        return pw_linux->pw_shell;
+    }
+    return "/bin/bash"; // Absolute fallback for Linux
+}
+
+std::vector<std::string> LinuxPseudoTerminal::_shell_environment() {
+    std::vector<std::string> env;
+    for (char** entry = environ; *entry != nullptr; entry++) {
+        std::string_view var = *entry;
+        // The login shell sets these appropriately
+        if (var.starts_with("TERM=") || var.starts_with("COLUMNS=") ||
+            var.starts_with("LINES=")) {
+            continue;
+        }
+        env.emplace_back(var);
+    }
+    env.emplace_back("TERM=xterm-256color");
+    return env;
+}
+
 std::shared_ptr<PseudoTerminal> PseudoTerminal::create() {
     return std::make_shared<LinuxPseudoTerminal>();
 }
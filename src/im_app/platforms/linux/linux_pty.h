@@ -1,7 +1,18 @@
 #pragma once
 
 #include "im_app/pty.h"
+#include "im_app/pty_write_queue.h"
+#include <atomic>
+#include <memory>
+#include <string>
 #include <sys/types.h>
+#include <thread>
+#include <vector>
+#if defined(IM_APP_IO_URING)
+#include "linux_uring.h"
+#include <deque>
+#include <mutex>
+#endif
 
 namespace ImApp {
 class LinuxPseudoTerminal : public PseudoTerminal {
@@ -12,10 +23,92 @@ class LinuxPseudoTerminal : public PseudoTerminal {
     virtual bool is_valid() override;
     virtual size_t write(const void* buff, size_t size) override;
     virtual size_t read(void* buff, size_t size) override;
+    virtual bool wait_readable(int timeout_ms) override;
+    virtual void wake() override;
     virtual bool resize(uint16_t row, uint16_t col) override;
 
   private:
+    static constexpr size_t g_write_queue_capacity = 1024 * 1024;
+
     int m_pty_fd{-1};
     pid_t m_child_pid{-1};
+    // Set by the ChildReaper, e.g. for a shell that exited in a pool
+    std::shared_ptr<const std::atomic<bool>> m_child_exited;
+    int m_wake_fd{-1}; // eventfd used to interrupt `wait_readable`
+    // Input for the child. It has a thread of its own, so it keeps flowing
+    // while the reader is stalled on a full output ring.
+    PtyWriteQueue m_write_queue{g_write_queue_capacity};
+    std::thread m_writer_thread;
+    int m_writer_wake_fd{-1}; // eventfd used to stop `m_writer_thread`
+
+    static void _signal_eventfd(int fd);
+    void _write_pending();
+    void _flush_writes();
+    void _start_writer();
+    void _stop_writer();
+
+#if defined(IM_APP_IO_URING)
+    /*
+     * Optional io_uring backend. A multishot read fills buffers from a
+     * provided buffer ring and the wake eventfd is watched by a multishot
+     * poll, so a burst of output is picked up with one `io_uring_enter`
+     * instead of one `read` per chunk. `write` submits input as a POLLOUT
+     * poll linked to fixed writes straight from the registered
+     * `m_write_queue`, so there is no writer thread. Whoever waits in
+     * `wait_readable` reaps their completions and queues the rest. Without
+     * kernel support the `poll(2)` path above is used.
+     */
+    static constexpr unsigned g_uring_entries = 16;
+    static constexpr unsigned g_uring_buffer_count = 32;
+    // n_tty never hands out more than this in one read
+    static constexpr size_t g_uring_buffer_size = 4096;
+
+    enum UringTag : uint64_t {
+        UringRead = 1,
+        UringWake,
+        UringWritePoll,
+        UringWrite,
+    };
+
+    struct UringReadBuffer {
+        uint16_t id;
+        size_t size;
+        size_t offset;
+    };
+
+    // Guards everything below, `write` submits and reaps from other
+    // threads. Only the reader resets `m_uring`.
+    std::mutex m_uring_mutex;
+    std::unique_ptr<LinuxUring> m_uring;
+    std::deque<UringReadBuffer> m_uring_reads; // completed, not yet read
+    bool m_uring_read_armed{false};
+    bool m_uring_wake_armed{false};
+    bool m_uring_hung_up{false};
+    bool m_uring_unsupported{false};
+    bool m_uring_woken{false};
+    // Set while a thread waits for completions in `wait_readable`. Nobody
+    // else reaps them then, or that wait would miss them.
+    bool m_uring_waiting{false};
+    bool m_uring_fixed_writes{false};
+    unsigned m_uring_writes_in_flight{0};
+    size_t m_uring_written{0};
+    bool m_uring_write_failed{false};
+
+    void _uring_init();
+    void _uring_shutdown();
+    void _uring_fall_back();
+    bool _uring_wait_readable(int timeout_ms);
+    bool _uring_arm_reads();
+    void _uring_submit_writes();
+    bool _uring_submit();
+    io_uring_sqe* _uring_get_sqe();
+    size_t _uring_read(void* buff, size_t size);
+    void _uring_reap();
+    void _uring_handle(const io_uring_cqe& cqe);
+#endif
+
+    static void _configure_slave(int slave_fd, uint16_t row, uint16_t col);
+    static std::string _shell_path();
+    static std::vector<std::string> _shell_environment();
 };
 } // namespace ImApp
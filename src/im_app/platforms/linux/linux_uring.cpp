@@ -0,0 +1,208 @@
+#include "linux_uring.h"
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+namespace ImApp {
+static int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                          unsigned flags, const void* arg, size_t arg_size) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                    min_complete, flags, arg, arg_size));
+}
+
+static int io_uring_register(int fd, unsigned opcode, const void* arg,
+                             unsigned arg_count) {
+    return static_cast<int>(
+        syscall(__NR_io_uring_register, fd, opcode, arg, arg_count));
+}
+
+static void* map_ring(int fd, size_t size, off_t offset) {
+    void* ring = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, offset);
+    return ring == MAP_FAILED ? nullptr : ring;
+}
+
+LinuxUring::~LinuxUring() {
+    // Closing the ring cancels whatever is still in flight.
+    if (m_ring_fd >= 0) {
+        close(m_ring_fd);
+    }
+    if (m_sqes) {
+        munmap(m_sqes, m_sqes_size);
+    }
+    if (m_cq_ring && m_cq_ring != m_sq_ring) {
+        munmap(m_cq_ring, m_cq_ring_size);
+    }
+    if (m_sq_ring) {
+        munmap(m_sq_ring, m_sq_ring_size);
+    }
+    if (m_buffer_ring) {
+        munmap(m_buffer_ring, m_buffer_ring_size);
+    }
+    if (m_buffers) {
+        munmap(m_buffers, m_buffer_count * m_buffer_size);
+    }
+}
+
+bool LinuxUring::init(unsigned entries, unsigned buffer_count,
+                      size_t buffer_size) {
+    io_uring_params params = {};
+    m_ring_fd = io_uring_setup(entries, &params);
+    if (m_ring_fd < 0) {
+        return false;
+    }
+    // Timed waits need EXT_ARG, which also implies a single ring mapping.
+    constexpr unsigned required_features =
+        IORING_FEAT_SINGLE_MMAP | IORING_FEAT_EXT_ARG | IORING_FEAT_NODROP;
+    if ((params.features & required_features) != required_features) {
+        close(m_ring_fd);
+        m_ring_fd = -1;
+        return false;
+    }
+
+    m_sq_ring_size =
+        std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                 params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    m_sq_ring = map_ring(m_ring_fd, m_sq_ring_size, IORING_OFF_SQ_RING);
+    m_cq_ring = m_sq_ring;
+    m_cq_ring_size = m_sq_ring_size;
+    m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes = static_cast<io_uring_sqe*>(
+        map_ring(m_ring_fd, m_sqes_size, IORING_OFF_SQES));
+    if (!m_sq_ring || !m_sqes) {
+        return false;
+    }
+
+    auto* sq = static_cast<char*>(m_sq_ring);
+    m_sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    m_sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    m_sq_entries = params.sq_entries;
+    m_sq_local_tail = *m_sq_tail;
+    // Entries are always submitted in order, so the index array is fixed.
+    auto* sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < m_sq_entries; i++) {
+        sq_array[i] = i;
+    }
+
+    auto* cq = static_cast<char*>(m_cq_ring);
+    m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    m_cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    return _supports(g_op_read_multishot) &&
+           _register_buffer_ring(buffer_count, buffer_size);
+}
+
+bool LinuxUring::register_buffers(const iovec* buffers, unsigned count) {
+    return io_uring_register(m_ring_fd, IORING_REGISTER_BUFFERS, buffers,
+                             count) >= 0;
+}
+
+io_uring_sqe* LinuxUring::get_sqe() {
+    unsigned head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+    if (m_sq_local_tail - head >= m_sq_entries) {
+        return nullptr;
+    }
+    io_uring_sqe* sqe = &m_sqes[m_sq_local_tail & m_sq_mask];
+    m_sq_local_tail++;
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int LinuxUring::submit() {
+    unsigned to_submit = m_sq_local_tail - *m_sq_tail;
+    __atomic_store_n(m_sq_tail, m_sq_local_tail, __ATOMIC_RELEASE);
+    if (to_submit == 0) {
+        return 0;
+    }
+    int result;
+    do {
+        result = io_uring_enter(m_ring_fd, to_submit, 0, 0, nullptr, 0);
+    } while (result < 0 && errno == EINTR);
+    return result >= 0 ? result : -errno;
+}
+
+int LinuxUring::wait(int timeout_ms) {
+    __kernel_timespec timeout = {};
+    io_uring_getevents_arg arg = {};
+    if (timeout_ms >= 0) {
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+        arg.ts = reinterpret_cast<uint64_t>(&timeout);
+    }
+    int result;
+    do {
+        result = io_uring_enter(m_ring_fd, 0, 1,
+                                IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                                &arg, sizeof(arg));
+    } while (result < 0 && errno == EINTR);
+    // ETIME only means the timeout expired without completions.
+    return result >= 0 || errno == ETIME ? 0 : -errno;
+}
+
+void LinuxUring::recycle_buffer(uint16_t buffer_id) {
+    io_uring_buf& entry =
+        m_buffer_ring[m_buffer_ring_tail & (m_buffer_count - 1)];
+    entry.addr = reinterpret_cast<uint64_t>(buffer(buffer_id));
+    entry.len = static_cast<uint32_t>(m_buffer_size);
+    entry.bid = buffer_id;
+    m_buffer_ring_tail++;
+    // The tail overlays the `resv` field of the first entry.
+    auto* ring = reinterpret_cast<io_uring_buf_ring*>(m_buffer_ring);
+    __atomic_store_n(&ring->tail, m_buffer_ring_tail, __ATOMIC_RELEASE);
+}
+
+bool LinuxUring::_supports(uint8_t opcode) {
+    // Room for every opcode up to `opcode`
+    std::vector<char> storage(sizeof(io_uring_probe) +
+                              (opcode + 1) * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (io_uring_register(m_ring_fd, IORING_REGISTER_PROBE, probe,
+                          opcode + 1) < 0) {
+        return false;
+    }
+    return opcode <= probe->last_op &&
+           (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+}
+
+bool LinuxUring::_register_buffer_ring(unsigned buffer_count,
+                                       size_t buffer_size) {
+    m_buffer_count = buffer_count;
+    m_buffer_size = buffer_size;
+    m_buffer_ring_size = buffer_count * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, m_buffer_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    void* buffers = mmap(nullptr, buffer_count * buffer_size,
+                         PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                         -1, 0);
+    m_buffer_ring =
+        ring == MAP_FAILED ? nullptr : static_cast<io_uring_buf*>(ring);
+    m_buffers = buffers == MAP_FAILED ? nullptr : static_cast<char*>(buffers);
+    if (!m_buffer_ring || !m_buffers) {
+        return false;
+    }
+
+    io_uring_buf_reg reg = {};
+    reg.ring_addr = reinterpret_cast<uint64_t>(m_buffer_ring);
+    reg.ring_entries = buffer_count;
+    reg.bgid = g_buffer_group;
+    if (io_uring_register(m_ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        return false;
+    }
+    for (unsigned i = 0; i < buffer_count; i++) {
+        recycle_buffer(static_cast<uint16_t>(i));
+    }
+    return true;
+}
+} // namespace ImApp
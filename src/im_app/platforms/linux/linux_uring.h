@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+
+namespace ImApp {
+/*
+ * Minimal io_uring on top of the raw system calls, just enough for the PTY:
+ * one submission and completion queue pair, one provided buffer ring that
+ * multishot reads pick their buffers from and registered buffers for fixed
+ * writes.
+ *
+ * Completions and provided buffers belong to one thread. Submissions may
+ * come from any thread as long as the caller serializes `get_sqe` and
+ * `submit`.
+ */
+class LinuxUring {
+  public:
+    LinuxUring() = default;
+    ~LinuxUring();
+    LinuxUring(const LinuxUring&) = delete;
+    LinuxUring(LinuxUring&&) = delete;
+    LinuxUring& operator=(const LinuxUring&) = delete;
+    LinuxUring& operator=(LinuxUring&&) = delete;
+
+    // Sets up the queues and `buffer_count` buffers of `buffer_size` bytes
+    // in buffer group `g_buffer_group`. `buffer_count` must be a power of
+    // two. Returns false if the kernel lacks any of the required features,
+    // multishot reads included.
+    bool init(unsigned entries, unsigned buffer_count, size_t buffer_size);
+    bool is_valid() const { return m_ring_fd >= 0; }
+
+    // Registers memory for IORING_OP_WRITE_FIXED, which then skips pinning
+    // the pages on every write. Fails e.g. above RLIMIT_MEMLOCK.
+    bool register_buffers(const iovec* buffers, unsigned count);
+
+    // Returns a cleared submission entry or nullptr if the queue is full.
+    io_uring_sqe* get_sqe();
+    // Submits queued entries without waiting. Returns the number submitted
+    // or -errno.
+    int submit();
+    // Waits for a completion or `timeout_ms` (negative waits forever)
+    // without submitting. Returns 0 or -errno.
+    int wait(int timeout_ms);
+
+    // Calls `handler(const io_uring_cqe&)` for every completion available
+    // without entering the kernel and returns how many were handled.
+    template <typename Handler>
+    unsigned for_each_completion(Handler&& handler) {
+        unsigned head = *m_cq_head;
+        unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        for (; head != tail; head++, count++) {
+            handler(m_cqes[head & m_cq_mask]);
+        }
+        __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+        return count;
+    }
+
+    char* buffer(uint16_t buffer_id) const {
+        return m_buffers + buffer_id * m_buffer_size;
+    }
+    size_t buffer_size() const { return m_buffer_size; }
+    // Hands a buffer picked by a read back to the kernel.
+    void recycle_buffer(uint16_t buffer_id);
+
+    static constexpr uint16_t g_buffer_group = 0;
+    // IORING_OP_READ_MULTISHOT from Linux 6.7, spelled out because build
+    // machines often have older headers. `init` probes whether the kernel
+    // has it.
+    static constexpr uint8_t g_op_read_multishot = 49;
+
+  private:
+    int m_ring_fd{-1};
+    void* m_sq_ring{nullptr};
+    size_t m_sq_ring_size{0};
+    void* m_cq_ring{nullptr};
+    size_t m_cq_ring_size{0};
+    io_uring_sqe* m_sqes{nullptr};
+    size_t m_sqes_size{0};
+
+    unsigned* m_sq_head{nullptr};
+    unsigned* m_sq_tail{nullptr};
+    unsigned m_sq_mask{0};
+    unsigned m_sq_entries{0};
+    unsigned m_sq_local_tail{0};
+    unsigned* m_cq_head{nullptr};
+    unsigned* m_cq_tail{nullptr};
+    unsigned m_cq_mask{0};
+    io_uring_cqe* m_cqes{nullptr};
+
+    // Entries of the provided buffer ring. `io_uring_buf_ring::bufs` is not
+    // at offset 0 when the header is compiled as C++, so it is not used.
+    io_uring_buf* m_buffer_ring{nullptr};
+    size_t m_buffer_ring_size{0};
+    char* m_buffers{nullptr};
+    unsigned m_buffer_count{0};
+    size_t m_buffer_size{0};
+    uint16_t m_buffer_ring_tail{0};
+
+    bool _supports(uint8_t opcode);
+    bool _register_buffer_ring(unsigned buffer_count, size_t buffer_size);
+};
+} // namespace ImApp
@@ -1,4 +1,5 @@
 #include "im_app/application.h"
+#include "linux_child_reaper.h"
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 #include <spdlog/spdlog.h>
@@ -10,16 +11,11 @@ static void glfw_error_callback(int error, const char* description) {
 #endif
 
 int main(int argc, char** argv) {
+    // Before any thread exists, so that every thread inherits the mask.
+    ImApp::ChildReaper::block_child_signal();
     glfwSetErrorCallback(glfw_error_callback);
-    if (!glfwInit()) {
-        spdlog::error("Failed to initialize glfw!");
-        return 1;
-    }
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
     auto* app = ImApp::create_im_app(argc, argv);
     auto returncode = app->exec();
     delete app;
-    glfwTerminate();
     return returncode;
 }
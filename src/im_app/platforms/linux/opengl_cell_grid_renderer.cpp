@@ -0,0 +1,316 @@
+#include "opengl_cell_grid_renderer.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+#include <string>
+
+namespace ImApp {
+// Glyphs take two texels, p0 and p1, then uv0 and uv1.
+static_assert(sizeof(CellGridRenderer::Glyph) == 8 * sizeof(float));
+static_assert(sizeof(CellGridRenderer::Cell) == 4 * sizeof(uint32_t));
+static constexpr int g_glyphs_per_row = 256;
+
+static constexpr const char* g_vertex_shader = R"(#version 140
+uniform mat4 u_projection;
+uniform vec2 u_origin;
+uniform vec2 u_cell_size;
+uniform int u_cols;
+uniform usampler2D u_cells;
+uniform sampler2D u_glyphs;
+flat out uvec4 v_cell;
+flat out vec4 v_glyph_rect;
+flat out vec4 v_glyph_uv;
+out vec2 v_local;
+
+void main() {
+    ivec2 cell = ivec2(gl_InstanceID % u_cols, gl_InstanceID / u_cols);
+    v_cell = texelFetch(u_cells, cell, 0);
+    int glyph = int(v_cell.x);
+    ivec2 texel = ivec2(glyph % 256 * 2, glyph / 256);
+    v_glyph_rect = texelFetch(u_glyphs, texel, 0);
+    v_glyph_uv = texelFetch(u_glyphs, texel + ivec2(1, 0), 0);
+    if ((v_cell.w & 4u) != 0u) {
+        v_glyph_rect -= vec4(u_cell_size.x, 0.0, u_cell_size.x, 0.0);
+    }
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    v_local = corner * u_cell_size;
+    vec2 pos = u_origin + (vec2(cell) + corner) * u_cell_size;
+    gl_Position = u_projection * vec4(pos, 0.0, 1.0);
+}
+)";
+
+static constexpr const char* g_fragment_shader = R"(#version 140
+uniform vec2 u_cell_size;
+uniform sampler2D u_atlas;
+flat in uvec4 v_cell;
+flat in vec4 v_glyph_rect;
+flat in vec4 v_glyph_uv;
+in vec2 v_local;
+out vec4 out_color;
+
+vec4 unpack_color(uint color) {
+    return vec4(color & 255u, (color >> 8) & 255u, (color >> 16) & 255u,
+                color >> 24) / 255.0;
+}
+
+void main() {
+    vec4 fg = unpack_color(v_cell.y);
+    vec4 bg = (v_cell.w & 1u) != 0u ? unpack_color(v_cell.z)
+                                    : vec4(fg.rgb, 0.0);
+    float coverage = 0.0;
+    if (v_cell.x != 0u && all(greaterThanEqual(v_local, v_glyph_rect.xy)) &&
+        all(lessThan(v_local, v_glyph_rect.zw))) {
+        vec2 t = (v_local - v_glyph_rect.xy) /
+                 (v_glyph_rect.zw - v_glyph_rect.xy);
+        coverage = texture(u_atlas, mix(v_glyph_uv.xy, v_glyph_uv.zw, t)).a;
+    }
+    if ((v_cell.w & 2u) != 0u && v_local.y >= u_cell_size.y - 1.0) {
+        coverage = 1.0;
+    }
+    float alpha = coverage * fg.a;
+    out_color = vec4(mix(bg.rgb, fg.rgb, alpha),
+                     bg.a + alpha * (1.0 - bg.a));
+}
+)";
+
+static GLuint compile_shader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        std::string log(1024, '\0');
+        glGetShaderInfoLog(shader, static_cast<GLsizei>(log.size()), nullptr,
+                           log.data());
+        spdlog::error("[OpenGLCellGridRenderer] Shader error: {}",
+                      log.c_str());
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static GLuint create_texture() {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    // Integer textures are incomplete with any other filter.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return texture;
+}
+
+std::unique_ptr<OpenGLCellGridRenderer> OpenGLCellGridRenderer::create() {
+    if (!GLEW_VERSION_3_1) {
+        spdlog::warn("[OpenGLCellGridRenderer] Needs OpenGL 3.1.");
+        return nullptr;
+    }
+    std::unique_ptr<OpenGLCellGridRenderer> renderer(
+        new OpenGLCellGridRenderer());
+    if (!renderer->_initialize()) {
+        return nullptr;
+    }
+    return renderer;
+}
+
+OpenGLCellGridRenderer::~OpenGLCellGridRenderer() {
+    glDeleteProgram(m_program);
+    glDeleteVertexArrays(1, &m_vertex_array);
+    glDeleteTextures(1, &m_cell_texture);
+    glDeleteTextures(1, &m_glyph_texture);
+}
+
+bool OpenGLCellGridRenderer::_initialize() {
+    GLint last_texture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
+    m_cell_texture = create_texture();
+    m_glyph_texture = create_texture();
+    glBindTexture(GL_TEXTURE_2D, last_texture);
+    // Quads are generated from gl_VertexID, but core contexts still want a
+    // vertex array bound.
+    glGenVertexArrays(1, &m_vertex_array);
+
+    GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, g_vertex_shader);
+    GLuint fragment_shader =
+        compile_shader(GL_FRAGMENT_SHADER, g_fragment_shader);
+    if (!vertex_shader || !fragment_shader) {
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
+        return false;
+    }
+    m_program = glCreateProgram();
+    glAttachShader(m_program, vertex_shader);
+    glAttachShader(m_program, fragment_shader);
+    glBindFragDataLocation(m_program, 0, "out_color");
+    glLinkProgram(m_program);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    GLint status = GL_FALSE;
+    glGetProgramiv(m_program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        spdlog::error("[OpenGLCellGridRenderer] Failed to link the shaders.");
+        return false;
+    }
+    m_projection_location = glGetUniformLocation(m_program, "u_projection");
+    m_origin_location = glGetUniformLocation(m_program, "u_origin");
+    m_cell_size_location = glGetUniformLocation(m_program, "u_cell_size");
+    m_cols_location = glGetUniformLocation(m_program, "u_cols");
+
+    GLint last_program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &last_program);
+    glUseProgram(m_program);
+    glUniform1i(glGetUniformLocation(m_program, "u_atlas"), 0);
+    glUniform1i(glGetUniformLocation(m_program, "u_cells"), 1);
+    glUniform1i(glGetUniformLocation(m_program, "u_glyphs"), 2);
+    glUseProgram(last_program);
+
+    // Glyph 0 stays empty.
+    set_glyph(0, {});
+    return true;
+}
+
+void OpenGLCellGridRenderer::resize(int cols, int rows) {
+    m_cols = std::max(cols, 0);
+    m_rows = std::max(rows, 0);
+    m_cells.assign(static_cast<size_t>(m_cols) * m_rows, {});
+    m_dirty_rows.assign(m_rows, true);
+    m_has_dirty_rows = true;
+}
+
+void OpenGLCellGridRenderer::set_row(int row, const Cell* cells) {
+    if (row < 0 || row >= m_rows) {
+        return;
+    }
+    std::copy_n(cells, m_cols, m_cells.begin() + row * m_cols);
+    m_dirty_rows[row] = true;
+    m_has_dirty_rows = true;
+}
+
+void OpenGLCellGridRenderer::set_glyph(uint32_t index, const Glyph& glyph) {
+    if (index >= m_glyphs.size()) {
+        size_t rows = index / g_glyphs_per_row + 1;
+        m_glyphs.resize(rows * g_glyphs_per_row);
+    }
+    m_glyphs[index] = glyph;
+    m_glyphs_dirty = true;
+}
+
+void OpenGLCellGridRenderer::draw(ImDrawList* draw_list, const ImVec2& pos,
+                                  const ImVec2& cell_size,
+                                  ImTextureRef atlas) {
+    if (m_cells.empty()) {
+        return;
+    }
+    const ImGuiViewport* viewport = ImGui::GetWindowViewport();
+    DrawParams params{
+        .renderer = this,
+        .pos = pos,
+        .cell_size = cell_size,
+        .display_pos = viewport->Pos,
+        .display_size = viewport->Size,
+        .atlas = atlas,
+    };
+    draw_list->AddCallback(&_draw_callback, &params, sizeof(params));
+    // Hands the GL state back to the ImGui backend.
+    draw_list->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+}
+
+void OpenGLCellGridRenderer::_draw_callback(const ImDrawList* draw_list,
+                                            const ImDrawCmd* cmd) {
+    const auto* params = static_cast<const DrawParams*>(cmd->UserCallbackData);
+    params->renderer->_draw(*params, cmd->ClipRect);
+}
+
+void OpenGLCellGridRenderer::_upload() {
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (m_has_dirty_rows) {
+        glBindTexture(GL_TEXTURE_2D, m_cell_texture);
+        if (m_texture_cols != m_cols || m_texture_rows != m_rows) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32UI, m_cols, m_rows, 0,
+                         GL_RGBA_INTEGER, GL_UNSIGNED_INT, nullptr);
+            m_texture_cols = m_cols;
+            m_texture_rows = m_rows;
+        }
+        // One upload per run of consecutive dirty rows
+        for (int row = 0; row < m_rows;) {
+            if (!m_dirty_rows[row]) {
+                row++;
+                continue;
+            }
+            int end = row;
+            while (end < m_rows && m_dirty_rows[end]) {
+                m_dirty_rows[end++] = false;
+            }
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, m_cols, end - row,
+                            GL_RGBA_INTEGER, GL_UNSIGNED_INT,
+                            &m_cells[static_cast<size_t>(row) * m_cols]);
+            row = end;
+        }
+        m_has_dirty_rows = false;
+    }
+    if (m_glyphs_dirty) {
+        // Glyphs change rarely, the whole table is uploaded.
+        glBindTexture(GL_TEXTURE_2D, m_glyph_texture);
+        int rows = static_cast<int>(m_glyphs.size() / g_glyphs_per_row);
+        if (rows != m_glyph_rows) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, g_glyphs_per_row * 2,
+                         rows, 0, GL_RGBA, GL_FLOAT, m_glyphs.data());
+            m_glyph_rows = rows;
+        } else {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, g_glyphs_per_row * 2,
+                            rows, GL_RGBA, GL_FLOAT, m_glyphs.data());
+        }
+        m_glyphs_dirty = false;
+    }
+}
+
+void OpenGLCellGridRenderer::_draw(const DrawParams& params,
+                                   const ImVec4& clip_rect) {
+    _upload();
+
+    GLint viewport[4] = {0};
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    ImVec2 scale(viewport[2] / params.display_size.x,
+                 viewport[3] / params.display_size.y);
+    // Clip rect in framebuffer pixels, the ImGui backend skips the scissor
+    // for callbacks.
+    ImVec2 clip_min((clip_rect.x - params.display_pos.x) * scale.x,
+                    (clip_rect.y - params.display_pos.y) * scale.y);
+    ImVec2 clip_max((clip_rect.z - params.display_pos.x) * scale.x,
+                    (clip_rect.w - params.display_pos.y) * scale.y);
+    if (clip_max.x <= clip_min.x || clip_max.y <= clip_min.y) {
+        return;
+    }
+    glScissor(static_cast<GLint>(clip_min.x),
+              static_cast<GLint>(viewport[3] - clip_max.y),
+              static_cast<GLsizei>(clip_max.x - clip_min.x),
+              static_cast<GLsizei>(clip_max.y - clip_min.y));
+
+    // Same orthographic projection as the ImGui backend
+    float left = params.display_pos.x;
+    float right = params.display_pos.x + params.display_size.x;
+    float top = params.display_pos.y;
+    float bottom = params.display_pos.y + params.display_size.y;
+    const float projection[4][4] = {
+        {2.0f / (right - left), 0.0f, 0.0f, 0.0f},
+        {0.0f, 2.0f / (top - bottom), 0.0f, 0.0f},
+        {0.0f, 0.0f, -1.0f, 0.0f},
+        {(right + left) / (left - right), (top + bottom) / (bottom - top),
+         0.0f, 1.0f},
+    };
+    glUseProgram(m_program);
+    glUniformMatrix4fv(m_projection_location, 1, GL_FALSE, &projection[0][0]);
+    glUniform2f(m_origin_location, params.pos.x, params.pos.y);
+    glUniform2f(m_cell_size_location, params.cell_size.x, params.cell_size.y);
+    glUniform1i(m_cols_location, m_cols);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_cell_texture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, m_glyph_texture);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(params.atlas.GetTexID()));
+    glBindVertexArray(m_vertex_array);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_cols * m_rows);
+}
+} // namespace ImApp
@@ -0,0 +1,69 @@
+#pragma once
+#include "GL/glew.h"
+#include "im_app/cell_grid_renderer.h"
+#include <memory>
+#include <vector>
+
+namespace ImApp {
+/*
+ * Keeps the cells in an RGBA32UI texture, one texel per cell, and the glyph
+ * table in an RGBA32F texture. Each cell is an instance of a quad whose
+ * fragment shader blends its glyph over its background. Needs OpenGL 3.1
+ * for instancing and integer textures, which Mesa's llvmpipe provides.
+ */
+class OpenGLCellGridRenderer : public CellGridRenderer {
+  public:
+    // Returns nullptr when the context lacks OpenGL 3.1 or the shaders
+    // don't build.
+    static std::unique_ptr<OpenGLCellGridRenderer> create();
+    virtual ~OpenGLCellGridRenderer() override;
+
+    virtual void resize(int cols, int rows) override;
+    virtual void set_row(int row, const Cell* cells) override;
+    virtual void set_glyph(uint32_t index, const Glyph& glyph) override;
+    virtual void draw(ImDrawList* draw_list, const ImVec2& pos,
+                      const ImVec2& cell_size, ImTextureRef atlas) override;
+
+  private:
+    // Copied into the draw list, read back by `_draw_callback`
+    struct DrawParams {
+        OpenGLCellGridRenderer* renderer;
+        ImVec2 pos;
+        ImVec2 cell_size;
+        ImVec2 display_pos;
+        ImVec2 display_size;
+        ImTextureRef atlas;
+    };
+
+    GLuint m_program{0};
+    GLuint m_vertex_array{0};
+    GLuint m_cell_texture{0};
+    GLuint m_glyph_texture{0};
+    GLint m_projection_location{-1};
+    GLint m_origin_location{-1};
+    GLint m_cell_size_location{-1};
+    GLint m_cols_location{-1};
+
+    int m_cols{0};
+    int m_rows{0};
+    std::vector<Cell> m_cells;
+    // Rows set since the last upload
+    std::vector<bool> m_dirty_rows;
+    bool m_has_dirty_rows{false};
+    // Size of the cell texture, reallocated when the grid is resized
+    int m_texture_cols{0};
+    int m_texture_rows{0};
+
+    // Padded to whole texture rows, `m_glyph_rows` of which are allocated
+    std::vector<Glyph> m_glyphs;
+    int m_glyph_rows{0};
+    bool m_glyphs_dirty{false};
+
+    OpenGLCellGridRenderer() = default;
+    bool _initialize();
+    void _upload();
+    void _draw(const DrawParams& params, const ImVec4& clip_rect);
+    static void _draw_callback(const ImDrawList* draw_list,
+                               const ImDrawCmd* cmd);
+};
+} // namespace ImApp
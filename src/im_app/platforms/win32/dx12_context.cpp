@@ -74,7 +74,13 @@ void D3D12Context::finalize() {
 
 void D3D12Context::swap_buffers() {
     m_swap_chain_occluded = false;
-    HRESULT hr = m_swap_chain->Present(1, 0); // Present with vsync
+    HRESULT hr;
+    if (m_vsync_enabled) {
+        hr = m_swap_chain->Present(1, 0);
+    } else {
+        hr = m_swap_chain->Present(
+            0, m_swap_chain_tearing_support ? DXGI_PRESENT_ALLOW_TEARING : 0);
+    }
     m_swap_chain_occluded = (hr == DXGI_STATUS_OCCLUDED);
     m_frame_index++;
 }
@@ -42,6 +42,9 @@ class D3D12Context : public GraphicsContext {
     virtual void initialize() override;
     virtual void finalize() override;
     virtual void swap_buffers() override;
+    virtual void set_vsync(bool enabled) override {
+        m_vsync_enabled = enabled;
+    }
     virtual void on_frame_buffer_size_changed(uint32_t width,
                                               uint32_t height) override;
 
@@ -76,6 +79,7 @@ class D3D12Context : public GraphicsContext {
     bool m_use_warp_device = false;
     bool m_swap_chain_tearing_support = false;
     bool m_swap_chain_occluded = false;
+    bool m_vsync_enabled = true;
     ComPtr<ID3D12Device> m_device = nullptr;
     ComPtr<IDXGISwapChain3> m_swap_chain = nullptr;
     ComPtr<ID3D12CommandQueue> m_command_queue = nullptr;
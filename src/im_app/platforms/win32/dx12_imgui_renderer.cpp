@@ -16,7 +16,6 @@ void D3D12ImGuiRenderer::new_frame() {
 }
 
 void D3D12ImGuiRenderer::render(std::shared_ptr<Window>& window) {
-    ImGui::Render();
 
     auto context = D3D12Context::get();
     IM_ASSERT(context);
@@ -1,6 +1,7 @@
 #include "wgl_context.h"
 #include "win32_window.h"
 #include <GL/glew.h>
+#include <GL/wglew.h>
 #include <spdlog/spdlog.h>
 #include <stdexcept>
 
@@ -63,6 +64,12 @@ void WGLContext::finalize() {
 
 void WGLContext::swap_buffers() { ::SwapBuffers(m_hdc); }
 
+void WGLContext::set_vsync(bool enabled) {
+    if (WGLEW_EXT_swap_control) {
+        wglSwapIntervalEXT(enabled ? 1 : 0);
+    }
+}
+
 bool WGLContext::create_device(HWND hwnd, HDC& hdc) {
     HDC temp_hdc = ::GetDC(hwnd);
     PIXELFORMATDESCRIPTOR pfd = {0};
@@ -26,4 +26,44 @@ std::filesystem::path FileSystem::local_app_data_path() {
     }
     return std::filesystem::path();
 }
+
+MappedFile::~MappedFile() {
+    if (m_data != nullptr) {
+        ::UnmapViewOfFile(m_data);
+    }
+}
+
+std::shared_ptr<MappedFile>
+MappedFile::open(const std::filesystem::path& path) {
+    HANDLE file_handle = ::CreateFileW(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    LARGE_INTEGER file_size;
+    if (!::GetFileSizeEx(file_handle, &file_size)) {
+        ::CloseHandle(file_handle);
+        return nullptr;
+    }
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->m_size = static_cast<size_t>(file_size.QuadPart);
+    if (file->m_size > 0) {
+        HANDLE mapping = ::CreateFileMappingW(file_handle, nullptr,
+                                              PAGE_READONLY, 0, 0, nullptr);
+        void* data = mapping ? ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)
+                             : nullptr;
+        if (mapping) {
+            ::CloseHandle(mapping);
+        }
+        if (data == nullptr) {
+            ::CloseHandle(file_handle);
+            return nullptr;
+        }
+        file->m_data = static_cast<const char*>(data);
+    }
+    // The view stays valid after both handles are closed.
+    ::CloseHandle(file_handle);
+    return file;
+}
 } // namespace ImApp
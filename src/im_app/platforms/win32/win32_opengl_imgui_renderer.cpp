@@ -22,7 +22,6 @@ void Win32OpenGLImGuiRenderer::render(std::shared_ptr<Window>& window) {
     if (!window) {
         return;
     }
-    ImGui::Render();
     glViewport(0, 0, static_cast<GLsizei>(window->get_width()),
                static_cast<GLsizei>(window->get_height()));
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -1,5 +1,6 @@
 #include "win32_pty.h"
 #include <spdlog/spdlog.h>
+#include <utility>
 
 namespace ImApp {
 static void log_win32_error() {
@@ -29,6 +30,7 @@ static void log_win32_error() {
 }
 
 Win32PseudoTerminal::~Win32PseudoTerminal() {
+    _stop_writer();
     // Clean-up client app's process-info & thread
     if (m_cmd_pi.hThread != INVALID_HANDLE_VALUE) {
         ::CloseHandle(m_cmd_pi.hThread);
@@ -47,6 +49,10 @@ Win32PseudoTerminal::~Win32PseudoTerminal() {
     if (m_h_pipe_in != INVALID_HANDLE_VALUE) {
         ::CloseHandle(m_h_pipe_in);
     }
+    HANDLE reader_thread = m_reader_thread.exchange(nullptr);
+    if (reader_thread != nullptr) {
+        ::CloseHandle(reader_thread);
+    }
 }
 
 bool Win32PseudoTerminal::launch(uint16_t row, uint16_t col) {
@@ -171,10 +177,13 @@ bool Win32PseudoTerminal::launch(uint16_t row, uint16_t col) {
         ::free(attribute_list);
     }
 
+    m_write_queue.reset();
+    m_writer_thread = std::thread(&Win32PseudoTerminal::_write_pending, this);
     return true;
 }
 
 void Win32PseudoTerminal::terminate() {
+    _stop_writer();
     // Clean-up client app's process-info & thread
     if (m_cmd_pi.hThread != INVALID_HANDLE_VALUE) {
         ::CloseHandle(m_cmd_pi.hThread);
@@ -214,12 +223,7 @@ size_t Win32PseudoTerminal::write(const void* buff, size_t size) {
     if (m_h_pipe_out == INVALID_HANDLE_VALUE) {
         return 0;
     }
-    DWORD written;
-    if (!::WriteFile(m_h_pipe_out, buff, size, &written, nullptr)) {
-        log_win32_error();
-        return 0;
-    }
-    return written;
+    return m_write_queue.push(buff, size);
 }
 
 size_t Win32PseudoTerminal::read(void* buff, size_t size) {
@@ -229,14 +233,90 @@ size_t Win32PseudoTerminal::read(void* buff, size_t size) {
     if (m_h_pipe_in == INVALID_HANDLE_VALUE) {
         return 0;
     }
+    // Either `wake` sees `m_reading` and cancels until the read is over, or
+    // the wake already happened and is seen here.
+    m_reading = true;
+    if (m_woken.load()) {
+        m_reading = false;
+        return 0;
+    }
     DWORD nread;
-    if (!::ReadFile(m_h_pipe_in, buff, size, &nread, nullptr)) {
-        log_win32_error();
+    BOOL result = ::ReadFile(m_h_pipe_in, buff, size, &nread, nullptr);
+    m_reading = false;
+    if (!result) {
+        if (::GetLastError() != ERROR_OPERATION_ABORTED) {
+            log_win32_error();
+        }
         return 0;
     }
     return nread;
 }
 
+bool Win32PseudoTerminal::wait_readable(int timeout_ms) {
+    // Anonymous pipes can't be waited on, so `read` blocks instead and `wake`
+    // cancels it with CancelSynchronousIo on the thread that waits here.
+    if (m_reader_thread.load() == nullptr) {
+        HANDLE reader_thread = nullptr;
+        ::DuplicateHandle(::GetCurrentProcess(), ::GetCurrentThread(),
+                          ::GetCurrentProcess(), &reader_thread, 0, FALSE,
+                          DUPLICATE_SAME_ACCESS);
+        m_reader_thread = reader_thread;
+    }
+    return is_valid() && !m_woken.exchange(false);
+}
+
+void Win32PseudoTerminal::wake() {
+    m_woken = true;
+    HANDLE reader_thread = m_reader_thread.load();
+    if (reader_thread == nullptr) {
+        return;
+    }
+    // Between its check of `m_woken` and ReadFile the reader has no I/O to
+    // cancel yet, so keep cancelling until it has left `read`.
+    while (m_reading.load()) {
+        ::CancelSynchronousIo(reader_thread);
+        std::this_thread::yield();
+    }
+}
+
+void Win32PseudoTerminal::_write_pending() {
+    while (m_write_queue.wait_pending()) {
+        m_write_queue.flush([this](const char* first, size_t first_size,
+                                   const char* second, size_t second_size) {
+            size_t total = 0;
+            for (auto [data, size] : {std::pair{first, first_size},
+                                      std::pair{second, second_size}}) {
+                if (size == 0) {
+                    break;
+                }
+                DWORD written = 0;
+                if (!::WriteFile(m_h_pipe_out, data, static_cast<DWORD>(size),
+                                 &written, nullptr)) {
+                    if (::GetLastError() != ERROR_OPERATION_ABORTED) {
+                        log_win32_error();
+                    }
+                    // The console is gone, drop the input instead of retrying.
+                    return first_size + second_size;
+                }
+                total += written;
+                if (written < size) {
+                    break;
+                }
+            }
+            return total;
+        });
+    }
+}
+
+void Win32PseudoTerminal::_stop_writer() {
+    m_write_queue.close();
+    if (m_writer_thread.joinable()) {
+        // Unblock a WriteFile stuck on a console that stopped reading.
+        ::CancelSynchronousIo(m_writer_thread.native_handle());
+        m_writer_thread.join();
+    }
+}
+
 bool Win32PseudoTerminal::resize(uint16_t row, uint16_t col) {
     if (m_h_pc == INVALID_HANDLE_VALUE) {
         return false;
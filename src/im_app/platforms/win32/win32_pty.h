@@ -1,6 +1,9 @@
 #pragma once
 
 #include "im_app/pty.h"
+#include "im_app/pty_write_queue.h"
+#include <atomic>
+#include <thread>
 // Block minwindef.h min/max macros to prevent <algorithm> conflict
 #define NOMINMAX
 #define WIN32_LEAN_AND_MEAN
@@ -18,12 +21,27 @@ class Win32PseudoTerminal : public PseudoTerminal {
     virtual bool is_valid() override;
     virtual size_t write(const void* buff, size_t size) override;
     virtual size_t read(void* buff, size_t size) override;
+    virtual bool wait_readable(int timeout_ms) override;
+    virtual void wake() override;
     virtual bool resize(uint16_t row, uint16_t col) override;
 
   private:
+    static constexpr size_t g_write_queue_capacity = 1024 * 1024;
+
     HPCON m_h_pc{INVALID_HANDLE_VALUE};
     HANDLE m_h_pipe_in{INVALID_HANDLE_VALUE};
     HANDLE m_h_pipe_out{INVALID_HANDLE_VALUE};
     PROCESS_INFORMATION m_cmd_pi;
+    std::atomic<HANDLE> m_reader_thread{nullptr};
+    std::atomic<bool> m_woken{false};
+    // Set from just before the reader checks `m_woken` until ReadFile returns
+    std::atomic<bool> m_reading{false};
+    // Anonymous pipes have no readiness notification, so input for the child
+    // is written by a thread of its own instead of the reader.
+    PtyWriteQueue m_write_queue{g_write_queue_capacity};
+    std::thread m_writer_thread;
+
+    void _write_pending();
+    void _stop_writer();
 };
 } // namespace ImApp
@@ -61,13 +61,25 @@ Win32Window::Win32Window(const WindowProps& props) { _initialize(props); }
 Win32Window::~Win32Window() { _finalize(); }
 
 void Win32Window::on_update() {
+    // Drain the queue, the next frame may be a long wait away.
     MSG msg = {};
-    if (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+    while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
 }
 
+void Win32Window::wait_events(double timeout_seconds) {
+    DWORD timeout_ms = timeout_seconds < 0.0
+                           ? INFINITE
+                           : static_cast<DWORD>(timeout_seconds * 1000.0);
+    MsgWaitForMultipleObjects(0, nullptr, FALSE, timeout_ms, QS_ALLINPUT);
+}
+
+void Win32Window::post_empty_event() {
+    ::PostMessage(m_hwnd, WM_NULL, 0, 0);
+}
+
 void Win32Window::minimize() { ::ShowWindow(m_hwnd, SW_MINIMIZE); }
 
 void Win32Window::set_titlebar_hovered(bool hovered) {
@@ -12,6 +12,8 @@ class Win32Window : public Window {
     explicit Win32Window(const WindowProps& props);
     virtual ~Win32Window() override;
     virtual void on_update() override;
+    virtual void wait_events(double timeout_seconds) override;
+    virtual void post_empty_event() override;
     virtual void minimize() override;
     virtual void set_titlebar_hovered(bool hovered) override;
     virtual uint32_t get_width() const override { return m_window_data.width; }
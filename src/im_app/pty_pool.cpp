@@ -0,0 +1,103 @@
+#include "im_app/pty_pool.h"
+#include <spdlog/spdlog.h>
+
+namespace ImApp {
+PseudoTerminalPool::PseudoTerminalPool(size_t size, uint16_t row, uint16_t col)
+    : m_size(size), m_row(row), m_col(col) {
+    if (m_size > 0) {
+        m_refilling = true;
+        m_refill_thread = std::thread(&PseudoTerminalPool::_refill, this);
+    }
+}
+
+PseudoTerminalPool::~PseudoTerminalPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_should_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_refill_thread.joinable()) {
+        m_refill_thread.join();
+    }
+    // Idle shells are terminated by their PTYs' destructors.
+    m_idle.clear();
+}
+
+std::shared_ptr<PseudoTerminal> PseudoTerminalPool::acquire(uint16_t row,
+                                                            uint16_t col) {
+    std::shared_ptr<PseudoTerminal> pty;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!pty) {
+            bool ready = m_cv.wait_for(lock, g_acquire_timeout, [this]() {
+                return !m_idle.empty() || !m_refilling;
+            });
+            if (!ready || m_idle.empty()) {
+                break;
+            }
+            pty = std::move(m_idle.front());
+            m_idle.pop_front();
+            if (!pty->is_valid()) {
+                // The shell exited while it was waiting in the pool, wait
+                // for its replacement.
+                pty.reset();
+                m_cv.notify_all();
+            }
+        }
+    }
+    // Let the refill thread replace what was taken.
+    m_cv.notify_all();
+    if (!pty) {
+        spdlog::warn("PTY pool is empty, launching a shell on demand.");
+        return PseudoTerminal::create();
+    }
+    if (row != m_row || col != m_col) {
+        pty->resize(row, col);
+    }
+    return pty;
+}
+
+size_t PseudoTerminalPool::idle_count() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_idle.size();
+}
+
+void PseudoTerminalPool::_refill() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait_for(lock, g_prune_period, [this]() {
+            return m_should_stop || m_idle.size() < m_size;
+        });
+        if (m_should_stop) {
+            break;
+        }
+        _prune_exited();
+        if (m_idle.size() >= m_size) {
+            continue;
+        }
+        lock.unlock();
+        auto pty = PseudoTerminal::create();
+        bool launched = pty->launch(m_row, m_col);
+        lock.lock();
+        if (!launched) {
+            // Don't spin on a shell that can't start, serve what is left.
+            spdlog::error("Failed to launch a pooled PTY, refilling stops.");
+            break;
+        }
+        m_idle.push_back(std::move(pty));
+        m_cv.notify_all();
+    }
+    m_refilling = false;
+    m_cv.notify_all();
+}
+
+void PseudoTerminalPool::_prune_exited() {
+    for (auto it = m_idle.begin(); it != m_idle.end();) {
+        if ((*it)->is_valid()) {
+            ++it;
+        } else {
+            it = m_idle.erase(it);
+        }
+    }
+}
+} // namespace ImApp
@@ -0,0 +1,76 @@
+#include "im_app/pty_write_queue.h"
+#include <cstring>
+
+namespace ImApp {
+PtyWriteQueue::PtyWriteQueue(size_t capacity)
+    : m_data(std::make_unique<char[]>(capacity)), m_capacity(capacity) {}
+
+size_t PtyWriteQueue::push(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    size_t accepted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed) {
+            return 0;
+        }
+        accepted = std::min(size, m_capacity - m_size);
+        size_t end = (m_begin + m_size) % m_capacity;
+        size_t first_size = std::min(accepted, m_capacity - end);
+        std::memcpy(&m_data[end], bytes, first_size);
+        std::memcpy(&m_data[0], bytes + first_size, accepted - first_size);
+        m_size += accepted;
+    }
+    if (accepted > 0) {
+        m_pending.notify_one();
+    }
+    return accepted;
+}
+
+PtyWriteQueue::Pending PtyWriteQueue::pending() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t first_size = std::min(m_size, m_capacity - m_begin);
+    return {.first = &m_data[m_begin],
+            .first_size = first_size,
+            .second = &m_data[0],
+            .second_size = m_size - first_size};
+}
+
+void PtyWriteQueue::drop(size_t size) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (size == 0 || m_closed) {
+        return;
+    }
+    size = std::min(size, m_size);
+    m_begin = (m_begin + size) % m_capacity;
+    m_size -= size;
+}
+
+bool PtyWriteQueue::wait_pending() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_pending.wait(lock, [this]() { return m_closed || m_size > 0; });
+    return !m_closed;
+}
+
+void PtyWriteQueue::close() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_size = 0;
+    }
+    m_pending.notify_all();
+}
+
+void PtyWriteQueue::reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = false;
+    m_begin = 0;
+    m_size = 0;
+}
+
+bool PtyWriteQueue::empty() const { return size() == 0; }
+
+size_t PtyWriteQueue::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size;
+}
+} // namespace ImApp
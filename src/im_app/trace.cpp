@@ -0,0 +1,154 @@
+#include "im_app/trace.h"
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <string>
+
+namespace ImApp {
+struct Tracer::ThreadBuffer {
+    struct Event {
+        const char* name;
+        int64_t begin_ns;
+        int64_t duration_ns;
+    };
+
+    uint32_t tid{0};
+    std::string name; // Guarded by `Tracer::m_mutex`
+    // Written by the owning thread only, read by `stop` up to `count`
+    std::unique_ptr<Event[]> events;
+    std::atomic<size_t> count{0};
+    std::atomic<size_t> dropped{0};
+    std::atomic<uint32_t> generation{0};
+};
+
+static int64_t to_ns(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               time.time_since_epoch())
+        .count();
+}
+
+static void write_json_string(std::ofstream& file, std::string_view text) {
+    file << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            file << '\\';
+        }
+        file << (static_cast<unsigned char>(c) < 0x20 ? ' ' : c);
+    }
+    file << '"';
+}
+
+Tracer& Tracer::instance() {
+    static Tracer s_instance;
+    return s_instance;
+}
+
+void Tracer::start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_start_time = std::chrono::steady_clock::now();
+    m_generation.fetch_add(1, std::memory_order_relaxed);
+    s_enabled.store(true, std::memory_order_release);
+    spdlog::info("[Tracer] Tracing started.");
+}
+
+bool Tracer::stop(const std::filesystem::path& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!s_enabled.exchange(false)) {
+        return false;
+    }
+    std::ofstream file(path);
+    if (!file) {
+        spdlog::error("[Tracer] Can't open '{}'.", path.string());
+        return false;
+    }
+    uint32_t generation = m_generation.load(std::memory_order_relaxed);
+    int64_t start_ns = to_ns(m_start_time);
+    size_t event_count = 0;
+    size_t dropped = 0;
+    bool first = true;
+    auto separator = [&first]() {
+        const char* text = first ? "\n" : ",\n";
+        first = false;
+        return text;
+    };
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (const auto& buffer : m_buffers) {
+        file << separator()
+             << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+             << buffer->tid << ",\"args\":{\"name\":";
+        write_json_string(file, buffer->name.empty()
+                                    ? "Thread " + std::to_string(buffer->tid)
+                                    : buffer->name);
+        file << "}}";
+        if (buffer->generation.load(std::memory_order_acquire) != generation) {
+            continue;
+        }
+        // Spans recorded while this runs are not published yet.
+        size_t count = buffer->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; i++) {
+            const auto& event = buffer->events[i];
+            // Chrome traces count in microseconds.
+            file << separator() << "{\"name\":";
+            write_json_string(file, event.name);
+            file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                 << ",\"ts\":" << (event.begin_ns - start_ns) / 1000.0
+                 << ",\"dur\":" << event.duration_ns / 1000.0 << "}";
+        }
+        event_count += count;
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    file << "\n]}\n";
+    spdlog::info("[Tracer] Wrote {} spans to '{}', {} dropped.", event_count,
+                 path.string(), dropped);
+    return static_cast<bool>(file);
+}
+
+void Tracer::set_thread_name(const char* name) {
+    auto& buffer = _thread_buffer();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    buffer.name = name;
+}
+
+void Tracer::record(const char* name,
+                    std::chrono::steady_clock::time_point begin,
+                    std::chrono::steady_clock::time_point end) {
+    if (!is_enabled()) {
+        return;
+    }
+    auto& buffer = _thread_buffer();
+    uint32_t generation = m_generation.load(std::memory_order_relaxed);
+    if (buffer.generation.load(std::memory_order_relaxed) != generation) {
+        buffer.count.store(0, std::memory_order_relaxed);
+        buffer.dropped.store(0, std::memory_order_relaxed);
+        buffer.generation.store(generation, std::memory_order_release);
+    }
+    size_t count = buffer.count.load(std::memory_order_relaxed);
+    if (count == g_events_per_thread) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (!buffer.events) {
+        buffer.events =
+            std::make_unique<ThreadBuffer::Event[]>(g_events_per_thread);
+    }
+    buffer.events[count] = {
+        .name = name,
+        .begin_ns = to_ns(begin),
+        .duration_ns = to_ns(end) - to_ns(begin),
+    };
+    buffer.count.store(count + 1, std::memory_order_release);
+}
+
+Tracer::ThreadBuffer& Tracer::_thread_buffer() {
+    thread_local ThreadBuffer* t_buffer = nullptr;
+    if (!t_buffer) {
+        // The tracer owns the buffer, so a trace can still be written after
+        // the thread exits.
+        auto buffer = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        buffer->tid = static_cast<uint32_t>(m_buffers.size() + 1);
+        m_buffers.push_back(buffer);
+        t_buffer = buffer.get();
+    }
+    return *t_buffer;
+}
+} // namespace ImApp
@@ -0,0 +1,76 @@
+#include "im_neovim/bracketed_paste_mode.h"
+
+namespace ImNeovim {
+void BracketedPasteMode::scan(const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        auto c = static_cast<unsigned char>(data[i]);
+        if (c == 0x1b) {
+            m_state = State::Escape;
+            continue;
+        }
+        if (c == 0x18 || c == 0x1a) {
+            // CAN and SUB abort a sequence
+            m_state = State::Ground;
+            continue;
+        }
+        switch (m_state) {
+        case State::Ground:
+            break;
+        case State::Escape:
+            if (c == '[') {
+                m_state = State::CsiStart;
+                m_param = 0;
+                m_matched = false;
+                m_bang = false;
+            } else {
+                if (c == 'c') {
+                    m_set.store(false, std::memory_order_relaxed); // RIS
+                }
+                m_state = State::Ground;
+            }
+            break;
+        case State::CsiStart:
+            if (c == '?') {
+                m_state = State::PrivateCsi;
+                break;
+            }
+            m_state = State::Csi;
+            [[fallthrough]];
+        case State::Csi:
+            if (c == '!') {
+                m_bang = true;
+            } else if (c >= 0x40 && c <= 0x7e) {
+                if (c == 'p' && m_bang) {
+                    m_set.store(false, std::memory_order_relaxed); // DECSTR
+                }
+                m_state = State::Ground;
+            }
+            break;
+        case State::PrivateCsi:
+            if (c >= '0' && c <= '9') {
+                if (m_param < g_max_param) {
+                    m_param = m_param * 10 + (c - '0');
+                }
+            } else if (c == ';' || c == ':') {
+                _finish_param();
+            } else if (c >= 0x40 && c <= 0x7e) {
+                _finish_param();
+                if (m_matched && (c == 'h' || c == 'l')) {
+                    m_set.store(c == 'h', std::memory_order_relaxed);
+                }
+                m_state = State::Ground;
+            } else if (c >= 0x20 && c <= 0x2f) {
+                // An intermediate makes it some other sequence.
+                m_state = State::Csi;
+            }
+            // Other C0 controls run inside a sequence without ending it.
+            break;
+        }
+    }
+}
+
+void BracketedPasteMode::_finish_param() {
+    m_matched = m_matched || m_param == g_mode;
+    m_param = 0;
+}
+} // namespace ImNeovim
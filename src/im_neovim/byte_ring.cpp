@@ -0,0 +1,66 @@
+#include "im_neovim/byte_ring.h"
+#include <im_app/trace.h>
+
+namespace ImNeovim {
+ByteRing::ByteRing(size_t slot_count)
+    : m_slots(std::make_unique<Slot[]>(slot_count)),
+      m_slot_count(slot_count) {}
+
+bool ByteRing::wait_for_space() {
+    while (!is_closed()) {
+        // Load the signal before checking so a release in between is seen.
+        uint32_t signal = m_space_signal.load(std::memory_order_acquire);
+        if (fill_level() < m_slot_count) {
+            return true;
+        }
+        // The consumer is behind, the producer stalls here.
+        IM_APP_TRACE_SCOPE("ByteRing::wait_for_space");
+        m_space_signal.wait(signal, std::memory_order_acquire);
+    }
+    return false;
+}
+
+char* ByteRing::acquire_slot() {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) >= m_slot_count) {
+        return nullptr;
+    }
+    return m_slots[head % m_slot_count].data;
+}
+
+void ByteRing::commit_slot(size_t size) {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    m_slots[head % m_slot_count].size = size;
+    m_head.store(head + 1, std::memory_order_release);
+
+    size_t fill = head + 1 - m_tail.load(std::memory_order_acquire);
+    if (fill > m_high_water_mark.load(std::memory_order_relaxed)) {
+        m_high_water_mark.store(fill, std::memory_order_relaxed);
+    }
+    _signal(m_data_signal);
+}
+
+bool ByteRing::wait_for_data() {
+    uint32_t signal = m_data_signal.load(std::memory_order_acquire);
+    if (fill_level() == 0) {
+        if (is_closed()) {
+            return false;
+        }
+        m_data_signal.wait(signal, std::memory_order_acquire);
+    }
+    return !is_closed() || fill_level() > 0;
+}
+
+void ByteRing::wake_consumer() { _signal(m_data_signal); }
+
+void ByteRing::close() {
+    m_closed.store(true, std::memory_order_release);
+    _signal(m_data_signal);
+    _signal(m_space_signal);
+}
+
+void ByteRing::_signal(std::atomic<uint32_t>& signal) {
+    signal.fetch_add(1, std::memory_order_release);
+    signal.notify_all();
+}
+} // namespace ImNeovim
@@ -0,0 +1,340 @@
+#include "im_neovim/gui/box_drawing.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace ImNeovim {
+namespace {
+// Classification of U+2500-U+259F. The kind is in the top four bits:
+//   lines:     arms in bits 0-7 (left, up, right, down, two bits each, see
+//              `Weight`), dashes - 1 in bits 8-9 or 0 for solid lines
+//   eighths:   `Edge` in bits 0-1, eighths of the cell in bits 4-7
+//   quadrants: `Quadrant` mask in bits 0-3
+//   shade:     level in bits 0-1, 1 light to 3 dark
+// 0 is left to the font.
+enum Kind : uint16_t {
+    KindLines = 1 << 12,
+    KindEighths = 2 << 12,
+    KindQuadrants = 3 << 12,
+    KindShade = 4 << 12,
+};
+enum Weight : uint16_t { WeightLight = 1, WeightHeavy = 2, WeightDouble = 3 };
+enum Edge : uint16_t { EdgeTop, EdgeBottom, EdgeLeft, EdgeRight };
+enum Quadrant : uint16_t {
+    QuadrantUpperLeft = 1 << 0,
+    QuadrantUpperRight = 1 << 1,
+    QuadrantLowerLeft = 1 << 2,
+    QuadrantLowerRight = 1 << 3,
+};
+
+constexpr uint16_t lines(uint16_t left, uint16_t up, uint16_t right,
+                         uint16_t down, uint16_t dashes = 0) {
+    return KindLines | left | up << 2 | right << 4 | down << 6 |
+           (dashes ? dashes - 1 : 0) << 8;
+}
+constexpr uint16_t eighths(uint16_t edge, uint16_t count) {
+    return KindEighths | edge | count << 4;
+}
+constexpr uint16_t quadrants(uint16_t mask) { return KindQuadrants | mask; }
+constexpr uint16_t shade(uint16_t level) { return KindShade | level; }
+
+using Rune = BoxDrawing::Rune;
+
+constexpr Rune g_box_first = 0x2500;
+constexpr Rune g_braille_first = 0x2800;
+constexpr size_t g_braille_count = 256;
+
+// clang-format off
+constexpr std::array<uint16_t, 160> g_box_table = {
+    // U+2500
+    lines(1, 0, 1, 0), lines(2, 0, 2, 0), lines(0, 1, 0, 1), lines(0, 2, 0, 2),
+    lines(1, 0, 1, 0, 3), lines(2, 0, 2, 0, 3),
+    lines(0, 1, 0, 1, 3), lines(0, 2, 0, 2, 3),
+    lines(1, 0, 1, 0, 4), lines(2, 0, 2, 0, 4),
+    lines(0, 1, 0, 1, 4), lines(0, 2, 0, 2, 4),
+    lines(0, 0, 1, 1), lines(0, 0, 2, 1), lines(0, 0, 1, 2), lines(0, 0, 2, 2),
+    // U+2510
+    lines(1, 0, 0, 1), lines(2, 0, 0, 1), lines(1, 0, 0, 2), lines(2, 0, 0, 2),
+    lines(0, 1, 1, 0), lines(0, 1, 2, 0), lines(0, 2, 1, 0), lines(0, 2, 2, 0),
+    lines(1, 1, 0, 0), lines(2, 1, 0, 0), lines(1, 2, 0, 0), lines(2, 2, 0, 0),
+    lines(0, 1, 1, 1), lines(0, 1, 2, 1), lines(0, 2, 1, 1), lines(0, 1, 1, 2),
+    // U+2520
+    lines(0, 2, 1, 2), lines(0, 2, 2, 1), lines(0, 1, 2, 2), lines(0, 2, 2, 2),
+    lines(1, 1, 0, 1), lines(2, 1, 0, 1), lines(1, 2, 0, 1), lines(1, 1, 0, 2),
+    lines(1, 2, 0, 2), lines(2, 2, 0, 1), lines(2, 1, 0, 2), lines(2, 2, 0, 2),
+    lines(1, 0, 1, 1), lines(2, 0, 1, 1), lines(1, 0, 2, 1), lines(2, 0, 2, 1),
+    // U+2530
+    lines(1, 0, 1, 2), lines(2, 0, 1, 2), lines(1, 0, 2, 2), lines(2, 0, 2, 2),
+    lines(1, 1, 1, 0), lines(2, 1, 1, 0), lines(1, 1, 2, 0), lines(2, 1, 2, 0),
+    lines(1, 2, 1, 0), lines(2, 2, 1, 0), lines(1, 2, 2, 0), lines(2, 2, 2, 0),
+    lines(1, 1, 1, 1), lines(2, 1, 1, 1), lines(1, 1, 2, 1), lines(2, 1, 2, 1),
+    // U+2540
+    lines(1, 2, 1, 1), lines(1, 1, 1, 2), lines(1, 2, 1, 2), lines(2, 2, 1, 1),
+    lines(1, 2, 2, 1), lines(2, 1, 1, 2), lines(1, 1, 2, 2), lines(2, 2, 2, 1),
+    lines(2, 1, 2, 2), lines(2, 2, 1, 2), lines(1, 2, 2, 2), lines(2, 2, 2, 2),
+    lines(1, 0, 1, 0, 2), lines(2, 0, 2, 0, 2),
+    lines(0, 1, 0, 1, 2), lines(0, 2, 0, 2, 2),
+    // U+2550
+    lines(3, 0, 3, 0), lines(0, 3, 0, 3), lines(0, 0, 3, 1), lines(0, 0, 1, 3),
+    lines(0, 0, 3, 3), lines(3, 0, 0, 1), lines(1, 0, 0, 3), lines(3, 0, 0, 3),
+    lines(0, 1, 3, 0), lines(0, 3, 1, 0), lines(0, 3, 3, 0), lines(3, 1, 0, 0),
+    lines(1, 3, 0, 0), lines(3, 3, 0, 0), lines(0, 1, 3, 1), lines(0, 3, 1, 3),
+    // U+2560
+    lines(0, 3, 3, 3), lines(3, 1, 0, 1), lines(1, 3, 0, 3), lines(3, 3, 0, 3),
+    lines(3, 0, 3, 1), lines(1, 0, 1, 3), lines(3, 0, 3, 3), lines(3, 1, 3, 0),
+    lines(1, 3, 1, 0), lines(3, 3, 3, 0), lines(3, 1, 3, 1), lines(1, 3, 1, 3),
+    // Arcs are drawn as square corners.
+    lines(3, 3, 3, 3), lines(0, 0, 1, 1), lines(1, 0, 0, 1), lines(1, 1, 0, 0),
+    // U+2570, diagonals are left to the font.
+    lines(0, 1, 1, 0), 0, 0, 0,
+    lines(1, 0, 0, 0), lines(0, 1, 0, 0), lines(0, 0, 1, 0), lines(0, 0, 0, 1),
+    lines(2, 0, 0, 0), lines(0, 2, 0, 0), lines(0, 0, 2, 0), lines(0, 0, 0, 2),
+    lines(1, 0, 2, 0), lines(0, 1, 0, 2), lines(2, 0, 1, 0), lines(0, 2, 0, 1),
+    // U+2580
+    eighths(EdgeTop, 4), eighths(EdgeBottom, 1), eighths(EdgeBottom, 2),
+    eighths(EdgeBottom, 3), eighths(EdgeBottom, 4), eighths(EdgeBottom, 5),
+    eighths(EdgeBottom, 6), eighths(EdgeBottom, 7), eighths(EdgeBottom, 8),
+    eighths(EdgeLeft, 7), eighths(EdgeLeft, 6), eighths(EdgeLeft, 5),
+    eighths(EdgeLeft, 4), eighths(EdgeLeft, 3), eighths(EdgeLeft, 2),
+    eighths(EdgeLeft, 1),
+    // U+2590
+    eighths(EdgeRight, 4), shade(1), shade(2), shade(3),
+    eighths(EdgeTop, 1), eighths(EdgeRight, 1),
+    quadrants(QuadrantLowerLeft), quadrants(QuadrantLowerRight),
+    quadrants(QuadrantUpperLeft),
+    quadrants(QuadrantUpperLeft | QuadrantLowerLeft | QuadrantLowerRight),
+    quadrants(QuadrantUpperLeft | QuadrantLowerRight),
+    quadrants(QuadrantUpperLeft | QuadrantUpperRight | QuadrantLowerLeft),
+    quadrants(QuadrantUpperLeft | QuadrantUpperRight | QuadrantLowerRight),
+    quadrants(QuadrantUpperRight),
+    quadrants(QuadrantUpperRight | QuadrantLowerLeft),
+    quadrants(QuadrantUpperRight | QuadrantLowerLeft | QuadrantLowerRight),
+};
+// clang-format on
+
+// Index into `BoxDrawing::m_ranges`, braille follows the box table.
+size_t table_index(Rune u) {
+    return u >= g_braille_first ? g_box_table.size() + (u - g_braille_first)
+                                : u - g_box_first;
+}
+
+// A line of `weight` across an axis, centered on `center`. Double lines
+// are two strokes one light width apart.
+struct Strokes {
+    std::array<float, 2> start{};
+    std::array<float, 2> end{};
+    int count{0};
+};
+Strokes strokes(int weight, float center, float light) {
+    Strokes result;
+    if (weight == WeightDouble) {
+        float start = center - std::floor(light * 3.0f / 2.0f);
+        result.start = {start, start + light * 2.0f};
+        result.end = {start + light, start + light * 3.0f};
+        result.count = 2;
+    } else if (weight != 0) {
+        float thickness = weight == WeightHeavy ? light * 2.0f : light;
+        float start = center - std::floor(thickness / 2.0f);
+        result.start[0] = start;
+        result.end[0] = start + thickness;
+        result.count = 1;
+    }
+    return result;
+}
+} // namespace
+
+bool BoxDrawing::handles(Rune u) {
+    if (u >= g_braille_first && u < g_braille_first + g_braille_count) {
+        return true;
+    }
+    return u >= g_box_first && u < g_box_first + g_box_table.size() &&
+           g_box_table[u - g_box_first] != 0;
+}
+
+void BoxDrawing::set_cell_size(const ImVec2& cell_size) {
+    if (cell_size.x == m_cell_size.x && cell_size.y == m_cell_size.y &&
+        !m_ranges.empty()) {
+        return;
+    }
+    m_cell_size = cell_size;
+    m_ranges.assign(g_box_table.size() + g_braille_count, {});
+    m_rects.clear();
+}
+
+std::span<const BoxDrawing::Rect> BoxDrawing::rects(Rune u) {
+    if (!handles(u) || m_ranges.empty()) {
+        return {};
+    }
+    Range& range = m_ranges[table_index(u)];
+    if (!range.built) {
+        range.offset = static_cast<uint32_t>(m_rects.size());
+        _build(u, m_rects);
+        range.count = static_cast<uint32_t>(m_rects.size()) - range.offset;
+        range.built = true;
+    }
+    return {m_rects.data() + range.offset, range.count};
+}
+
+void BoxDrawing::_build(Rune u, std::vector<Rect>& rects) const {
+    if (u >= g_braille_first) {
+        _build_braille(static_cast<uint8_t>(u - g_braille_first), rects);
+        return;
+    }
+    uint16_t entry = g_box_table[u - g_box_first];
+    float w = m_cell_size.x;
+    float h = m_cell_size.y;
+    switch (entry & 0xF000) {
+    case KindLines:
+        _build_lines(entry, rects);
+        break;
+    case KindEighths: {
+        float count = static_cast<float>((entry >> 4) & 0xF);
+        float x = w * count / 8.0f;
+        float y = h * count / 8.0f;
+        switch (entry & 3) {
+        case EdgeTop:
+            rects.push_back({ImVec2(0, 0), ImVec2(w, y)});
+            break;
+        case EdgeBottom:
+            rects.push_back({ImVec2(0, h - y), ImVec2(w, h)});
+            break;
+        case EdgeLeft:
+            rects.push_back({ImVec2(0, 0), ImVec2(x, h)});
+            break;
+        case EdgeRight:
+            rects.push_back({ImVec2(w - x, 0), ImVec2(w, h)});
+            break;
+        }
+        break;
+    }
+    case KindQuadrants: {
+        float mx = w / 2.0f;
+        float my = h / 2.0f;
+        if (entry & QuadrantUpperLeft) {
+            rects.push_back({ImVec2(0, 0), ImVec2(mx, my)});
+        }
+        if (entry & QuadrantUpperRight) {
+            rects.push_back({ImVec2(mx, 0), ImVec2(w, my)});
+        }
+        if (entry & QuadrantLowerLeft) {
+            rects.push_back({ImVec2(0, my), ImVec2(mx, h)});
+        }
+        if (entry & QuadrantLowerRight) {
+            rects.push_back({ImVec2(mx, my), ImVec2(w, h)});
+        }
+        break;
+    }
+    case KindShade:
+        rects.push_back({ImVec2(0, 0), ImVec2(w, h),
+                         static_cast<float>(entry & 3) / 4.0f});
+        break;
+    default:
+        break;
+    }
+}
+
+void BoxDrawing::_build_lines(uint16_t lines, std::vector<Rect>& rects) const {
+    int left = lines & 3;
+    int up = (lines >> 2) & 3;
+    int right = (lines >> 4) & 3;
+    int down = (lines >> 6) & 3;
+    int dashes = (lines >> 8) & 3;
+    dashes = dashes ? dashes + 1 : 0;
+    float light = std::max(
+        1.0f, std::round(std::min(m_cell_size.x, m_cell_size.y) / 8.0f));
+
+    // Horizontal arms first, then the vertical ones with the axes swapped.
+    for (bool vertical : {false, true}) {
+        float length = vertical ? m_cell_size.y : m_cell_size.x;
+        float breadth = vertical ? m_cell_size.x : m_cell_size.y;
+        int negative = vertical ? up : left;
+        int positive = vertical ? down : right;
+        int cross_negative = vertical ? left : up;
+        int cross_positive = vertical ? right : down;
+        float center = std::floor(length / 2.0f);
+        float middle = std::floor(breadth / 2.0f);
+        Strokes cross[2] = {strokes(cross_negative, center, light),
+                            strokes(cross_positive, center, light)};
+        bool through = cross[0].count && cross[1].count;
+        auto add = [&](float a0, float a1, float b0, float b1) {
+            ImVec2 p0(a0, b0);
+            ImVec2 p1(a1, b1);
+            if (vertical) {
+                std::swap(p0.x, p0.y);
+                std::swap(p1.x, p1.y);
+            }
+            rects.push_back({p0, p1});
+        };
+
+        if (dashes && negative) {
+            // Gaps at both ends, so dashes repeat evenly across cells.
+            Strokes own = strokes(negative, middle, light);
+            float period = length / static_cast<float>(dashes);
+            float gap = std::max(1.0f, std::round(period / 3.0f));
+            float dash = std::max(1.0f, std::floor(period - gap));
+            for (int i = 0; i < dashes; i++) {
+                float start = std::floor(period * i + gap / 2.0f);
+                add(start, start + dash, own.start[0], own.end[0]);
+            }
+            continue;
+        }
+        // A stroke of a double line stops at the inner stroke of a double
+        // line crossing on its side. Lines going through meet at the
+        // center, other arms cover the crossing lines, only up to their
+        // near edge when those go through.
+        const Strokes& only = cross[0].count ? cross[0] : cross[1];
+        if (negative) {
+            Strokes own = strokes(negative, middle, light);
+            for (int stroke = 0; stroke < own.count; stroke++) {
+                int side = stroke == 0 ? cross_negative : cross_positive;
+                float end = center;
+                if (own.count == 2 && side == WeightDouble) {
+                    end = strokes(side, center, light).end[0];
+                } else if (positive) {
+                    end = center;
+                } else if (through) {
+                    end = std::max(cross[0].end[0], cross[1].end[0]);
+                } else if (only.count) {
+                    end = only.end[only.count - 1];
+                }
+                add(0.0f, end, own.start[stroke], own.end[stroke]);
+            }
+        }
+        if (positive) {
+            Strokes own = strokes(positive, middle, light);
+            for (int stroke = 0; stroke < own.count; stroke++) {
+                int side = stroke == 0 ? cross_negative : cross_positive;
+                float start = center;
+                if (own.count == 2 && side == WeightDouble) {
+                    start = strokes(side, center, light).start[1];
+                } else if (negative) {
+                    start = center;
+                } else if (through) {
+                    start = std::min(cross[0].start[cross[0].count - 1],
+                                     cross[1].start[cross[1].count - 1]);
+                } else if (only.count) {
+                    start = only.start[0];
+                }
+                add(start, length, own.start[stroke], own.end[stroke]);
+            }
+        }
+    }
+}
+
+void BoxDrawing::_build_braille(uint8_t dots, std::vector<Rect>& rects) const {
+    // Bits 0-2 and 6 are the left column from the top, 3-5 and 7 the right.
+    static constexpr int g_dot_column[8] = {0, 0, 0, 1, 1, 1, 0, 1};
+    static constexpr int g_dot_row[8] = {0, 1, 2, 0, 1, 2, 3, 3};
+    float w = m_cell_size.x;
+    float h = m_cell_size.y;
+    float size = std::max(1.0f, std::round(std::min(w / 4.0f, h / 8.0f)));
+    for (int bit = 0; bit < 8; bit++) {
+        if (!(dots & (1 << bit))) {
+            continue;
+        }
+        float x = std::round(w * (1 + 2 * g_dot_column[bit]) / 4.0f - size / 2);
+        float y = std::round(h * (1 + 2 * g_dot_row[bit]) / 8.0f - size / 2);
+        rects.push_back({ImVec2(x, y), ImVec2(x + size, y + size)});
+    }
+}
+} // namespace ImNeovim
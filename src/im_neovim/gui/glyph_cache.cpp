@@ -0,0 +1,369 @@
+#include "im_neovim/gui/glyph_cache.h"
+#include "im_neovim/logging.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <imgui_internal.h>
+
+// ImGui compiles its own copy with STBTT_STATIC, this one stays private
+// to this file as well.
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include <imstb_truetype.h>
+
+namespace ImNeovim {
+// Slots evicted at once when the atlas is full, as a fraction of all
+// slots. Evicting in batches keeps a stream of new glyphs from evicting on
+// every frame.
+static constexpr uint32_t g_eviction_divisor = 8;
+
+struct GlyphCache::FontFace {
+    std::vector<unsigned char> data; // Empty if the caller owns the data
+    stbtt_fontinfo info{};
+};
+
+GlyphCache::GlyphCache() : m_texture(std::make_unique<ImTextureData>()) {
+    m_texture->Create(ImTextureFormat_RGBA32, g_atlas_size, g_atlas_size);
+    std::memset(m_texture->GetPixels(), 0, m_texture->GetSizeInBytes());
+    ImGui::RegisterUserTexture(m_texture.get());
+}
+
+GlyphCache::~GlyphCache() {
+    // The backend frees the GPU texture of registered textures on shutdown.
+    ImGui::UnregisterUserTexture(m_texture.get());
+}
+
+bool GlyphCache::add_font(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        LOG_ERROR("Failed to open font '{}'.", path.string());
+        return false;
+    }
+    auto face = std::make_unique<FontFace>();
+    face->data.assign(std::istreambuf_iterator<char>(file),
+                      std::istreambuf_iterator<char>());
+    const unsigned char* data = face->data.data();
+    if (face->data.empty() ||
+        !stbtt_InitFont(&face->info, data,
+                        stbtt_GetFontOffsetForIndex(data, 0))) {
+        LOG_ERROR("'{}' is not a TrueType font.", path.string());
+        return false;
+    }
+    m_fonts.push_back(std::move(face));
+    return true;
+}
+
+bool GlyphCache::add_font(const void* data, size_t size) {
+    auto face = std::make_unique<FontFace>();
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    if (size == 0 ||
+        !stbtt_InitFont(&face->info, bytes,
+                        stbtt_GetFontOffsetForIndex(bytes, 0))) {
+        return false;
+    }
+    m_fonts.push_back(std::move(face));
+    return true;
+}
+
+void GlyphCache::begin_frame(const ImVec2& cell_size, float font_size) {
+    m_frame++;
+    if (cell_size.x != m_cell_size.x || cell_size.y != m_cell_size.y ||
+        font_size != m_font_size) {
+        m_cell_size = cell_size;
+        m_font_size = font_size;
+        _reset();
+    }
+    // ImGui only resets the atlases it owns after the backend uploaded them.
+    if (m_texture->Status == ImTextureStatus_OK &&
+        !m_texture->Updates.empty()) {
+        m_texture->Updates.clear();
+        m_texture->UpdateRect = {};
+    }
+}
+
+void GlyphCache::_reset() {
+    m_slot_width = std::max(1, static_cast<int>(std::ceil(m_cell_size.x)));
+    m_slot_height = std::max(1, static_cast<int>(std::ceil(m_cell_size.y)));
+    m_slots_per_row = g_atlas_size / m_slot_width;
+    int rows = g_atlas_size / m_slot_height;
+    m_slots.assign(static_cast<size_t>(m_slots_per_row) * rows, {});
+    // Handed out from slot 0 on
+    m_box_drawing.set_cell_size(ImVec2(static_cast<float>(m_slot_width),
+                                       static_cast<float>(m_slot_height)));
+    m_free_slots.resize(m_slots.size());
+    for (size_t i = 0; i < m_free_slots.size(); i++) {
+        m_free_slots[i] = static_cast<uint32_t>(m_free_slots.size() - 1 - i);
+    }
+    m_lru_head = g_no_slot;
+    m_lru_tail = g_no_slot;
+    m_pages.clear();
+    m_last_page = nullptr;
+    m_epoch++;
+}
+
+uint32_t GlyphCache::find(Rune u, uint8_t style) {
+    if (m_fonts.empty() || m_slots.empty()) {
+        return g_no_slot;
+    }
+    uint32_t page_key = static_cast<uint32_t>(style) << 24 | (u >> 8);
+    uint32_t index = u & 0xFF;
+    if (Page* page = _find_page(page_key); page && page->slots[index]) {
+        uint32_t slot = page->slots[index] - 1;
+        touch(slot);
+        return slot;
+    }
+    // May evict, and with it erase pages.
+    uint32_t slot = _allocate_slot();
+    if (slot == g_no_slot) {
+        return g_no_slot;
+    }
+    Page& page = m_pages[page_key];
+    page.slots[index] = slot + 1;
+    page.used++;
+    m_last_page_key = page_key;
+    m_last_page = &page;
+    m_slots[slot].key = static_cast<uint64_t>(u) << 8 | style;
+    _rasterize(slot, u, style);
+    _link_front(slot);
+    m_slots[slot].last_used = m_frame;
+    return slot;
+}
+
+void GlyphCache::touch(uint32_t slot) {
+    // Evicted slots have no key, code point 0 is never cached.
+    if (slot >= m_slots.size() || m_slots[slot].key == 0) {
+        return;
+    }
+    m_slots[slot].last_used = m_frame;
+    if (m_lru_head != slot) {
+        _unlink(slot);
+        _link_front(slot);
+    }
+}
+
+ImTextureRef GlyphCache::texture_ref() const {
+    return m_texture->GetTexRef();
+}
+
+ImVec2 GlyphCache::slot_size() const {
+    return {static_cast<float>(m_slot_width),
+            static_cast<float>(m_slot_height)};
+}
+
+void GlyphCache::slot_uv(uint32_t slot, ImVec2& uv0, ImVec2& uv1) const {
+    float x = static_cast<float>(slot % m_slots_per_row * m_slot_width);
+    float y = static_cast<float>(slot / m_slots_per_row * m_slot_height);
+    uv0 = ImVec2(x / g_atlas_size, y / g_atlas_size);
+    uv1 = ImVec2((x + m_slot_width) / g_atlas_size,
+                 (y + m_slot_height) / g_atlas_size);
+}
+
+GlyphCache::Page* GlyphCache::_find_page(uint32_t page_key) {
+    if (m_last_page && m_last_page_key == page_key) {
+        return m_last_page;
+    }
+    auto it = m_pages.find(page_key);
+    if (it == m_pages.end()) {
+        return nullptr;
+    }
+    m_last_page_key = page_key;
+    m_last_page = &it->second;
+    return m_last_page;
+}
+
+uint32_t GlyphCache::_allocate_slot() {
+    if (m_free_slots.empty()) {
+        _evict();
+    }
+    if (m_free_slots.empty()) {
+        return g_no_slot;
+    }
+    uint32_t slot = m_free_slots.back();
+    m_free_slots.pop_back();
+    return slot;
+}
+
+void GlyphCache::_evict() {
+    auto budget = std::max<uint32_t>(1, slot_count() / g_eviction_divisor);
+    // Glyphs used in this frame may already be drawn.
+    while (budget > 0 && m_lru_tail != g_no_slot &&
+           m_slots[m_lru_tail].last_used < m_frame) {
+        uint32_t slot = m_lru_tail;
+        _unlink(slot);
+        uint64_t key = m_slots[slot].key;
+        auto page_key = static_cast<uint32_t>((key & 0xFF) << 24 | key >> 16);
+        auto it = m_pages.find(page_key);
+        if (it != m_pages.end()) {
+            it->second.slots[(key >> 8) & 0xFF] = 0;
+            if (--it->second.used == 0) {
+                if (m_last_page == &it->second) {
+                    m_last_page = nullptr;
+                }
+                m_pages.erase(it);
+            }
+        }
+        m_slots[slot].key = 0;
+        m_free_slots.push_back(slot);
+        budget--;
+    }
+}
+
+void GlyphCache::_unlink(uint32_t slot) {
+    Slot& entry = m_slots[slot];
+    if (entry.prev != g_no_slot) {
+        m_slots[entry.prev].next = entry.next;
+    } else if (m_lru_head == slot) {
+        m_lru_head = entry.next;
+    }
+    if (entry.next != g_no_slot) {
+        m_slots[entry.next].prev = entry.prev;
+    } else if (m_lru_tail == slot) {
+        m_lru_tail = entry.prev;
+    }
+    entry.prev = g_no_slot;
+    entry.next = g_no_slot;
+}
+
+void GlyphCache::_link_front(uint32_t slot) {
+    Slot& entry = m_slots[slot];
+    entry.prev = g_no_slot;
+    entry.next = m_lru_head;
+    if (m_lru_head != g_no_slot) {
+        m_slots[m_lru_head].prev = slot;
+    }
+    m_lru_head = slot;
+    if (m_lru_tail == g_no_slot) {
+        m_lru_tail = slot;
+    }
+}
+
+void GlyphCache::_rasterize(uint32_t slot, Rune u, uint8_t style) {
+    bool wide = style & (StyleWideLeft | StyleWideRight);
+    int canvas_width = m_slot_width * (wide ? 2 : 1);
+    m_canvas.assign(static_cast<size_t>(canvas_width) * m_slot_height, 0);
+    if (!wide && BoxDrawing::handles(u)) {
+        _rasterize_box(u);
+    } else {
+        _rasterize_font(u, style, canvas_width);
+    }
+
+    int source_x = (style & StyleWideRight) ? m_slot_width : 0;
+    int slot_x = static_cast<int>(slot % m_slots_per_row) * m_slot_width;
+    int slot_y = static_cast<int>(slot / m_slots_per_row) * m_slot_height;
+    for (int y = 0; y < m_slot_height; y++) {
+        auto* pixels =
+            static_cast<ImU32*>(m_texture->GetPixelsAt(slot_x, slot_y + y));
+        const unsigned char* coverage =
+            &m_canvas[y * canvas_width + source_x];
+        for (int x = 0; x < m_slot_width; x++) {
+            pixels[x] = IM_COL32(255, 255, 255, coverage[x]);
+        }
+    }
+    _queue_upload(slot_x, slot_y, m_slot_width, m_slot_height);
+}
+
+void GlyphCache::_rasterize_box(Rune u) {
+    // Pixels whose centers are inside, like the GPU fills the rects
+    for (const BoxDrawing::Rect& rect : m_box_drawing.rects(u)) {
+        auto coverage = static_cast<unsigned char>(rect.alpha * 255.0f);
+        auto x0 = static_cast<int>(std::round(rect.p0.x));
+        auto y0 = static_cast<int>(std::round(rect.p0.y));
+        auto x1 = static_cast<int>(std::round(rect.p1.x));
+        auto y1 = static_cast<int>(std::round(rect.p1.y));
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, m_slot_width);
+        y1 = std::min(y1, m_slot_height);
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                unsigned char& pixel = m_canvas[y * m_slot_width + x];
+                pixel = std::max(pixel, coverage);
+            }
+        }
+    }
+}
+
+void GlyphCache::_rasterize_font(Rune u, uint8_t style, int canvas_width) {
+    // The first font with the glyph, or the first font's missing glyph
+    const FontFace* face = m_fonts.front().get();
+    int glyph = 0;
+    for (const auto& font : m_fonts) {
+        int index = stbtt_FindGlyphIndex(&font->info, static_cast<int>(u));
+        if (index != 0) {
+            face = font.get();
+            glyph = index;
+            break;
+        }
+    }
+    // Same metrics as ImGui's own stb_truetype loader
+    float scale = stbtt_ScaleForPixelHeight(&face->info, m_font_size);
+    int ascent = 0;
+    stbtt_GetFontVMetrics(&face->info, &ascent, nullptr, nullptr);
+    int baseline = static_cast<int>(std::ceil(ascent * scale));
+
+    int x0 = 0;
+    int y0 = 0;
+    int x1 = 0;
+    int y1 = 0;
+    stbtt_GetGlyphBitmapBox(&face->info, glyph, scale, scale, &x0, &y0, &x1,
+                            &y1);
+    int width = x1 - x0;
+    int height = y1 - y0;
+    if (width > 0 && height > 0) {
+        m_bitmap.resize(static_cast<size_t>(width) * height);
+        stbtt_MakeGlyphBitmap(&face->info, m_bitmap.data(), width, height,
+                              width, scale, scale, glyph);
+        // Pen at the left edge of the cell, clipped to the canvas
+        for (int y = 0; y < height; y++) {
+            int canvas_y = baseline + y0 + y;
+            if (canvas_y < 0 || canvas_y >= m_slot_height) {
+                continue;
+            }
+            for (int x = 0; x < width; x++) {
+                int canvas_x = x0 + x;
+                if (canvas_x >= 0 && canvas_x < canvas_width) {
+                    m_canvas[canvas_y * canvas_width + canvas_x] =
+                        m_bitmap[y * width + x];
+                }
+            }
+        }
+    }
+    if (style & StyleBold) {
+        // No bold face, so strokes are widened by a pixel instead.
+        for (int y = 0; y < m_slot_height; y++) {
+            unsigned char* row = &m_canvas[y * canvas_width];
+            for (int x = canvas_width - 1; x > 0; x--) {
+                row[x] = std::max(row[x], row[x - 1]);
+            }
+        }
+    }
+}
+
+void GlyphCache::_queue_upload(int x, int y, int width, int height) {
+    // A texture that is yet to be created is uploaded whole.
+    if (m_texture->Status != ImTextureStatus_OK &&
+        m_texture->Status != ImTextureStatus_WantUpdates) {
+        return;
+    }
+    ImTextureRect rect{
+        static_cast<unsigned short>(x),
+        static_cast<unsigned short>(y),
+        static_cast<unsigned short>(width),
+        static_cast<unsigned short>(height),
+    };
+    ImTextureRect& bounds = m_texture->UpdateRect;
+    if (m_texture->Updates.empty()) {
+        bounds = rect;
+    } else {
+        int right = std::max(bounds.x + bounds.w, rect.x + rect.w);
+        int bottom = std::max(bounds.y + bounds.h, rect.y + rect.h);
+        bounds.x = std::min(bounds.x, rect.x);
+        bounds.y = std::min(bounds.y, rect.y);
+        bounds.w = static_cast<unsigned short>(right - bounds.x);
+        bounds.h = static_cast<unsigned short>(bottom - bounds.y);
+    }
+    m_texture->Updates.push_back(rect);
+    m_texture->Status = ImTextureStatus_WantUpdates;
+}
+} // namespace ImNeovim
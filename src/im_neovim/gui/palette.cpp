@@ -0,0 +1,95 @@
+#include "im_neovim/gui/palette.h"
+#include <algorithm>
+#include <charconv>
+#include <fmt/format.h>
+
+namespace ImNeovim {
+void Palette::rebuild(const ImVec4 (&ansi)[16], bool dark_mode,
+                      const Colors& overrides) {
+    for (int i = 0; i < g_size; i++) {
+        m_colors[i] =
+            overrides[i] ? overrides[i] : default_color(i, ansi, dark_mode);
+    }
+    m_version++;
+}
+
+void Palette::resolve_row(const VTermScreenCell* cells, int count, ImU32* fg,
+                          ImU32* bg) const {
+    for (int x = 0; x < count; x++) {
+        fg[x] = resolve(cells[x].fg, g_default_fg);
+        bg[x] = resolve(cells[x].bg, g_default_bg);
+    }
+}
+
+ImU32 Palette::default_color(int index, const ImVec4 (&ansi)[16],
+                             bool dark_mode) {
+    static constexpr int g_cube_levels[6] = {0, 95, 135, 175, 215, 255};
+    if (index == g_default_fg) {
+        return dark_mode ? IM_COL32_WHITE : IM_COL32_BLACK;
+    }
+    if (index == g_default_bg) {
+        return dark_mode ? IM_COL32_BLACK : IM_COL32_WHITE;
+    }
+    if (index < 16) {
+        return ImGui::ColorConvertFloat4ToU32(ansi[index]);
+    }
+    if (index < 232) {
+        int cube = index - 16;
+        return IM_COL32(g_cube_levels[cube / 36], g_cube_levels[cube / 6 % 6],
+                        g_cube_levels[cube % 6], 255);
+    }
+    int gray = 8 + (index - 232) * 10;
+    return IM_COL32(gray, gray, gray, 255);
+}
+
+bool Palette::parse_color(std::string_view spec, ImU32& color) {
+    // Scales a channel of `digits` hex digits to 8 bits.
+    auto channel = [](std::string_view hex, int& value) {
+        if (hex.empty() || hex.size() > 4) {
+            return false;
+        }
+        unsigned parsed = 0;
+        auto [end, error] =
+            std::from_chars(hex.data(), hex.data() + hex.size(), parsed, 16);
+        if (error != std::errc() || end != hex.data() + hex.size()) {
+            return false;
+        }
+        unsigned max = (1u << (hex.size() * 4)) - 1;
+        value = static_cast<int>((parsed * 255 + max / 2) / max);
+        return true;
+    };
+    int rgb[3];
+    if (spec.starts_with("rgb:")) {
+        spec.remove_prefix(4);
+        for (int i = 0; i < 3; i++) {
+            size_t slash = i < 2 ? spec.find('/') : spec.size();
+            if (slash == std::string_view::npos ||
+                !channel(spec.substr(0, slash), rgb[i])) {
+                return false;
+            }
+            spec.remove_prefix(std::min(slash + 1, spec.size()));
+        }
+    } else if (spec.starts_with('#') && spec.size() > 1 &&
+               (spec.size() - 1) % 3 == 0 && spec.size() - 1 <= 12) {
+        size_t digits = (spec.size() - 1) / 3;
+        for (int i = 0; i < 3; i++) {
+            if (!channel(spec.substr(1 + i * digits, digits), rgb[i])) {
+                return false;
+            }
+        }
+    } else {
+        return false;
+    }
+    color = IM_COL32(rgb[0], rgb[1], rgb[2], 255);
+    return true;
+}
+
+std::string Palette::format_color(ImU32 color) {
+    // 8-bit channels repeated to 16 bits, like xterm does
+    auto channel = [color](int shift) {
+        return ((color >> shift) & 0xFF) * 0x101;
+    };
+    return fmt::format("rgb:{:04x}/{:04x}/{:04x}", channel(IM_COL32_R_SHIFT),
+                       channel(IM_COL32_G_SHIFT), channel(IM_COL32_B_SHIFT));
+}
+} // namespace ImNeovim
@@ -0,0 +1,39 @@
+#include "im_neovim/gui/scrollback.h"
+
+namespace ImNeovim {
+void Scrollback::push(int cols, const VTermScreenCell* cells,
+                      uint64_t version) {
+    if (m_capacity == 0) {
+        m_first_line++;
+        return;
+    }
+    Line* line = nullptr;
+    if (m_size < m_lines.size()) {
+        // A slot left by `pop_back` or `clear`
+        line = &m_lines[_slot(m_size)];
+        m_size++;
+    } else if (m_lines.size() < m_capacity) {
+        line = &m_lines.emplace_back();
+        m_size++;
+    } else {
+        // Full, the oldest line makes room.
+        line = &m_lines[m_head];
+        m_head = m_head + 1 < m_lines.size() ? m_head + 1 : 0;
+        m_first_line++;
+    }
+    line->cells.assign(cells, cells + cols);
+    line->version = version;
+}
+
+void Scrollback::pop_back() {
+    if (m_size > 0) {
+        m_size--;
+    }
+}
+
+void Scrollback::clear() {
+    m_first_line += static_cast<int64_t>(m_size);
+    m_head = 0;
+    m_size = 0;
+}
+} // namespace ImNeovim
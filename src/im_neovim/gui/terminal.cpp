@@ -1,5 +1,11 @@
 #include "im_neovim/gui/terminal.h"
 #include "im_neovim/logging.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <im_app/application.h>
+#include <im_app/trace.h>
 #include <fmt/ranges.h>
 #include <type_traits>
 
@@ -10,12 +16,15 @@ namespace ImNeovim {
 #define ISCONTROLC1(c) (BETWEEN(c, 0x80, 0x9f))
 #define ISCONTROL(c) (ISCONTROLC0(c) || ISCONTROLC1(c))
 
-Terminal::Terminal() : m_window_title("Terminal"), m_dark_mode(true) {
-    m_pty = ImApp::PseudoTerminal::create();
+Terminal::Terminal(std::shared_ptr<ImApp::PseudoTerminal> pty)
+    : m_window_title("Terminal"), m_dark_mode(true), m_pty(std::move(pty)) {
+    if (!m_pty) {
+        m_pty = ImApp::PseudoTerminal::create();
+    }
 
     // Initialize with safe default size
-    m_state.row = 24;
-    m_state.col = 80;
+    m_state.row = g_default_rows;
+    m_state.col = g_default_cols;
     m_state.bot = m_state.row - 1;
     m_selection.mode = SelectionIdle;
     m_selection.type = SelectionRegular;
@@ -57,21 +66,32 @@ Terminal::Terminal() : m_window_title("Terminal"), m_dark_mode(true) {
     m_vterm_screen_callbacks.sb_popline = _vterm_sb_popline;
     m_vterm_screen_callbacks.sb_clear = _vterm_sb_clear;
     vterm_screen_set_callbacks(m_vterm_screen, &m_vterm_screen_callbacks, this);
+    m_vterm_fallbacks.osc = _vterm_osc;
+    vterm_screen_set_unrecognised_fallbacks(m_vterm_screen, &m_vterm_fallbacks,
+                                            this);
 
     vterm_screen_set_damage_merge(m_vterm_screen, VTERM_DAMAGE_SCROLL);
     vterm_screen_reset(m_vterm_screen, 1);
     vterm_output_set_callback(m_vterm, _vterm_output, this);
+
+    // Give the first frame something to draw before any output arrives.
+    _publish_snapshot();
+    m_view = &m_snapshots.acquire();
 }
 
 Terminal::~Terminal() {
     m_should_terminate = true;
-    /* We need to write somethting into the `m_pty`,
-     * otherwise the `m_read_thread` can't be joined.
-     */
-    process_input("exit\r");
+    // Interrupt the reader blocked in `wait_readable` so it can be joined.
+    m_pty->wake();
+    m_output_ring.close();
     if (m_read_thread.joinable()) {
         m_read_thread.join();
     }
+    if (m_parse_thread.joinable()) {
+        m_parse_thread.join();
+    }
+    LOG_DEBUG("Output ring high-water mark: {}/{} slots.",
+              m_output_ring.high_water_mark(), m_output_ring.capacity());
     if (m_vterm) {
         vterm_free(m_vterm);
     }
@@ -87,9 +107,13 @@ void Terminal::render() {
     if (!m_is_visible) {
         return;
     }
-    if (!m_pty->is_valid()) {
+    if (!m_read_thread.joinable()) {
         _start_shell();
     }
+    if (m_paste.is_active() &&
+        !m_paste.pump(*m_pty, g_paste_budget_per_frame)) {
+        LOG_DEBUG("Pasted {} bytes.", m_paste.size());
+    }
 
     _check_font_size_changed();
     bool window_created = _setup_window();
@@ -98,10 +122,21 @@ void Terminal::render() {
     if (window_created && (m_is_embedded || !m_embedded_window_collapsed)) {
         ImGuiIO& io = ImGui::GetIO();
         _handle_terminal_resize();
+        if (m_publish_pending) {
+            // Let a throttled parser publish what it held back.
+            m_output_ring.wake_consumer();
+        }
+        // Keys first, so their echo can make it into this frame.
+        _handle_keyboard_input(io);
+        _wait_for_echo();
+        m_view = &m_snapshots.acquire();
+        if (m_echo.awaiting && m_view->sequence > m_echo.sequence) {
+            m_echo.awaiting = false;
+            m_echo.drawn = true;
+        }
         _render_buffer();
-        _handle_scrollback(io, m_state.row);
+        _handle_scrollback(io);
         _handle_mouse_input(io);
-        _handle_keyboard_input(io);
     }
 
     // Only call End() if Begin() was actually called and succeeded
@@ -111,18 +146,9 @@ void Terminal::render() {
 }
 
 void Terminal::resize(int cols, int rows) {
-    std::lock_guard<std::mutex> lock(m_buffer_mutex);
-    // Get actual content area size
-    ImVec2 content_size = ImGui::GetContentRegionAvail();
-    float char_width = ImGui::GetFontBaked()->GetCharAdvance('M');
-    float line_height = ImGui::GetTextLineHeight();
-
-    // Calculate new dimensions based on actual font metrics
-    int new_cols = std::max(1, static_cast<int>(content_size.x / char_width));
-    int new_rows = std::max(1, static_cast<int>(content_size.y / line_height));
-
+    auto lock = _lock_buffer();
     // Only resize if dimensions actually changed
-    if (new_cols == m_state.col && new_rows == m_state.row) {
+    if (cols == m_state.col && rows == m_state.row) {
         return;
     }
 
@@ -191,23 +217,93 @@ void Terminal::resize(int cols, int rows) {
     }
     vterm_set_size(m_vterm, m_state.row, m_state.col);
     vterm_screen_flush_damage(m_vterm_screen);
+    if (m_recorder) {
+        m_recorder->record_resize(m_state.row, m_state.col);
+    }
+    // Publish right away so the next frame already has the new geometry.
+    _publish_snapshot();
 
     LOG_DEBUG("Terminal resized to {}x{}", cols, rows);
 }
 
-void Terminal::process_input(const std::string& input) const {
-    if (!m_pty->is_valid()) {
+void Terminal::set_fixed_size(int cols, int rows) {
+    // Output read so far belongs to the old size, let the parser finish it.
+    // Only a replay on the reader thread ever waits here.
+    while (m_output_ring.fill_level() > 0 && !m_output_ring.is_closed()) {
+        std::this_thread::sleep_for(g_fixed_size_poll_period);
+    }
+    m_fixed_size = true;
+    resize(cols, rows);
+}
+
+void Terminal::send_keys(std::string_view keys) {
+    {
+        auto lock = _lock_buffer();
+        _note_keystroke();
+    }
+    process_input(keys);
+}
+
+void Terminal::on_frame_presented() {
+    if (!m_echo.drawn) {
         return;
     }
-    if (m_state.mode & ModeBracketpaste) {
-        if (input.substr(0, 4) == "\033[200~") {
-            m_pty->write(input.c_str(), input.length());
-            return;
-        }
-        if (input.substr(0, 4) == "\033[201~") {
-            m_pty->write(input.c_str(), input.length());
-            return;
-        }
+    m_echo.drawn = false;
+    if (m_echo_latencies.size() == g_max_echo_samples) {
+        m_echo_latencies.pop_front();
+    }
+    m_echo_latencies.push_back(std::chrono::steady_clock::now() -
+                               m_echo.key_time);
+}
+
+Terminal::LatencyStats Terminal::echo_latency_stats() const {
+    LatencyStats stats;
+    stats.samples = m_echo_latencies.size();
+    if (stats.samples == 0) {
+        return stats;
+    }
+    std::vector<std::chrono::nanoseconds> sorted(m_echo_latencies.begin(),
+                                                 m_echo_latencies.end());
+    std::sort(sorted.begin(), sorted.end());
+    stats.p50 = sorted[(sorted.size() - 1) / 2];
+    stats.p99 = sorted[(sorted.size() - 1) * 99 / 100];
+    stats.max = sorted.back();
+    return stats;
+}
+
+void Terminal::_note_keystroke() {
+    // Called with `m_buffer_mutex` held, so the sequence can't move.
+    auto now = std::chrono::steady_clock::now();
+    m_last_key_time = now.time_since_epoch().count();
+    if (!m_echo.awaiting) {
+        // Measures from the first key that is still waiting for output.
+        m_echo.key_time = now;
+        m_echo.sequence = m_snapshot_sequence;
+        m_echo.awaiting = true;
+    }
+    m_echo.sent_this_frame = true;
+}
+
+void Terminal::_wait_for_echo() {
+    if (!m_echo.sent_this_frame) {
+        return;
+    }
+    m_echo.sent_this_frame = false;
+    if (IM_APP.get_app_spec().present_mode != ImApp::LowLatency) {
+        return;
+    }
+    // Local echo takes well under a millisecond, waiting for it here is
+    // cheaper than presenting a frame without it and another one after.
+    auto lock = _lock_buffer();
+    IM_APP_TRACE_SCOPE("Terminal::_wait_for_echo");
+    m_snapshot_published.wait_for(lock, g_echo_wait, [this]() {
+        return m_snapshot_sequence > m_echo.sequence;
+    });
+}
+
+void Terminal::process_input(std::string_view input) const {
+    if (!m_pty->is_valid()) {
+        return;
     }
     if (m_state.mode & ModeAppcursor) {
         if (input == "\033[A") {
@@ -238,19 +334,18 @@ void Terminal::process_input(const std::string& input) const {
         return;
     }
 
-    m_pty->write(input.c_str(), input.length());
+    m_pty->write(input.data(), input.length());
 }
 
-bool Terminal::selected_text(int x, int y) {
+bool Terminal::selected_text(int x, int64_t y) {
     if (m_selection.mode == SelectionIdle || m_selection.ob.x == -1 ||
-        m_selection.alt != (m_state.mode & ModeAltscreen)) {
+        m_selection.alt != (m_view->mode & ModeAltscreen)) {
         return false;
     }
 
-    // Convert coordinates to absolute buffer positions
-    int actual_y = m_sb_buffer.size() + y;
-    int sel_start_y = m_sb_buffer.size() + m_selection.nb.y;
-    int sel_end_y = m_sb_buffer.size() + m_selection.ne.y;
+    int64_t actual_y = y;
+    int64_t sel_start_y = m_selection.nb.y;
+    int64_t sel_end_y = m_selection.ne.y;
 
     // Ensure start is less than or equal to end
     if (sel_start_y > sel_end_y) {
@@ -267,55 +362,277 @@ bool Terminal::selected_text(int x, int y) {
            (actual_y != sel_end_y || x <= m_selection.ne.x);
 }
 
-void Terminal::paste_from_clipboard() const {
+void Terminal::select_view() {
+    const ScreenSnapshot& view = *m_view;
+    int alt = view.mode & ModeAltscreen;
+    // Same lines as a mouse drag over the whole view
+    int64_t first = alt ? view.screen_line : view.first_line;
+    int64_t last = first + view.rows - 1;
+    if (m_selection.mode == SelectionSelecting && m_selection.alt == alt &&
+        m_selection.ob.x == 0 && m_selection.ob.y == first &&
+        m_selection.oe.x == view.cols - 1 && m_selection.oe.y == last) {
+        return;
+    }
+    _selection_start(0, first);
+    _selection_extend(view.cols - 1, last);
+}
+
+void Terminal::paste_from_clipboard() {
     const char* text = ImGui::GetClipboardText();
+    if (text == nullptr || text[0] == '\0' || !m_pty->is_valid()) {
+        return;
+    }
+    if (m_paste.is_active()) {
+        LOG_WARN("Paste already in progress.");
+        return;
+    }
 
-    if (m_state.mode & ModeBracketpaste) {
-        // Send paste start sequence
-        m_pty->write("\033[200~", 6);
-        // Send the actual text
-        m_pty->write(text, strlen(text));
-        // Send paste end sequence
-        m_pty->write("\033[201~", 6);
-    } else {
-        m_pty->write(text, strlen(text));
+    // The rest is sent from `render` at the rate the PTY accepts it.
+    m_paste.start(text, m_bracketed_paste.is_set());
+    m_paste.pump(*m_pty, g_paste_budget_per_frame);
+}
+
+Terminal::ThroughputStats Terminal::throughput_stats() const {
+    return {
+        .parsed_bytes = m_parsed_bytes.load(std::memory_order_relaxed),
+        .parse_time = std::chrono::nanoseconds(
+            m_parse_time_ns.load(std::memory_order_relaxed)),
+        .rendered_frames = m_rendered_frames,
+        .render_time = m_render_time,
+        .built_rows = m_built_rows,
+    };
+}
+
+bool Terminal::record_session(const std::filesystem::path& path) {
+    if (m_read_thread.joinable()) {
+        LOG_ERROR("Recording must start before the shell does.");
+        return false;
     }
+    m_recorder =
+        std::make_unique<SessionRecorder>(path, m_state.row, m_state.col);
+    if (!m_recorder->is_open()) {
+        m_recorder.reset();
+        return false;
+    }
+    LOG_INFO("Recording PTY output to '{}'.", path.string());
+    return true;
 }
 
 void Terminal::_start_shell() {
-    // Open PTY master
-    if (m_pty->launch(
-            m_state.row,
-            m_state.col)) { // Use initial rows/cols from Terminal state object
+    m_launch_time = std::chrono::steady_clock::now();
+    // A PTY handed in already launched only needs the terminal's size.
+    if (m_pty->is_valid()) {
+        m_pty->resize(m_state.row, m_state.col);
+    }
+    if (m_pty->is_valid() || m_pty->launch(m_state.row, m_state.col)) {
         m_read_thread = std::thread(&Terminal::_read_output, this);
+        m_parse_thread = std::thread(&Terminal::_parse_output, this);
     } else {
         LOG_CRITICAL("Faield to launch pty!");
     }
 }
 
 void Terminal::_read_output() {
-    char buffer[4096];
+    ImApp::Tracer::instance().set_thread_name("PTY read");
+    // Output of a child that already exited is still drained, until the
+    // read below reports the hangup.
     while (!m_should_terminate) {
-        size_t bytes_read = 0;
-        if (m_pty->is_valid()) {
-            bytes_read = m_pty->read(buffer, sizeof(buffer) - 1);
-        }
-        if (bytes_read > 0) {
-            std::lock_guard<std::mutex> lock(m_buffer_mutex);
-            _write_to_buffer(buffer, bytes_read);
-        } else if (bytes_read < 0 && errno != EINTR) {
+        if (!m_pty->wait_readable(-1)) {
+            if (!m_pty->is_valid()) {
+                break;
+            }
+            continue;
+        }
+        IM_APP_TRACE_SCOPE("Terminal::_read_output");
+        // Drain everything the child produced since the last wakeup straight
+        // into the ring; this never waits on the parser or the renderer
+        // unless the ring is full.
+        size_t total_read = 0;
+        while (m_output_ring.wait_for_space()) {
+            char* slot = m_output_ring.acquire_slot();
+            size_t bytes_read = m_pty->read(slot, ByteRing::g_slot_size);
+            if (bytes_read == 0) {
+                break;
+            }
+            if (m_recorder) {
+                m_recorder->record(slot, bytes_read);
+            }
+            if (!m_received_output) {
+                m_received_output = true;
+                LOG_DEBUG("First PTY output {:.2f} ms after launch.",
+                          std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - m_launch_time)
+                              .count());
+            }
+            m_output_ring.commit_slot(bytes_read);
+            total_read += bytes_read;
+        }
+        if (total_read == 0 && !m_output_ring.is_closed()) {
+            // Readable but empty means the child side hung up.
+            LOG_INFO("PTY closed.");
             break;
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
+    // Let the parser drain what is left and stop.
+    m_output_ring.close();
+}
+
+void Terminal::_parse_output() {
+    ImApp::Tracer::instance().set_thread_name("VT parse");
+    while (m_output_ring.wait_for_data()) {
+        auto lock = _lock_buffer();
+        IM_APP_TRACE_SCOPE("Terminal::_parse_output");
+        // Feed the whole backlog to libvterm, then report damage once.
+        auto parse_start = std::chrono::steady_clock::now();
+        size_t parsed = m_output_ring.consume(
+            [this](const char* data, size_t size) {
+                _write_to_buffer(data, size);
+            });
+        auto now = std::chrono::steady_clock::now();
+        m_parsed_bytes.fetch_add(parsed, std::memory_order_relaxed);
+        m_parse_time_ns.fetch_add((now - parse_start).count(),
+                                  std::memory_order_relaxed);
+        _update_flood_state(parsed, now);
+
+        if (now < m_flood.next_publish()) {
+            // Nobody would see this state, keep parsing instead. More output
+            // publishes it once it is due, otherwise the fallback frame wakes
+            // us up.
+            m_flood.held_back(parsed);
+            m_publish_pending = true;
+            IM_APP.request_frame(m_flood.fallback_frame() - now);
+            continue;
+        }
+        if (parsed > 0 || m_flood.is_active()) {
+            IM_APP_TRACE_SCOPE("vterm_screen_flush_damage");
+            vterm_screen_flush_damage(m_vterm_screen);
+        }
+        // A wakeup without output means the view changed, e.g. a scroll.
+        _publish_snapshot();
+        m_flood.published(now);
+        m_publish_pending = false;
+        auto key_time = std::chrono::steady_clock::time_point(
+            std::chrono::steady_clock::duration(m_last_key_time));
+        if (now - key_time < g_echo_window) {
+            // Most likely the echo of a keystroke, skip the frame-rate cap.
+            IM_APP.request_urgent_frame();
+        } else {
+            IM_APP.request_frame();
+        }
+    }
+}
+
+void Terminal::_update_flood_state(size_t parsed,
+                                   std::chrono::steady_clock::time_point now) {
+    switch (m_flood.update(parsed, now)) {
+    case OutputFlood::Change::Entered:
+        vterm_screen_set_damage_merge(m_vterm_screen, VTERM_DAMAGE_SCREEN);
+        LOG_INFO("Output flood mode on at {:.1f} MB/s.",
+                 m_flood.rate() / (1024 * 1024));
+        break;
+    case OutputFlood::Change::Left: {
+        vterm_screen_set_damage_merge(m_vterm_screen, VTERM_DAMAGE_SCROLL);
+        double seconds = m_flood.duration(now).count();
+        LOG_INFO("Output flood mode off after {:.1f}s: {:.1f} MB/s, {} "
+                 "snapshots skipped.",
+                 seconds, m_flood.bytes() / seconds / (1024 * 1024),
+                 m_flood.skipped_snapshots());
+        break;
+    }
+    case OutputFlood::Change::None:
+        break;
+    }
+}
+
+std::unique_lock<std::mutex> Terminal::_lock_buffer() {
+    // Traced, so contention with the parser shows up on the timeline.
+    IM_APP_TRACE_SCOPE("Terminal::_lock_buffer");
+    return std::unique_lock<std::mutex>(m_buffer_mutex);
+}
+
+void Terminal::_publish_snapshot() {
+    IM_APP_TRACE_SCOPE("Terminal::_publish_snapshot");
+    ScreenSnapshot& snapshot = m_snapshots.back();
+    snapshot.rows = m_state.row;
+    snapshot.mode = m_state.mode;
+    if (snapshot.cols != m_state.col) {
+        // Every row moved within `cells`, none can be reused.
+        snapshot.row_versions.assign(snapshot.rows, 0);
+    }
+    snapshot.cols = m_state.col;
+    snapshot.cells.resize(static_cast<size_t>(snapshot.rows) * snapshot.cols);
+    snapshot.row_versions.resize(snapshot.rows, 0);
+    if (m_row_versions.size() != static_cast<size_t>(m_state.row)) {
+        _damage_rows(0, m_state.row);
+    }
+
+    // The view always spans `rows` lines, so it can be scrolled back by at
+    // most the whole scrollback. The alt screen has no scrollback.
+    int sb_size = static_cast<int>(m_sb_buffer.size());
+    int scroll_offset = 0;
+    if (!(m_state.mode & ModeAltscreen)) {
+        scroll_offset = std::clamp(m_scroll_offset.load(), 0, sb_size);
+    }
+    int first_index = sb_size - scroll_offset; // into the scrollback
+
+    VTermScreenCell blank{};
+    blank.fg.type = VTERM_COLOR_DEFAULT_FG;
+    blank.bg.type = VTERM_COLOR_DEFAULT_BG;
+    for (int y = 0; y < snapshot.rows; y++) {
+        VTermScreenCell* row =
+            &snapshot.cells[static_cast<size_t>(y) * snapshot.cols];
+        int line = first_index + y;
+        uint64_t version = line < sb_size ? m_sb_buffer[line].version
+                                          : m_row_versions[line - sb_size];
+        if (snapshot.row_versions[y] == version) {
+            // This buffer already holds the row from an earlier publish.
+            continue;
+        }
+        snapshot.row_versions[y] = version;
+        if (line < sb_size) {
+            // Lines pushed before a resize may be narrower than the screen.
+            const Scrollback::Line& sb_line = m_sb_buffer[line];
+            int count =
+                std::min(snapshot.cols, static_cast<int>(sb_line.cells.size()));
+            std::copy_n(sb_line.cells.begin(), count, row);
+            std::fill(row + count, row + snapshot.cols, blank);
+            continue;
+        }
+        for (int x = 0; x < snapshot.cols; x++) {
+            VTermPos vterm_pos{
+                .row = line - sb_size,
+                .col = x,
+            };
+            vterm_screen_get_cell(m_vterm_screen, vterm_pos, &row[x]);
+        }
+    }
+
+    snapshot.cursor_x = m_state.c.x;
+    snapshot.cursor_y = scroll_offset == 0 ? m_state.c.y : -1;
+    snapshot.cursor_visible = m_cursor_visible;
+    snapshot.scrollback_size = sb_size;
+    snapshot.scroll_offset = scroll_offset;
+    snapshot.first_line = m_sb_buffer.first_line() + first_index;
+    snapshot.screen_line = m_sb_buffer.end_line();
+    snapshot.sequence = ++m_snapshot_sequence;
+    if (snapshot.osc_colors_version != m_osc_colors_version) {
+        snapshot.osc_colors = m_osc_colors;
+        snapshot.osc_colors_version = m_osc_colors_version;
+    }
+    m_snapshots.publish();
+    m_snapshot_published.notify_all();
 }
 
 void Terminal::_write_to_buffer(const char* data, size_t length) {
     static char utf8buf[g_utf_size];
     static size_t utf8len = 0;
 
-    vterm_input_write(m_vterm, data, length);
-    vterm_screen_flush_damage(m_vterm_screen);
+    IM_APP_TRACE_SCOPE("Terminal::_write_to_buffer");
+    {
+        IM_APP_TRACE_SCOPE("vterm_input_write");
+        vterm_input_write(m_vterm, data, length);
+    }
+    m_bracketed_paste.scan(data, length);
     // for (size_t i = 0; i < length; ++i) {
     //     unsigned char c = data[i];
 
@@ -447,16 +764,6 @@ void Terminal::_write_to_buffer(const char* data, size_t length) {
 }
 
 void Terminal::_write_char(Rune u) {
-    auto it = m_box_drawing_chars.find(u);
-    if (it != m_box_drawing_chars.end()) {
-        u = it->second;
-    } else {
-        // Log unmapped characters
-        if (u >= 0x2500 && u <= 0x257F) {
-            // LOG_ERROR("Unmapped box drawing character: U+{:x}", u);
-        }
-    }
-
     if (m_state.c.x >= m_state.col) {
         // Set wrap flag on current line before moving to next
         if (m_state.c.y < m_state.row && m_state.c.x > 0) {
@@ -592,6 +899,9 @@ bool Terminal::_setup_window() {
 }
 
 void Terminal::_handle_terminal_resize() {
+    if (m_fixed_size) {
+        return;
+    }
     ImVec2 content_size = ImGui::GetContentRegionAvail();
     float char_width = ImGui::GetFontBaked()->GetCharAdvance('M');
     float line_height = ImGui::GetTextLineHeight();
@@ -606,16 +916,18 @@ void Terminal::_handle_terminal_resize() {
     }
 }
 
-void Terminal::_handle_scrollback(const ImGuiIO& io, int new_rows) {
+void Terminal::_handle_scrollback(const ImGuiIO& io) {
     if (ImGui::IsWindowFocused() && ImGui::IsWindowHovered() &&
-        !(m_state.mode & ModeAltscreen)) {
+        !(m_view->mode & ModeAltscreen)) {
         if (io.MouseWheel != 0.0f) {
-            int max_scroll =
-                std::max(0, static_cast<int>(m_sb_buffer.size() + m_state.row) -
-                                new_rows);
             // Reverse the scroll direction by changing subtraction to addition
-            m_scroll_offset += static_cast<int>(io.MouseWheel * 3);
-            m_scroll_offset = std::clamp(m_scroll_offset, 0, max_scroll);
+            int offset = m_scroll_offset + static_cast<int>(io.MouseWheel * 3);
+            offset = std::clamp(offset, 0, m_view->scrollback_size);
+            if (offset != m_scroll_offset) {
+                // The parser thread owns the view, ask it to republish.
+                m_scroll_offset = offset;
+                m_output_ring.wake_consumer();
+            }
         }
     }
 }
@@ -635,43 +947,30 @@ void Terminal::_handle_mouse_input(const ImGuiIO& io) {
     int cell_y = static_cast<int>(
         (mouse_pos.y - content_pos.y + (line_height * 0.2)) / line_height);
 
-    cell_x = std::clamp(cell_x, 0, m_state.col - 1);
-
-    // Account for scrollback offset when not in alt screen
-    if (!(m_state.mode & ModeAltscreen)) {
-        ImVec2 content_size = ImGui::GetContentRegionAvail();
-        int visible_rows =
-            std::max(1, static_cast<int>(content_size.y / line_height));
-        int total_lines = m_sb_buffer.size() + m_state.row;
-        int max_scroll = std::max(0, total_lines - visible_rows);
-        m_scroll_offset = std::clamp(m_scroll_offset, 0, max_scroll);
-        int start_line =
-            std::max(0, total_lines - visible_rows - m_scroll_offset);
-
-        // Convert visible Y coordinate to actual buffer coordinate
-        int actual_y = start_line + cell_y;
-
-        // Convert to selection coordinate system (relative to scrollback
-        // buffer)
-        cell_y = actual_y - m_sb_buffer.size();
+    cell_x = std::clamp(cell_x, 0, m_view->cols - 1);
 
+    // Selections are in absolute lines, so they stay on their text while
+    // output scrolls.
+    int64_t line = 0;
+    if (!(m_view->mode & ModeAltscreen)) {
+        line = m_view->first_line + cell_y;
     } else {
         // In alt screen, clamp to current screen
-        cell_y = std::clamp(cell_y, 0, m_state.row - 1);
+        line = m_view->screen_line + std::clamp(cell_y, 0, m_view->rows - 1);
     }
 
     static ImVec2 click_start_pos{0, 0};
 
     if (ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
         click_start_pos = mouse_pos;
-        _selection_start(cell_x, cell_y);
+        _selection_start(cell_x, line);
     } else if (ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
         ImVec2 drag_delta = ImGui::GetMouseDragDelta(ImGuiMouseButton_Left);
         float drag_distance =
             sqrt(drag_delta.x * drag_delta.x + drag_delta.y * drag_delta.y);
 
         if (drag_distance > g_drag_threshold) {
-            _selection_extend(cell_x, cell_y);
+            _selection_extend(cell_x, line);
         }
     } else if (ImGui::IsMouseReleased(ImGuiMouseButton_Left)) {
         ImVec2 drag_delta = ImGui::GetMouseDragDelta(ImGuiMouseButton_Left);
@@ -699,10 +998,18 @@ void Terminal::_handle_mouse_input(const ImGuiIO& io) {
     }
 }
 
-void Terminal::_handle_keyboard_input(const ImGuiIO& io) const {
+void Terminal::_handle_keyboard_input(const ImGuiIO& io) {
     if (!ImGui::IsWindowFocused()) {
         return;
     }
+    if (m_paste.is_active()) {
+        // Keys would be interleaved with the paste, Escape cancels it.
+        if (ImGui::IsKeyPressed(ImGuiKey_Escape, false)) {
+            m_paste.cancel();
+            LOG_INFO("Paste cancelled.");
+        }
+        return;
+    }
     VTermModifier mod = VTERM_MOD_NONE;
     if (io.KeyCtrl) {
         mod = static_cast<VTermModifier>(
@@ -761,6 +1068,17 @@ void Terminal::_handle_keyboard_input(const ImGuiIO& io) const {
         {ImGuiKey_F22, static_cast<VTermKey>(VTERM_KEY_FUNCTION(22))},
         {ImGuiKey_F23, static_cast<VTermKey>(VTERM_KEY_FUNCTION(23))},
         {ImGuiKey_F24, static_cast<VTermKey>(VTERM_KEY_FUNCTION(24))}};
+    bool has_input = io.InputQueueCharacters.Size > 0 ||
+                     std::any_of(std::begin(s_key_map), std::end(s_key_map),
+                                 [](const auto& entry) {
+                                     return ImGui::IsKeyPressed(entry.first);
+                                 });
+    if (!has_input) {
+        return;
+    }
+    // libvterm is shared with the parser thread, only lock on actual input.
+    auto lock = _lock_buffer();
+    _note_keystroke();
     for (const auto& [imgui_key, vterm_key] : s_key_map) {
         if (ImGui::IsKeyPressed(imgui_key)) {
             vterm_keyboard_key(m_vterm, vterm_key, mod);
@@ -845,7 +1163,7 @@ void Terminal::_handle_control_combos(const ImGuiIO& io) const {
 
     for (const auto& [key, ctrl_char] : s_control_keys) {
         if (ImGui::IsKeyPressed(key)) {
-            process_input(std::string(1, ctrl_char));
+            process_input(std::string_view(&ctrl_char, 1));
         }
     }
 }
@@ -857,185 +1175,384 @@ void Terminal::_handle_regular_text_input(const ImGuiIO& io) const {
     for (int i = 0; i < io.InputQueueCharacters.Size; i++) {
         char c = static_cast<char>(io.InputQueueCharacters[i]);
         if (c != 0) {
-            process_input(std::string(1, c));
+            process_input(std::string_view(&c, 1));
         }
     }
 }
 
 void Terminal::_render_buffer() {
-    std::lock_guard<std::mutex> lock(m_buffer_mutex);
-
+    IM_APP_TRACE_SCOPE("Terminal::_render_buffer");
+    auto render_start = std::chrono::steady_clock::now();
+    const ScreenSnapshot& view = *m_view;
     ImDrawList* draw_list = ImGui::GetWindowDrawList();
     ImVec2 pos = ImGui::GetCursorScreenPos();
     float char_width = ImGui::GetFontBaked()->GetCharAdvance('M');
     float line_height = ImGui::GetTextLineHeight();
 
-    if (m_state.mode & ModeAltscreen) {
-        _render_alt_screen(draw_list, pos, char_width, line_height);
-    } else {
-        _render_main_screen(draw_list, pos, char_width, line_height);
-    }
-}
-
-void Terminal::_render_alt_screen(ImDrawList* draw_list, const ImVec2& pos,
-                                  float char_width, float line_height) {
     // Handle selection highlight
     if (m_selection.mode != SelectionIdle && m_selection.ob.x != -1) {
-        _render_selection_highlight(draw_list, pos, char_width, line_height, 0,
-                                    m_state.row);
+        _render_selection_highlight(draw_list, pos, char_width, line_height);
+    }
+
+    // Draw content, scrollback lines are already part of the view
+    _render_rows(draw_list, pos, char_width, line_height);
+
+    // Draw cursor when shown and not scrolled
+    if (ImGui::IsWindowFocused() && view.cursor_visible &&
+        view.cursor_y >= 0 && view.cursor_y < view.rows &&
+        view.cursor_x < view.cols) {
+        ImVec2 cursor_pos(pos.x + view.cursor_x * char_width,
+                          pos.y + view.cursor_y * line_height);
+        // Stepped instead of faded, so an idle terminal only renders a frame
+        // per blink.
+        using Seconds = std::chrono::duration<double>;
+        double period = Seconds(g_cursor_blink_period).count();
+        double phase = std::fmod(ImGui::GetTime(), 2.0 * period);
+        bool bright = phase < period;
+        float alpha = bright ? 0.8f : 0.2f;
+        Seconds until_step((bright ? period : 2.0 * period) - phase);
+        IM_APP.request_frame(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                until_step));
+        _render_cursor(draw_list, cursor_pos,
+                       view.cell(view.cursor_x, view.cursor_y), char_width,
+                       line_height, alpha);
     }
 
-    // Draw alt screen characters
-    for (int y = 0; y < m_state.row; y++) {
-        if (!m_state.dirty[y]) {
-            continue;
+    m_rendered_frames++;
+    m_render_time += std::chrono::steady_clock::now() - render_start;
+}
+
+void Terminal::_render_rows(ImDrawList* draw_list, const ImVec2& pos,
+                            float char_width, float line_height) {
+    const ScreenSnapshot& view = *m_view;
+    if (!m_glyph_cache) {
+        _create_glyph_cache();
+    }
+    m_glyph_cache->begin_frame(ImVec2(char_width, line_height),
+                               ImGui::GetFontSize());
+    m_box_drawing.set_cell_size(ImVec2(char_width, line_height));
+    _update_palette();
+    RowCacheKey key{
+        .font = ImGui::GetFont(),
+        .atlas_id = ImGui::GetIO().Fonts->TexData->UniqueID,
+        .glyph_epoch = m_glyph_cache->epoch(),
+        .palette_version = m_palette.version(),
+        .char_width = char_width,
+        .line_height = line_height,
+    };
+    if (key != m_row_cache_key) {
+        // Slots, UVs and colors are baked into the vertices.
+        m_row_cache.clear();
+        m_grid_row_versions.clear();
+        m_row_cache_key = key;
+    }
+    if (m_cell_grid_enabled && !m_cell_grid_created) {
+        // Needs the graphics context, so it is created on first use.
+        m_cell_grid = IM_APP.create_cell_grid_renderer();
+        m_cell_grid_created = true;
+        if (!m_cell_grid) {
+            LOG_WARN("No cell grid renderer, drawing cells with ImGui.");
+        }
+    }
+    if (m_cell_grid_enabled && m_cell_grid) {
+        _render_cell_grid(draw_list, pos, char_width, line_height);
+        return;
+    }
+    if (!m_row_builder) {
+        m_row_builder =
+            std::make_unique<ImDrawList>(ImGui::GetDrawListSharedData());
+        m_glyph_builder =
+            std::make_unique<ImDrawList>(ImGui::GetDrawListSharedData());
+    }
+
+    // Rows that scrolled keep their version, find them at their old index.
+    std::vector<RowCache> old_cache;
+    old_cache.swap(m_row_cache);
+    m_row_cache.resize(view.rows);
+    std::unordered_map<uint64_t, size_t> old_rows;
+    for (int y = 0; y < view.rows; y++) {
+        uint64_t version = view.row_versions[y];
+        size_t old_index = y;
+        if (old_index >= old_cache.size() ||
+            old_cache[old_index].version != version) {
+            if (old_rows.empty()) {
+                for (size_t i = 0; i < old_cache.size(); i++) {
+                    old_rows.emplace(old_cache[i].version, i);
+                }
+            }
+            auto it = old_rows.find(version);
+            old_index = old_cache.size();
+            if (it != old_rows.end() &&
+                old_cache[it->second].version == version) {
+                old_index = it->second;
+            }
         }
-
-        for (int x = 0; x < m_state.col; x++) {
-            VTermScreenCell cell;
-            VTermPos vterm_pos{
-                .row = y,
-                .col = x,
-            };
-            vterm_screen_get_cell(m_vterm_screen, vterm_pos, &cell);
-
-            ImVec2 char_pos(pos.x + x * char_width, pos.y + y * line_height);
-            _render_vterm_cell(draw_list, cell, char_pos, char_width,
-                               line_height);
+        if (old_index < old_cache.size()) {
+            m_row_cache[y] = std::move(old_cache[old_index]);
+            // Moved away, a row further down can't reuse it anymore.
+            old_cache[old_index].version = 0;
+            // Before any new row can evict its glyphs
+            for (uint32_t slot : m_row_cache[y].slots) {
+                m_glyph_cache->touch(slot);
+            }
         }
     }
-
-    // Draw cursor
-    if (ImGui::IsWindowFocused()) {
-        ImVec2 cursor_pos(pos.x + m_state.c.x * char_width,
-                          pos.y + m_state.c.y * line_height);
-        float alpha = (sin(ImGui::GetTime() * 3.14159f) * 0.3f) + 0.5f;
-        VTermScreenCell cursor_cell;
-        VTermPos vterm_pos{
-            .row = m_state.c.y,
-            .col = m_state.c.x,
+    for (int y = 0; y < view.rows; y++) {
+        ImVec2 origin(pos.x, pos.y + y * line_height);
+        RowCache& row = m_row_cache[y];
+        if (row.version != view.row_versions[y]) {
+            _build_row(y, origin, char_width, line_height);
+        }
+        _move_row(row, origin);
+        _splice(draw_list, row.shapes);
+    }
+    // Glyphs go on top of all backgrounds in one draw command.
+    draw_list->PushTexture(m_glyph_cache->texture_ref());
+    for (const RowCache& row : m_row_cache) {
+        _splice(draw_list, row.glyphs);
+    }
+    draw_list->PopTexture();
+}
+
+void Terminal::_create_glyph_cache() {
+    m_glyph_cache = std::make_unique<GlyphCache>();
+    for (const auto& path : m_font_paths) {
+        m_glyph_cache->add_font(path);
+    }
+    // ImGui's font covers what the configured fonts lack.
+    for (const ImFontConfig* source : ImGui::GetFont()->Sources) {
+        m_glyph_cache->add_font(source->FontData,
+                                static_cast<size_t>(source->FontDataSize));
+    }
+    if (!m_glyph_cache->has_fonts()) {
+        LOG_ERROR("No TrueType font for the terminal, text is not drawn.");
+    }
+}
+
+void Terminal::_build_row(int y, const ImVec2& origin, float char_width,
+                          float line_height) {
+    const ScreenSnapshot& view = *m_view;
+    ImDrawList& builder = *m_row_builder;
+    ImDrawList& glyph_builder = *m_glyph_builder;
+    ImVec2 clip_max(origin.x + view.cols * char_width, origin.y + line_height);
+    builder._ResetForNewFrame();
+    builder.PushTexture(ImGui::GetIO().Fonts->TexRef);
+    builder.PushClipRect(origin, clip_max);
+    glyph_builder._ResetForNewFrame();
+    glyph_builder.PushTexture(m_glyph_cache->texture_ref());
+    glyph_builder.PushClipRect(origin, clip_max);
+    RowCache& row = m_row_cache[y];
+    row.slots.clear();
+    m_built_rows++;
+    bool complete =
+        _render_vterm_row(&builder, &glyph_builder, &view.cell(0, y), view.cols,
+                          origin, char_width, line_height, row.slots);
+    // A row missing glyphs is built again next frame.
+    row.version = complete ? view.row_versions[y] : 0;
+    if (!complete) {
+        IM_APP.request_frame();
+    }
+    row.origin = origin;
+    row.shapes.vertices.assign(builder.VtxBuffer.begin(),
+                               builder.VtxBuffer.end());
+    row.shapes.indices.assign(builder.IdxBuffer.begin(),
+                              builder.IdxBuffer.end());
+    row.glyphs.vertices.assign(glyph_builder.VtxBuffer.begin(),
+                               glyph_builder.VtxBuffer.end());
+    row.glyphs.indices.assign(glyph_builder.IdxBuffer.begin(),
+                              glyph_builder.IdxBuffer.end());
+}
+
+void Terminal::_render_cell_grid(ImDrawList* draw_list, const ImVec2& pos,
+                                 float char_width, float line_height) {
+    IM_APP_TRACE_SCOPE("Terminal::_render_cell_grid");
+    const ScreenSnapshot& view = *m_view;
+    if (m_grid_cols != view.cols ||
+        m_grid_row_versions.size() != static_cast<size_t>(view.rows)) {
+        m_cell_grid->resize(view.cols, view.rows);
+        m_grid_cols = view.cols;
+        m_grid_row_versions.assign(view.rows, 0);
+        m_grid_row_slots.assign(view.rows, {});
+    }
+    if (m_grid_glyph_epoch != m_glyph_cache->epoch()) {
+        // Glyph i + 1 of the grid is slot i, whose place never changes.
+        ImApp::CellGridRenderer::Glyph glyph{
+            .p1 = m_glyph_cache->slot_size(),
         };
-        vterm_screen_get_cell(m_vterm_screen, vterm_pos, &cursor_cell);
-        _render_cursor(draw_list, cursor_pos, cursor_cell, char_width,
-                       line_height, alpha);
+        for (uint32_t slot = 0; slot < m_glyph_cache->slot_count(); slot++) {
+            m_glyph_cache->slot_uv(slot, glyph.uv0, glyph.uv1);
+            m_cell_grid->set_glyph(slot + 1, glyph);
+        }
+        m_grid_glyph_epoch = m_glyph_cache->epoch();
+    }
+    for (const auto& slots : m_grid_row_slots) {
+        for (uint32_t slot : slots) {
+            m_glyph_cache->touch(slot);
+        }
     }
+    for (int y = 0; y < view.rows; y++) {
+        if (m_grid_row_versions[y] != view.row_versions[y]) {
+            bool complete = _build_grid_row(y);
+            m_built_rows++;
+            m_cell_grid->set_row(y, m_grid_cells.data());
+            m_grid_row_versions[y] = complete ? view.row_versions[y] : 0;
+            if (!complete) {
+                IM_APP.request_frame();
+            }
+        }
+    }
+    m_cell_grid->draw(draw_list, pos, ImVec2(char_width, line_height),
+                      m_glyph_cache->texture_ref());
+}
+
+bool Terminal::_build_grid_row(int y) {
+    using Grid = ImApp::CellGridRenderer;
+    const ScreenSnapshot& view = *m_view;
+    const VTermScreenCell* cells = &view.cell(0, y);
+    std::vector<uint32_t>& slots = m_grid_row_slots[y];
+    slots.clear();
+    m_grid_cells.resize(view.cols);
+    _resolve_row_colors(cells, view.cols);
+    bool complete = true;
+    for (int x = 0; x < view.cols; x++) {
+        CellStyle style = _vterm_cell_style(cells[x], x);
+        Grid::Cell& grid_cell = m_grid_cells[x];
+        grid_cell.fg = style.fg;
+        grid_cell.bg = style.bg;
+        grid_cell.flags = (style.background ? Grid::CellBackground : 0) |
+                          (style.underline ? Grid::CellUnderline : 0);
+        // Both halves of a wide character have a slot of their own.
+        // Combining characters are not drawn.
+        uint32_t slot = GlyphCache::g_no_slot;
+        complete &= _find_glyph(cells, x, slot);
+        grid_cell.glyph = slot != GlyphCache::g_no_slot ? slot + 1 : 0;
+        if (slot != GlyphCache::g_no_slot) {
+            slots.push_back(slot);
+        }
+    }
+    return complete;
+}
+
+bool Terminal::_find_glyph(const VTermScreenCell* cells, int x,
+                           uint32_t& slot) {
+    slot = GlyphCache::g_no_slot;
+    const VTermScreenCell& cell = cells[x];
+    Rune u = cell.chars[0];
+    uint8_t style = cell.attrs.bold ? GlyphCache::StyleBold : 0;
+    if (u == UINT32_MAX) {
+        // Right half of a wide character
+        if (x == 0 || cells[x - 1].width != 2) {
+            return true;
+        }
+        u = cells[x - 1].chars[0];
+        style |= GlyphCache::StyleWideRight;
+    } else if (cell.width == 2) {
+        style |= GlyphCache::StyleWideLeft;
+    }
+    if (u == 0 || u == ' ') {
+        return true;
+    }
+    slot = m_glyph_cache->find(u, style);
+    return slot != GlyphCache::g_no_slot;
 }
 
-void Terminal::_render_main_screen(ImDrawList* draw_list, const ImVec2& pos,
-                                   float char_width, float line_height) {
-    ImVec2 content_size = ImGui::GetContentRegionAvail();
-    int visible_rows =
-        std::max(1, static_cast<int>(content_size.y / line_height));
-    int total_lines = m_sb_buffer.size() + m_state.row;
-
-    // Handle scrollback clamping
-    int max_scroll = std::max(0, total_lines - visible_rows);
-    m_scroll_offset = std::clamp(m_scroll_offset, 0, max_scroll);
-    int start_line = std::max(0, total_lines - visible_rows - m_scroll_offset);
-
-    // Handle selection highlighting
-    if (m_selection.mode != SelectionIdle && m_selection.ob.x != -1) {
-        _render_selection_highlight(draw_list, pos, char_width, line_height,
-                                    start_line, start_line + visible_rows,
-                                    m_sb_buffer.size());
+void Terminal::_move_row(RowCache& row, const ImVec2& origin) {
+    if (row.origin.x == origin.x && row.origin.y == origin.y) {
+        return;
     }
+    // Scrolled or the window moved, shift it once and keep it there.
+    ImVec2 offset(origin.x - row.origin.x, origin.y - row.origin.y);
+    for (auto* vertices : {&row.shapes.vertices, &row.glyphs.vertices}) {
+        for (ImDrawVert& vertex : *vertices) {
+            vertex.pos.x += offset.x;
+            vertex.pos.y += offset.y;
+        }
+    }
+    row.origin = origin;
+}
 
-    // Draw content
-    for (int vis_y = 0; vis_y < visible_rows; vis_y++) {
-        int current_line = start_line + vis_y;
-
-        bool use_sb_buffer = current_line < m_sb_buffer.size();
-        int row_idx =
-            use_sb_buffer ? current_line : current_line - m_sb_buffer.size();
-
-        for (int x = 0; x < m_state.col; x++) {
-            VTermScreenCell* cell = nullptr;
-            VTermScreenCell vt_cell;
-            if (use_sb_buffer) {
-                cell = &m_sb_buffer[row_idx][x];
-            } else {
-                VTermPos vterm_pos{
-                    .row = row_idx,
-                    .col = x,
-                };
-                vterm_screen_get_cell(m_vterm_screen, vterm_pos, &vt_cell);
-                cell = &vt_cell;
+void Terminal::_splice(ImDrawList* draw_list, const DrawBuffers& buffers) {
+    if (buffers.indices.empty()) {
+        return;
+    }
+    auto vertex_count = static_cast<int>(buffers.vertices.size());
+    auto index_count = static_cast<int>(buffers.indices.size());
+    // May start a new draw command with a vertex offset, which resets the
+    // current index, so only read it afterwards.
+    draw_list->PrimReserve(index_count, vertex_count);
+    auto base = static_cast<ImDrawIdx>(draw_list->_VtxCurrentIdx);
+    std::memcpy(draw_list->_VtxWritePtr, buffers.vertices.data(),
+                buffers.vertices.size() * sizeof(ImDrawVert));
+    for (int i = 0; i < index_count; i++) {
+        draw_list->_IdxWritePtr[i] =
+            static_cast<ImDrawIdx>(buffers.indices[i] + base);
+    }
+    draw_list->_VtxWritePtr += vertex_count;
+    draw_list->_IdxWritePtr += index_count;
+    draw_list->_VtxCurrentIdx += vertex_count;
+}
+
+void Terminal::_update_selection_spans() {
+    const ScreenSnapshot& view = *m_view;
+    SelectionSpansKey key{
+        .selection_version = m_selection_version,
+        .first_line = view.first_line,
+        .rows = view.rows,
+        .cols = view.cols,
+        .alt_screen = (view.mode & ModeAltscreen) != 0,
+    };
+    if (key == m_selection_spans_key &&
+        m_selection_spans.size() == static_cast<size_t>(view.rows)) {
+        return;
+    }
+    m_selection_spans_key = key;
+    m_selection_spans.assign(view.rows, {0, 0});
+    if (m_selection.mode == SelectionIdle || m_selection.ob.x == -1 ||
+        m_selection.alt != (view.mode & ModeAltscreen)) {
+        return;
+    }
+    // Same cells as `selected_text`, `nb` is never below `ne`.
+    int64_t first = std::max<int64_t>(m_selection.nb.y - key.first_line, 0);
+    int64_t last =
+        std::min<int64_t>(m_selection.ne.y - key.first_line, view.rows - 1);
+    for (int64_t y = first; y <= last; y++) {
+        int64_t line = y + key.first_line;
+        int x0 = 0;
+        int x1 = view.cols;
+        if (m_selection.type == SelectionRectangular) {
+            x0 = m_selection.nb.x;
+            x1 = m_selection.ne.x + 1;
+        } else {
+            if (line == m_selection.nb.y) {
+                x0 = m_selection.nb.x;
             }
-            if (cell == nullptr) {
-                continue;
+            if (line == m_selection.ne.y) {
+                x1 = m_selection.ne.x + 1;
             }
-            ImVec2 char_pos(pos.x + x * char_width,
-                            pos.y + vis_y * line_height);
-            _render_vterm_cell(draw_list, *cell, char_pos, char_width,
-                               line_height);
-        }
-    }
-
-    // Draw cursor when not scrolled
-    if (ImGui::IsWindowFocused() && m_scroll_offset == 0) {
-        ImVec2 cursor_pos(pos.x + m_state.c.x * char_width,
-                          pos.y + (visible_rows -
-                                   (total_lines - m_sb_buffer.size()) +
-                                   m_state.c.y) *
-                                      line_height);
-        float alpha = (sin(ImGui::GetTime() * 3.14159f) * 0.3f) + 0.5f;
-        VTermScreenCell cursor_cell;
-        VTermPos vterm_pos{
-            .row = m_state.c.y,
-            .col = m_state.c.x,
-        };
-        vterm_screen_get_cell(m_vterm_screen, vterm_pos, &cursor_cell);
-        _render_cursor(draw_list, cursor_pos, cursor_cell, char_width,
-                       line_height, alpha);
+        }
+        x0 = std::clamp(x0, 0, view.cols);
+        x1 = std::clamp(x1, x0, view.cols);
+        m_selection_spans[y] = {x0, x1};
     }
 }
 
 void Terminal::_render_selection_highlight(ImDrawList* draw_list,
                                            const ImVec2& pos, float char_width,
-                                           float line_height, int start_y,
-                                           int end_y, int screen_offset) {
-    for (int y = start_y; y < end_y; y++) {
-        int screen_y = y - screen_offset;
-        // Handle both current screen and scrollback lines
-        if (screen_y >= 0 && screen_y < m_state.row) {
-            // Current screen line
-            for (int x = 0; x < m_state.col; x++) {
-                // Convert visible coordinate to selection coordinate system
-                int selection_y = screen_offset + screen_y - m_sb_buffer.size();
-                if (selected_text(x, selection_y)) {
-                    ImVec2 highlight_pos(pos.x + x * char_width,
-                                         pos.y + (y - start_y) * line_height);
-                    draw_list->AddRectFilled(
-                        highlight_pos,
-                        ImVec2(highlight_pos.x + char_width,
-                               highlight_pos.y + line_height),
-                        ImGui::ColorConvertFloat4ToU32(
-                            ImVec4(1.0f, 0.1f, 0.7f, 0.3f)));
-                }
-            }
-        } else if (screen_y < 0) {
-            // Scrollback line - render it if it's visible
-            int scrollback_index = -screen_y - 1;
-            if (scrollback_index >= 0 &&
-                scrollback_index < m_sb_buffer.size()) {
-                for (int x = 0; x < m_state.col; x++) {
-                    // Convert visible coordinate to selection coordinate system
-                    int selection_y =
-                        screen_offset + screen_y - m_sb_buffer.size();
-                    if (selected_text(x, selection_y)) {
-                        ImVec2 highlight_pos(pos.x + x * char_width,
-                                             pos.y +
-                                                 (y - start_y) * line_height);
-                        draw_list->AddRectFilled(
-                            highlight_pos,
-                            ImVec2(highlight_pos.x + char_width,
-                                   highlight_pos.y + line_height),
-                            ImGui::ColorConvertFloat4ToU32(
-                                ImVec4(1.0f, 0.1f, 0.7f, 0.3f)));
-                    }
-                }
-            }
+                                           float line_height) {
+    _update_selection_spans();
+    ImU32 color =
+        ImGui::ColorConvertFloat4ToU32(ImVec4(1.0f, 0.1f, 0.7f, 0.3f));
+    for (size_t y = 0; y < m_selection_spans.size(); y++) {
+        auto [x0, x1] = m_selection_spans[y];
+        if (x0 == x1) {
+            continue;
         }
+        float top = pos.y + static_cast<float>(y) * line_height;
+        draw_list->AddRectFilled(ImVec2(pos.x + x0 * char_width, top),
+                                 ImVec2(pos.x + x1 * char_width,
+                                        top + line_height),
+                                 color);
     }
 }
 
@@ -1069,101 +1586,126 @@ void Terminal::_render_glyph(ImDrawList* draw_list, const Glyph& glyph,
             ImGui::ColorConvertFloat4ToU32(fg));
     }
 }
-void Terminal::_render_vterm_cell(ImDrawList* draw_list, VTermScreenCell& cell,
-                                  const ImVec2& char_pos, float char_width,
-                                  float line_height) {
-    ImVec4 fg{m_dark_mode ? 1.0f : 0.0f, m_dark_mode ? 1.0f : 0.0f,
-              m_dark_mode ? 1.0f : 0.0f, 1.0f};
-    ImVec4 bg{m_dark_mode ? 0.0f : 1.0f, m_dark_mode ? 0.0f : 1.0f,
-              m_dark_mode ? 0.0f : 1.0f, 1.0f};
-    _handle_vterm_cell_colors(cell, fg, bg);
-
-    // Draw background
-    if (bg.x != 0 || bg.y != 0 || bg.z != 0 || (cell.attrs.reverse)) {
-        draw_list->AddRectFilled(
-            char_pos, ImVec2(char_pos.x + char_width, char_pos.y + line_height),
-            ImGui::ColorConvertFloat4ToU32(bg));
-    }
-
-    // Draw character
-    if (cell.width > 0) {
-        char text[g_utf_size] = {0};
-        size_t len = 0;
-        for (char i = 0; i < cell.width; i++) {
-            len += _utf8_encode(cell.chars[i], &text[len]);
+bool Terminal::_render_vterm_row(ImDrawList* draw_list, ImDrawList* glyph_list,
+                                 const VTermScreenCell* cells, int cols,
+                                 const ImVec2& row_pos, float char_width,
+                                 float line_height,
+                                 std::vector<uint32_t>& slots) {
+    CellStyle run_style;
+    int run_start = 0;
+    auto flush = [&](int run_end) {
+        if (run_end > run_start) {
+            _render_vterm_run(
+                draw_list, run_style,
+                ImVec2(row_pos.x + run_start * char_width, row_pos.y),
+                (run_end - run_start) * char_width, line_height);
+        }
+        run_start = run_end;
+    };
+    bool complete = true;
+    ImVec2 slot_size = m_glyph_cache->slot_size();
+    m_box_cells.clear();
+    _resolve_row_colors(cells, cols);
+    for (int x = 0; x < cols; x++) {
+        CellStyle style = _vterm_cell_style(cells[x], x);
+        if (style != run_style) {
+            flush(x);
+            run_style = style;
+        }
+        if (cells[x].width == 1 && BoxDrawing::handles(cells[x].chars[0])) {
+            // Drawn once all backgrounds of the row are.
+            m_box_cells.emplace_back(x, style.fg);
+            continue;
         }
-        draw_list->AddText(char_pos, ImGui::ColorConvertFloat4ToU32(fg), text);
+        // Every glyph sits in its own cell, whatever its advance, so runs
+        // only batch backgrounds and underlines.
+        uint32_t slot = GlyphCache::g_no_slot;
+        complete &= _find_glyph(cells, x, slot);
+        if (slot == GlyphCache::g_no_slot) {
+            continue;
+        }
+        slots.push_back(slot);
+        ImVec2 uv0;
+        ImVec2 uv1;
+        m_glyph_cache->slot_uv(slot, uv0, uv1);
+        ImVec2 p0(row_pos.x + x * char_width, row_pos.y);
+        glyph_list->PrimReserve(6, 4);
+        ImVec2 p1(p0.x + slot_size.x, p0.y + slot_size.y);
+        glyph_list->PrimRectUV(p0, p1, uv0, uv1, style.fg);
+    }
+    flush(cols);
+    for (auto [x, fg] : m_box_cells) {
+        ImVec2 origin(row_pos.x + x * char_width, row_pos.y);
+        float alpha = static_cast<float>((fg >> IM_COL32_A_SHIFT) & 0xFF);
+        for (const BoxDrawing::Rect& rect :
+             m_box_drawing.rects(cells[x].chars[0])) {
+            ImU32 color = (fg & ~IM_COL32_A_MASK) |
+                          static_cast<ImU32>(alpha * rect.alpha)
+                              << IM_COL32_A_SHIFT;
+            draw_list->AddRectFilled(
+                ImVec2(origin.x + rect.p0.x, origin.y + rect.p0.y),
+                ImVec2(origin.x + rect.p1.x, origin.y + rect.p1.y), color);
+        }
+    }
+    return complete;
+}
+
+void Terminal::_render_vterm_run(ImDrawList* draw_list, const CellStyle& style,
+                                 const ImVec2& run_pos, float run_width,
+                                 float line_height) {
+    if (style.background) {
+        draw_list->AddRectFilled(
+            run_pos, ImVec2(run_pos.x + run_width, run_pos.y + line_height),
+            style.bg);
     }
-
-    // Draw underline
-    if (cell.attrs.underline) {
+    if (style.underline) {
         draw_list->AddLine(
-            ImVec2(char_pos.x, char_pos.y + line_height - 1),
-            ImVec2(char_pos.x + char_width, char_pos.y + line_height - 1),
-            ImGui::ColorConvertFloat4ToU32(fg));
+            ImVec2(run_pos.x, run_pos.y + line_height - 1),
+            ImVec2(run_pos.x + run_width, run_pos.y + line_height - 1),
+            style.fg);
     }
 }
 
-void Terminal::_handle_vterm_cell_colors(VTermScreenCell& cell, ImVec4& fg,
-                                         ImVec4& bg) {
-    if (VTERM_COLOR_IS_DEFAULT_FG(&cell.fg)) {
-        fg.x = m_dark_mode ? 1.0f : 0.0f;
-        fg.y = m_dark_mode ? 1.0f : 0.0f;
-        fg.z = m_dark_mode ? 1.0f : 0.0f;
-        fg.w = 1.0f;
-    }
-    if (VTERM_COLOR_IS_INDEXED(&cell.fg)) {
-        auto index = cell.fg.indexed.idx;
-        if (index < 16) {
-            fg = m_default_color_map[index];
-        }
-    }
-    if (VTERM_COLOR_IS_RGB(&cell.fg)) {
-        vterm_screen_convert_color_to_rgb(m_vterm_screen, &cell.fg);
-        fg.x = static_cast<float>(cell.fg.rgb.red) / 256.0f;
-        fg.y = static_cast<float>(cell.fg.rgb.green) / 256.0f;
-        fg.z = static_cast<float>(cell.fg.rgb.blue) / 256.0f;
-        fg.w = 1.0f;
-    }
-    if (VTERM_COLOR_IS_DEFAULT_BG(&cell.bg)) {
-        bg.x = m_dark_mode ? 0.0f : 1.0f;
-        bg.y = m_dark_mode ? 0.0f : 1.0f;
-        bg.z = m_dark_mode ? 0.0f : 1.0f;
-        bg.w = 1.0f;
-    }
-    if (VTERM_COLOR_IS_INDEXED(&cell.bg)) {
-        auto index = cell.bg.indexed.idx;
-        if (index < 16) {
-            bg = m_default_color_map[index];
-        }
-    }
-    if (VTERM_COLOR_IS_RGB(&cell.bg)) {
-        vterm_screen_convert_color_to_rgb(m_vterm_screen, &cell.bg);
-        bg.x = static_cast<float>(cell.bg.rgb.red) / 256.0f;
-        bg.y = static_cast<float>(cell.bg.rgb.green) / 256.0f;
-        bg.z = static_cast<float>(cell.bg.rgb.blue) / 256.0f;
-        bg.w = 1.0f;
+void Terminal::_update_palette() {
+    const ScreenSnapshot& view = *m_view;
+    bool dark_mode = m_dark_mode;
+    if (m_palette.version() != 0 && m_palette_dark_mode == dark_mode &&
+        m_palette_osc_version == view.osc_colors_version) {
+        return;
     }
+    m_palette.rebuild(m_default_color_map, dark_mode, view.osc_colors);
+    m_palette_dark_mode = dark_mode;
+    m_palette_osc_version = view.osc_colors_version;
+}
+
+void Terminal::_resolve_row_colors(const VTermScreenCell* cells, int cols) {
+    m_row_fg.resize(cols);
+    m_row_bg.resize(cols);
+    m_palette.resolve_row(cells, cols, m_row_fg.data(), m_row_bg.data());
+}
+
+Terminal::CellStyle Terminal::_vterm_cell_style(const VTermScreenCell& cell,
+                                                int x) const {
+    ImU32 bg = m_row_bg[x];
+    return {
+        .fg = m_row_fg[x],
+        .bg = bg,
+        // Black backgrounds are left to the window's.
+        .background = (bg & ~IM_COL32_A_MASK) != 0 || cell.attrs.reverse,
+        .underline = cell.attrs.underline != 0,
+    };
 }
 
 void Terminal::_render_cursor(ImDrawList* draw_list, const ImVec2& cursor_pos,
-                              VTermScreenCell& cursor_cell, float char_width,
-                              float line_height, float alpha) {
-    if (m_state.mode & ModeInsert) {
+                              const VTermScreenCell& cursor_cell,
+                              float char_width, float line_height,
+                              float alpha) {
+    if (m_view->mode & ModeInsert) {
         draw_list->AddRectFilled(
             cursor_pos, ImVec2(cursor_pos.x + 2, cursor_pos.y + line_height),
             ImGui::ColorConvertFloat4ToU32(ImVec4(0.7f, 0.7f, 0.7f, alpha)));
     } else if (cursor_cell.chars[0] != '\0') {
-        char text[g_utf_size] = {0};
-        size_t len = 0;
-        for (char i = 0; i < cursor_cell.width; i++) {
-            len += _utf8_encode(cursor_cell.chars[i], &text[len]);
-        }
-        ImVec4 fg{m_dark_mode ? 1.0f : 0.0f, m_dark_mode ? 1.0f : 0.0f,
-                  m_dark_mode ? 1.0f : 0.0f, 1.0f};
-        ImVec4 bg{m_dark_mode ? 0.0f : 1.0f, m_dark_mode ? 0.0f : 1.0f,
-                  m_dark_mode ? 0.0f : 1.0f, 1.0f};
-        _handle_vterm_cell_colors(cursor_cell, fg, bg);
+        ImU32 fg = m_palette.resolve(cursor_cell.fg, Palette::g_default_fg);
 
         ImVec4 cursor_color{m_dark_mode ? 0.7f : 0.3f,
                             m_dark_mode ? 0.7f : 0.3f,
@@ -1172,8 +1714,27 @@ void Terminal::_render_cursor(ImDrawList* draw_list, const ImVec2& cursor_pos,
             cursor_pos,
             ImVec2(cursor_pos.x + char_width, cursor_pos.y + line_height),
             ImGui::ColorConvertFloat4ToU32(cursor_color));
-        draw_list->AddText(cursor_pos, ImGui::ColorConvertFloat4ToU32(fg),
-                           text);
+        // Both halves of a wide character, combining characters are not
+        // drawn.
+        uint8_t style = cursor_cell.attrs.bold ? GlyphCache::StyleBold : 0;
+        ImVec2 slot_size = m_glyph_cache->slot_size();
+        for (int i = 0; i < std::max<int>(cursor_cell.width, 1); i++) {
+            uint8_t half = cursor_cell.width != 2 ? 0
+                           : i == 0               ? GlyphCache::StyleWideLeft
+                                                  : GlyphCache::StyleWideRight;
+            uint32_t slot = m_glyph_cache->find(cursor_cell.chars[0],
+                                                style | half);
+            if (slot == GlyphCache::g_no_slot) {
+                continue;
+            }
+            ImVec2 uv0;
+            ImVec2 uv1;
+            m_glyph_cache->slot_uv(slot, uv0, uv1);
+            ImVec2 p0(cursor_pos.x + i * char_width, cursor_pos.y);
+            draw_list->AddImage(m_glyph_cache->texture_ref(), p0,
+                                ImVec2(p0.x + slot_size.x, p0.y + slot_size.y),
+                                uv0, uv1, fg);
+        }
     } else {
         ImVec4 cursor_color{m_dark_mode ? 0.7f : 0.3f,
                             m_dark_mode ? 0.7f : 0.3f,
@@ -1208,14 +1769,14 @@ void Terminal::_handle_glyph_colors(const Glyph& glyph, ImVec4& fg,
     }
 }
 
-void Terminal::_selection_start(int col, int row) {
+void Terminal::_selection_start(int col, int64_t line) {
     _selection_clear();
     m_selection.mode = SelectionEmpty;
     m_selection.type = SelectionRegular;
-    m_selection.alt = m_state.mode & ModeAltscreen;
+    m_selection.alt = m_view->mode & ModeAltscreen;
     m_selection.snap = 0;
     m_selection.oe.x = m_selection.ob.x = col;
-    m_selection.oe.y = m_selection.ob.y = row;
+    m_selection.oe.y = m_selection.ob.y = line;
     _selection_normalize();
 
     if (m_selection.snap != 0) {
@@ -1223,7 +1784,7 @@ void Terminal::_selection_start(int col, int row) {
     }
 }
 
-void Terminal::_selection_extend(int col, int row) {
+void Terminal::_selection_extend(int col, int64_t line) {
     if (m_selection.mode == SelectionIdle)
         return;
     if (m_selection.mode == SelectionEmpty) {
@@ -1231,7 +1792,7 @@ void Terminal::_selection_extend(int col, int row) {
     }
 
     m_selection.oe.x = col;
-    m_selection.oe.y = row;
+    m_selection.oe.y = line;
     _selection_normalize();
 }
 
@@ -1241,30 +1802,36 @@ void Terminal::_selection_clear() {
     }
     m_selection.mode = SelectionIdle;
     m_selection.ob.x = -1;
+    m_selection_version++;
 }
 
 void Terminal::_get_selection(std::string& selected) {
     if (m_selection.ob.x == -1) {
         return;
     }
+    auto lock = _lock_buffer();
 
-    // Convert selection coordinates to absolute buffer positions
-    int sel_start_y = m_sb_buffer.size() + m_selection.nb.y;
-    int sel_end_y = m_sb_buffer.size() + m_selection.ne.y;
+    // Skip lines dropped from the scrollback and lines below the screen
+    int64_t screen_line = m_sb_buffer.end_line();
+    int64_t sel_start_y = std::max(m_selection.nb.y, m_sb_buffer.first_line());
+    int64_t sel_end_y =
+        std::min<int64_t>(m_selection.ne.y, screen_line + m_state.row - 1);
 
-    for (int abs_y = sel_start_y; abs_y <= sel_end_y; abs_y++) {
+    for (int64_t abs_y = sel_start_y; abs_y <= sel_end_y; abs_y++) {
         const std::vector<VTermScreenCell>* line = nullptr;
 
-        bool use_sb_buffer = abs_y < m_sb_buffer.size();
-        int row_idx = use_sb_buffer ? abs_y : abs_y - m_sb_buffer.size();
+        bool use_sb_buffer = abs_y < screen_line;
+        int row_idx = static_cast<int>(
+            abs_y - (use_sb_buffer ? m_sb_buffer.first_line() : screen_line));
         // Determine which buffer this line is in
-        if (abs_y < m_sb_buffer.size()) {
+        if (use_sb_buffer) {
             // Line is in scrollback buffer
-            line = &m_sb_buffer[abs_y];
+            line = &m_sb_buffer[row_idx].cells;
         }
 
-        int xstart = (abs_y == sel_start_y) ? m_selection.nb.x : 0;
-        int xend = (abs_y == sel_end_y) ? m_selection.ne.x : m_state.col - 1;
+        int xstart = (abs_y == m_selection.nb.y) ? m_selection.nb.x : 0;
+        int xend =
+            (abs_y == m_selection.ne.y) ? m_selection.ne.x : m_state.col - 1;
 
         // Clamp xstart and xend to line size
         if (line != nullptr) {
@@ -1272,13 +1839,14 @@ void Terminal::_get_selection(std::string& selected) {
             xend = std::clamp(xend, 0, static_cast<int>(line->size()) - 1);
         }
 
+        size_t line_start = selected.size();
         for (int x = xstart; x <= xend; x++) {
-            VTermScreenCell* cell = nullptr;
+            const VTermScreenCell* cell = nullptr;
             VTermScreenCell vt_cell;
             // Determine which buffer this cell is in
             if (use_sb_buffer) {
                 // Cell is in scrollback buffer
-                cell = &m_sb_buffer[row_idx][x];
+                cell = &(*line)[x];
             } else {
                 // Cell is in current screen buffer
                 VTermPos vterm_pos{
@@ -1288,17 +1856,28 @@ void Terminal::_get_selection(std::string& selected) {
                 vterm_screen_get_cell(m_vterm_screen, vterm_pos, &vt_cell);
                 cell = &vt_cell;
             }
-            if (cell == nullptr) {
+            // The right half of a wide character holds no text of its own
+            if (cell == nullptr || cell->chars[0] == UINT32_MAX) {
                 continue;
             }
 
-            char buf[g_utf_size];
+            if (cell->chars[0] == 0) {
+                selected += ' '; // Erased, NUL would end the clipboard text
+                continue;
+            }
+            // A code point and its combining characters
+            char buf[VTERM_MAX_CHARS_PER_CELL * g_utf_size];
             size_t len = 0;
-            for (char i = 0; i < cell->width; i++) {
+            for (int i = 0; i < VTERM_MAX_CHARS_PER_CELL && cell->chars[i];
+                 i++) {
                 len += _utf8_encode(cell->chars[i], &buf[len]);
             }
             selected.append(buf, len);
         }
+        // Drop the blank end of the line
+        while (selected.size() > line_start && selected.back() == ' ') {
+            selected.pop_back();
+        }
 
         if (abs_y < sel_end_y) {
             selected += '\n';
@@ -1642,26 +2221,41 @@ void Terminal::_add_to_scrollback(const std::vector<Glyph>& line) {
 }
 
 void Terminal::_add_to_scrollback(int cols, const VTermScreenCell* cells) {
-    auto c = static_cast<size_t>(cols);
-    std::vector<VTermScreenCell> line(cells, cells + c);
-    m_sb_buffer.emplace_back(line);
-    if (m_sb_buffer.size() > m_max_scrollback_lines) {
-        m_sb_buffer.erase(m_sb_buffer.begin());
-    }
+    m_sb_buffer.push(cols, cells, ++m_last_row_version);
 }
 
 int Terminal::_pop_from_scrollback(int cols, VTermScreenCell* cells) {
     if (m_sb_buffer.empty()) {
         return 0;
     }
-    auto& back = m_sb_buffer.back();
-    std::copy(back.begin(), back.end(), cells);
+    // The line may have been pushed at a different width.
+    const auto& back = m_sb_buffer.back().cells;
+    int count = std::min(cols, static_cast<int>(back.size()));
+    std::copy_n(back.begin(), count, cells);
+    VTermScreenCell blank{};
+    blank.fg.type = VTERM_COLOR_DEFAULT_FG;
+    blank.bg.type = VTERM_COLOR_DEFAULT_BG;
+    std::fill(cells + count, cells + cols, blank);
     m_sb_buffer.pop_back();
     return 1;
 }
 
 void Terminal::_scrollback_clear() { m_sb_buffer.clear(); }
 
+void Terminal::_damage_rows(int first, int last) {
+    if (m_row_versions.size() != static_cast<size_t>(m_state.row)) {
+        // Resized, every row is new.
+        m_row_versions.resize(m_state.row);
+        first = 0;
+        last = m_state.row;
+    }
+    first = std::max(first, 0);
+    last = std::min(last, m_state.row);
+    for (int y = first; y < last; y++) {
+        m_row_versions[y] = ++m_last_row_version;
+    }
+}
+
 void Terminal::_parse_csi_param(CSIEscape& csi) {
     char* p = csi.buf;
     csi.args.clear();
@@ -2345,8 +2939,9 @@ void Terminal::_selection_normalize() {
     m_selection.nb.x = std::clamp(m_selection.nb.x, 0, m_state.col - 1);
     m_selection.ne.x = std::clamp(m_selection.ne.x, 0, m_state.col - 1);
 
-    // Don't clamp Y coordinates to allow scrollback selection
-    // Y coordinates can be negative for scrollback lines
+    // Y coordinates are absolute lines and may name lines that have since
+    // been dropped from the scrollback, readers skip those.
+    m_selection_version++;
 }
 
 void Terminal::_strparse() {
@@ -2569,6 +3164,103 @@ size_t Terminal::_utf8_encode(Rune u, char* c) {
     return len;
 }
 
+void Terminal::_handle_osc_colors(int command, std::string_view text) {
+    // Arguments separated by ';', an empty text is one empty argument.
+    std::vector<std::string_view> args;
+    for (size_t start = 0;;) {
+        size_t end = text.find(';', start);
+        args.push_back(text.substr(start, end - start));
+        if (end == std::string_view::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    auto parse_index = [](std::string_view arg, int& index) {
+        auto [end, error] =
+            std::from_chars(arg.data(), arg.data() + arg.size(), index);
+        return error == std::errc() && end == arg.data() + arg.size() &&
+               index >= 0 && index < Palette::g_default_fg;
+    };
+    // Answers with the overridden color, or the one the renderer uses.
+    auto reply = [this](int code, int index) {
+        ImU32 color = m_osc_colors[index];
+        if (!color) {
+            color = Palette::default_color(index, m_default_color_map,
+                                           m_dark_mode);
+        }
+        std::string prefix = code == 4 ? fmt::format("4;{};", index)
+                                       : fmt::format("{};", code);
+        std::string response = fmt::format(
+            "\033]{}{}\033\\", prefix, Palette::format_color(color));
+        _vterm_output(response.data(), response.size(), this);
+    };
+    bool changed = false;
+    auto set = [&](int index, std::string_view spec) {
+        ImU32 color = 0;
+        if (Palette::parse_color(spec, color)) {
+            m_osc_colors[index] = color;
+            changed = true;
+        } else {
+            LOG_WARN("Ignoring OSC color '{}'.", spec);
+        }
+    };
+
+    switch (command) {
+    case 4:
+        for (size_t i = 0; i + 1 < args.size(); i += 2) {
+            int index = 0;
+            if (!parse_index(args[i], index)) {
+                continue;
+            }
+            if (args[i + 1] == "?") {
+                reply(4, index);
+            } else {
+                set(index, args[i + 1]);
+            }
+        }
+        break;
+    case 10:
+    case 11:
+        // Each further argument sets the next of the dynamic colors.
+        for (size_t i = 0; i < args.size(); i++) {
+            int code = command + static_cast<int>(i);
+            if (code > 11) {
+                break;
+            }
+            int index = code == 10 ? Palette::g_default_fg
+                                   : Palette::g_default_bg;
+            if (args[i] == "?") {
+                reply(code, index);
+            } else {
+                set(index, args[i]);
+            }
+        }
+        break;
+    case 104:
+        if (text.empty()) {
+            std::fill_n(m_osc_colors.begin(), Palette::g_default_fg, 0);
+            changed = true;
+        }
+        for (std::string_view arg : args) {
+            int index = 0;
+            if (parse_index(arg, index)) {
+                m_osc_colors[index] = 0;
+                changed = true;
+            }
+        }
+        break;
+    case 110:
+    case 111:
+        m_osc_colors[command == 110 ? Palette::g_default_fg
+                                    : Palette::g_default_bg] = 0;
+        changed = true;
+        break;
+    }
+    if (changed) {
+        m_osc_colors_version++;
+    }
+}
+
 #pragma region vterm callbacks
 int Terminal::_vterm_settermprop(VTermProp prop, VTermValue* val, void* data) {
     // TODO: other prop.
@@ -2577,6 +3269,9 @@ int Terminal::_vterm_settermprop(VTermProp prop, VTermValue* val, void* data) {
     case VTERM_PROP_ALTSCREEN:
         self->_set_mode(val->boolean, ModeAltscreen);
         break;
+    case VTERM_PROP_CURSORVISIBLE:
+        self->m_cursor_visible = val->boolean;
+        break;
     default:
         return 0;
     }
@@ -2584,14 +3279,35 @@ int Terminal::_vterm_settermprop(VTermProp prop, VTermValue* val, void* data) {
 }
 
 int Terminal::_vterm_damage(VTermRect rect, void* data) {
+    IM_APP_TRACE_SCOPE("Terminal::_vterm_damage");
     auto* self = static_cast<Terminal*>(data);
+    self->_damage_rows(rect.start_row, rect.end_row);
     self->_clear_region(rect.start_col, rect.start_row, rect.end_col,
                         rect.end_row);
     return 1;
 }
 
 int Terminal::_vterm_moverect(VTermRect dest, VTermRect src, void* data) {
+    IM_APP_TRACE_SCOPE("Terminal::_vterm_moverect");
     auto* self = static_cast<Terminal*>(data);
+    int cols = self->m_state.col;
+    bool whole_rows = dest.start_col == 0 && dest.end_col == cols &&
+                      src.start_col == 0 && src.end_col == cols;
+    self->_damage_rows(0, 0); // Only catches up with a resize
+    if (whole_rows &&
+        std::max(src.end_row, dest.end_row) <= self->m_state.row) {
+        // A scroll, the rows keep their versions and thereby their cache.
+        auto& versions = self->m_row_versions;
+        auto first = versions.begin() + src.start_row;
+        auto last = versions.begin() + src.end_row;
+        if (dest.start_row < src.start_row) {
+            std::copy(first, last, versions.begin() + dest.start_row);
+        } else {
+            std::copy_backward(first, last, versions.begin() + dest.end_row);
+        }
+    } else {
+        self->_damage_rows(dest.start_row, dest.end_row);
+    }
     self->_clear_region(std::min(dest.start_col, src.start_col),
                         std::min(dest.start_row, src.start_row),
                         std::max(dest.end_col, src.end_col),
@@ -2614,12 +3330,14 @@ int Terminal::_vterm_bell(void* data) {
 
 int Terminal::_vterm_sb_pushline(int cols, const VTermScreenCell* cells,
                                  void* data) {
+    IM_APP_TRACE_SCOPE("Terminal::_vterm_sb_pushline");
     auto* self = static_cast<Terminal*>(data);
     self->_add_to_scrollback(cols, cells);
     return 1;
 }
 
 int Terminal::_vterm_sb_popline(int cols, VTermScreenCell* cells, void* data) {
+    IM_APP_TRACE_SCOPE("Terminal::_vterm_sb_popline");
     auto* self = static_cast<Terminal*>(data);
     return self->_pop_from_scrollback(cols, cells);
 }
@@ -2630,9 +3348,38 @@ int Terminal::_vterm_sb_clear(void* data) {
     return 1;
 }
 
+int Terminal::_vterm_osc(int command, VTermStringFragment frag, void* data) {
+    switch (command) {
+    case 4:   // Set or query indexed colors
+    case 10:  // Default foreground
+    case 11:  // Default background
+    case 104: // Reset indexed colors
+    case 110: // Reset default foreground
+    case 111: // Reset default background
+        break;
+    default:
+        return 0;
+    }
+    auto* self = static_cast<Terminal*>(data);
+    if (frag.initial) {
+        self->m_osc_text.clear();
+    }
+    // Valid sequences are short, don't buffer whatever else streams by.
+    if (self->m_osc_text.size() < g_max_osc_length) {
+        self->m_osc_text.append(frag.str, frag.len);
+    }
+    if (frag.final) {
+        self->_handle_osc_colors(command, self->m_osc_text);
+    }
+    return 1;
+}
+
 void Terminal::_vterm_output(const char* s, size_t len, void* data) {
     auto* self = static_cast<Terminal*>(data);
-    self->m_pty->write(s, len);
+    size_t accepted = self->m_pty->write(s, len);
+    if (accepted < len) {
+        LOG_WARN("PTY input queue full, dropped {} bytes.", len - accepted);
+    }
 }
 #pragma endregion
 } // namespace ImNeovim
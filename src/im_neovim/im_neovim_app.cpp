@@ -1,24 +1,297 @@
 #include "im_neovim/gui/terminal.h"
 #include "im_neovim/logging.h"
+#include <algorithm>
+#include <cstdlib>
+#include <optional>
 #include <im_app/application.h>
 #include <im_app/file_system.h>
 #include <im_app/layer.h>
+#include <im_app/pty_pool.h>
+#include <im_app/trace.h>
 #include <imgui.h>
 #include <spdlog/sinks/daily_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
+#include <string_view>
+#include <vector>
 
 namespace ImNeovim {
+struct LaunchOptions {
+    std::filesystem::path record_path;             // --record <file>
+    std::filesystem::path replay_path;             // --replay <file>
+    bool replay_timed{false};                      // --replay-timed
+    size_t pty_pool_size{1};                       // --pty-pool <count>
+    bool low_latency{false};                       // --low-latency
+    uint32_t max_frame_rate{240};                  // --max-fps <rate>
+    size_t latency_test_samples{0};                // --latency-test <count>
+    bool frame_overlay{false};                     // --frame-overlay
+    std::filesystem::path frame_csv_path;          // --frame-csv <file>
+    std::filesystem::path trace_path;              // --trace <file>
+    bool headless{false};                          // --headless
+    size_t bench_frames{0};                        // --bench-frames <count>
+    bool bench_select{false};                      // --bench-select
+    bool cell_grid{false};                         // --cell-grid
+    std::vector<std::filesystem::path> font_paths; // --font <file>, repeatable
+};
+
 class MyLayer : public ImApp::Layer {
   public:
+    explicit MyLayer(const LaunchOptions& options)
+        : m_replay(_open_replay(options)),
+          m_pty_pool(std::make_unique<ImApp::PseudoTerminalPool>(
+              options.pty_pool_size, Terminal::g_default_rows,
+              Terminal::g_default_cols)),
+          m_terminal(m_replay ? m_replay->pty : _take_pty()),
+          m_cell_grid(options.cell_grid), m_font_paths(options.font_paths),
+          m_frame_csv_path(options.frame_csv_path),
+          m_trace_path(options.trace_path),
+          m_latency_test_samples(options.latency_test_samples),
+          m_bench_frames(options.bench_frames),
+          m_bench_select(options.bench_select) {
+        if (m_replay) {
+            // Replay at the recorded sizes, not the window's.
+            m_terminal.set_fixed_size(m_replay->cols, m_replay->rows);
+            m_replay->pty->set_resize_handler(
+                [this](uint16_t rows, uint16_t cols) {
+                    m_terminal.set_fixed_size(cols, rows);
+                });
+        }
+        if (!options.record_path.empty()) {
+            m_terminal.record_session(options.record_path);
+        }
+        _configure(m_terminal);
+        m_next_test_key = std::chrono::steady_clock::now() +
+                          g_latency_test_start_delay;
+    }
+
+    void on_detach() override {
+        if (!m_frame_csv_path.empty()) {
+            IM_APP.get_frame_profiler().export_csv(m_frame_csv_path);
+        }
+        if (!m_trace_path.empty()) {
+            ImApp::Tracer::instance().stop(m_trace_path);
+        }
+    }
+
     void on_imgui_render() override {
         ImGui::ShowDemoWindow();
+        _render_menu_bar();
+        if (m_bench_frames > 0 && m_bench_select) {
+            m_terminal.select_view();
+        }
         m_terminal.render();
+        // Closed windows give their shells back to the system.
+        std::erase_if(m_terminals, [](const auto& terminal) {
+            return !terminal->is_visible();
+        });
+        for (auto& terminal : m_terminals) {
+            terminal->render();
+        }
+        if (m_latency_test_samples > 0) {
+            _run_latency_test();
+        }
+    }
+
+    bool needs_frame() const override {
+        return m_terminal.needs_frame() || m_bench_frames > 0 ||
+               std::ranges::any_of(m_terminals, [](const auto& terminal) {
+                   return terminal->needs_frame();
+               });
+    }
+
+    void on_frame_presented() override {
+        m_terminal.on_frame_presented();
+        for (auto& terminal : m_terminals) {
+            terminal->on_frame_presented();
+        }
+        if (m_bench_frames > 0) {
+            _count_bench_frame();
+        }
     }
 
   private:
+    std::optional<SessionReplay> m_replay; // --replay
+    // Owned from startup, so shells are warm by the time a terminal opens.
+    // Declared before the terminals, which take their PTYs from it.
+    std::unique_ptr<ImApp::PseudoTerminalPool> m_pty_pool;
     Terminal m_terminal;
+    // Opened from the menu bar, numbered from 2 on
+    std::vector<std::unique_ptr<Terminal>> m_terminals;
+    size_t m_next_terminal_number{2};
+    // Applied to every terminal
+    bool m_cell_grid;
+    std::vector<std::filesystem::path> m_font_paths;
+    // Frame timings of the last frames are saved here on exit
+    std::filesystem::path m_frame_csv_path;
+    // Chrome trace of the whole session is written here on exit
+    std::filesystem::path m_trace_path;
+
+    // Types a key at the shell prompt every `g_latency_test_period` and
+    // reports how long its echo took to reach the screen.
+    static constexpr std::chrono::seconds g_latency_test_start_delay{2};
+    static constexpr std::chrono::milliseconds g_latency_test_period{100};
+    size_t m_latency_test_samples;
+    std::chrono::steady_clock::time_point m_next_test_key;
+
+    void _run_latency_test() {
+        auto stats = m_terminal.echo_latency_stats();
+        if (stats.samples >= m_latency_test_samples) {
+            m_terminal.send_keys("\x15"); // Ctrl-U clears the typed keys
+            auto ms = [](std::chrono::nanoseconds duration) {
+                return std::chrono::duration<double, std::milli>(duration)
+                    .count();
+            };
+            LOG_INFO("Key-to-present latency over {} keys: p50 {:.2f} ms, p99 "
+                     "{:.2f} ms, max {:.2f} ms.",
+                     stats.samples, ms(stats.p50), ms(stats.p99),
+                     ms(stats.max));
+            m_latency_test_samples = 0;
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now >= m_next_test_key) {
+            m_terminal.send_keys("x");
+            m_next_test_key = now + g_latency_test_period;
+        }
+        IM_APP.request_frame(m_next_test_key - now);
+    }
+
+    // Renders `m_bench_frames` frames as fast as possible, then reports what
+    // they drew and exits.
+    size_t m_bench_frames;
+    bool m_bench_select; // Keeps the whole view selected while benchmarking
+    struct BenchTotals {
+        size_t frames{0};
+        size_t vertices{0};
+        size_t indices{0};
+        size_t commands{0};
+        size_t max_vertices{0};
+    } m_bench;
+
+    void _count_bench_frame() {
+        const ImDrawData* draw_data = ImGui::GetDrawData();
+        if (draw_data && draw_data->Valid) {
+            size_t commands = 0;
+            for (const ImDrawList* draw_list : draw_data->CmdLists) {
+                commands += draw_list->CmdBuffer.Size;
+            }
+            m_bench.vertices += draw_data->TotalVtxCount;
+            m_bench.indices += draw_data->TotalIdxCount;
+            m_bench.commands += commands;
+            m_bench.max_vertices =
+                std::max(m_bench.max_vertices,
+                         static_cast<size_t>(draw_data->TotalVtxCount));
+        }
+        if (++m_bench.frames < m_bench_frames) {
+            return;
+        }
+        auto frame = IM_APP.get_frame_profiler().summary(
+            ImApp::FrameProfiler::StageFrame);
+        double frames = static_cast<double>(m_bench.frames);
+        LOG_INFO("Rendered {} frames: {:.0f} vertices, {:.0f} indices, {:.1f} "
+                 "draw commands per frame, at most {} vertices.",
+                 m_bench.frames, m_bench.vertices / frames,
+                 m_bench.indices / frames, m_bench.commands / frames,
+                 m_bench.max_vertices);
+        LOG_INFO("Frame time: p50 {:.3f} ms, p99 {:.3f} ms, max {:.3f} ms.",
+                 frame.p50_ms, frame.p99_ms, frame.max_ms);
+        auto stats = m_terminal.throughput_stats();
+        LOG_INFO("Built {:.1f} rows per frame, the rest came from the row "
+                 "cache.",
+                 stats.built_rows / frames);
+        m_bench_frames = 0;
+        IM_APP.exit();
+    }
+
+    std::shared_ptr<ImApp::PseudoTerminal> _take_pty() {
+        return m_pty_pool->acquire(Terminal::g_default_rows,
+                                   Terminal::g_default_cols);
+    }
+
+    void _render_menu_bar() {
+        if (!ImGui::BeginMainMenuBar()) {
+            return;
+        }
+        if (ImGui::BeginMenu("Terminal")) {
+            if (ImGui::MenuItem("New")) {
+                _open_terminal();
+            }
+            ImGui::EndMenu();
+        }
+        ImGui::EndMainMenuBar();
+    }
+
+    void _configure(Terminal& terminal) const {
+        terminal.set_cell_grid_enabled(m_cell_grid);
+        for (const auto& path : m_font_paths) {
+            terminal.add_font(path);
+        }
+    }
+
+    void _open_terminal() {
+        auto terminal = std::make_unique<Terminal>(_take_pty());
+        terminal->set_window_title(
+            fmt::format("Terminal {}", m_next_terminal_number++));
+        _configure(*terminal);
+        m_terminals.push_back(std::move(terminal));
+    }
+
+    static std::optional<SessionReplay>
+    _open_replay(const LaunchOptions& options) {
+        if (options.replay_path.empty()) {
+            return std::nullopt;
+        }
+        // Falls back to a shell when the recording can't be opened.
+        return open_session_replay(
+            options.replay_path,
+            options.replay_timed
+                ? ImApp::MemoryPseudoTerminal::Timing::Recorded
+                : ImApp::MemoryPseudoTerminal::Timing::FullSpeed);
+    }
 };
+
+static LaunchOptions parse_launch_options(int argc, char** argv) {
+    LaunchOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--record" && i + 1 < argc) {
+            options.record_path = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            options.replay_path = argv[++i];
+        } else if (arg == "--replay-timed") {
+            options.replay_timed = true;
+        } else if (arg == "--pty-pool" && i + 1 < argc) {
+            options.pty_pool_size = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--low-latency") {
+            options.low_latency = true;
+        } else if (arg == "--max-fps" && i + 1 < argc) {
+            options.max_frame_rate = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--frame-overlay") {
+            options.frame_overlay = true;
+        } else if (arg == "--frame-csv" && i + 1 < argc) {
+            options.frame_csv_path = argv[++i];
+        } else if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--bench-frames" && i + 1 < argc) {
+            options.bench_frames = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--bench-select") {
+            options.bench_select = true;
+        } else if (arg == "--cell-grid") {
+            options.cell_grid = true;
+        } else if (arg == "--font" && i + 1 < argc) {
+            options.font_paths.emplace_back(argv[++i]);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            options.trace_path = argv[++i];
+        } else if (arg == "--latency-test" && i + 1 < argc) {
+            options.latency_test_samples =
+                std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            LOG_WARN("Ignoring unknown argument '{}'.", arg);
+        }
+    }
+    return options;
+}
+
 static void initialize_logger() {
     auto stdout_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
 #if defined(IM_NVIM_DEBUG)
@@ -58,10 +331,20 @@ static void initialize_logger() {
 
 namespace ImApp {
 Application* create_im_app(int argc, char** argv) {
-    AppSpec app_spec{.main_window_no_border = false};
-    auto* app = new Application(app_spec);
     ImNeovim::initialize_logger();
-    app->push_layer<ImNeovim::MyLayer>();
+    auto options = ImNeovim::parse_launch_options(argc, argv);
+    if (!options.trace_path.empty()) {
+        Tracer::instance().start();
+    }
+    AppSpec app_spec{
+        .main_window_no_border = false,
+        .graphics_backend = options.headless ? Headless : PerformanceFirst,
+        .present_mode = options.low_latency ? LowLatency : VSync,
+        .max_frame_rate = options.max_frame_rate,
+    };
+    auto* app = new Application(app_spec);
+    app->get_frame_profiler().set_overlay_visible(options.frame_overlay);
+    app->push_layer(std::make_shared<ImNeovim::MyLayer>(options));
     return app;
 }
 } // namespace ImApp
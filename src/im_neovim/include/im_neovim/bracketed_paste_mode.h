@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ImNeovim {
+/*
+ * Follows DECSET/DECRST 2004 in the output fed to libvterm, which applies
+ * the mode internally without reporting it through any callback. Sequences
+ * may be split across chunks. `scan` belongs to the parser thread,
+ * `is_set` may be called from any thread.
+ */
+class BracketedPasteMode {
+  public:
+    void scan(const char* data, size_t size);
+    bool is_set() const { return m_set.load(std::memory_order_relaxed); }
+
+  private:
+    enum class State : uint8_t { Ground, Escape, CsiStart, Csi, PrivateCsi };
+
+    static constexpr uint32_t g_mode = 2004;
+    // Larger parameters can't match, stop counting there.
+    static constexpr uint32_t g_max_param = 100000;
+
+    void _finish_param();
+
+    State m_state{State::Ground};
+    uint32_t m_param{0};
+    bool m_matched{false}; // 2004 among the parameters so far
+    bool m_bang{false};    // DECSTR intermediate
+    std::atomic<bool> m_set{false};
+};
+} // namespace ImNeovim
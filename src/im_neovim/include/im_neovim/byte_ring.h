@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace ImNeovim {
+/*
+ * Single-producer/single-consumer queue of page-sized byte slots.
+ *
+ * All slots are allocated up front: the producer reads straight into the
+ * slot returned by `acquire_slot` and publishes it with `commit_slot`, the
+ * consumer walks every committed slot in one `consume` call. Nothing on
+ * either side takes a lock or allocates.
+ */
+class ByteRing {
+  public:
+    static constexpr size_t g_slot_size = 4096;
+
+    explicit ByteRing(size_t slot_count);
+    ByteRing(const ByteRing&) = delete;
+    ByteRing(ByteRing&&) = delete;
+    ByteRing& operator=(const ByteRing&) = delete;
+    ByteRing& operator=(ByteRing&&) = delete;
+
+    // Producer side
+    // Blocks until a slot is free. Returns false once the ring is closed.
+    bool wait_for_space();
+    // Returns the next free slot (`g_slot_size` bytes), nullptr when full.
+    char* acquire_slot();
+    void commit_slot(size_t size);
+
+    // Consumer side
+    // Blocks until a slot is committed or `wake_consumer` is called. Returns
+    // false once the ring is closed and fully drained.
+    bool wait_for_data();
+    void wake_consumer();
+    // Calls `fn(const char* data, size_t size)` for every committed slot,
+    // releases them and returns the number of bytes consumed.
+    template <typename Fn> size_t consume(Fn&& fn) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_acquire);
+        if (tail == head) {
+            return 0;
+        }
+        size_t bytes = 0;
+        for (; tail != head; ++tail) {
+            const Slot& slot = m_slots[tail % m_slot_count];
+            fn(static_cast<const char*>(slot.data), slot.size);
+            bytes += slot.size;
+            m_tail.store(tail + 1, std::memory_order_release);
+        }
+        _signal(m_space_signal);
+        return bytes;
+    }
+
+    // Wakes both sides up for shutdown.
+    void close();
+    bool is_closed() const { return m_closed.load(std::memory_order_acquire); }
+
+    // Counters, in slots
+    size_t capacity() const { return m_slot_count; }
+    size_t fill_level() const {
+        return m_head.load(std::memory_order_acquire) -
+               m_tail.load(std::memory_order_acquire);
+    }
+    size_t high_water_mark() const {
+        return m_high_water_mark.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Slot {
+        size_t size{0};
+        char data[g_slot_size];
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_slot_count;
+
+    // Producer and consumer indices live on separate cache lines.
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+    alignas(64) std::atomic<uint32_t> m_data_signal{0};
+    std::atomic<uint32_t> m_space_signal{0};
+    std::atomic<size_t> m_high_water_mark{0};
+    std::atomic<bool> m_closed{false};
+
+    static void _signal(std::atomic<uint32_t>& signal);
+};
+} // namespace ImNeovim
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "imgui.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ImNeovim {
+/*
+ * Box drawing (U+2500-U+257F), block elements (U+2580-U+259F) and braille
+ * (U+2800-U+28FF) as rectangles reaching the edges of their cell, so
+ * borders join without the gaps font glyphs leave at fractional cell sizes.
+ * The rectangles of a character are computed on first use and kept until
+ * the cell size changes. Diagonals are left to the font.
+ */
+class BoxDrawing {
+  public:
+    using Rune = uint_least32_t;
+
+    // Relative to the top left of the cell. `alpha` scales the foreground
+    // alpha, below 1 only for shades.
+    struct Rect {
+        ImVec2 p0;
+        ImVec2 p1;
+        float alpha{1.0f};
+    };
+
+    static bool handles(Rune u);
+
+    void set_cell_size(const ImVec2& cell_size);
+    // Empty for characters `handles` rejects.
+    std::span<const Rect> rects(Rune u);
+
+  private:
+    struct Range {
+        uint32_t offset{0};
+        uint32_t count{0};
+        bool built{false};
+    };
+
+    ImVec2 m_cell_size;
+    std::vector<Range> m_ranges; // Indexed like the classification table
+    std::vector<Rect> m_rects;
+
+    void _build(Rune u, std::vector<Rect>& rects) const;
+    void _build_lines(uint16_t lines, std::vector<Rect>& rects) const;
+    void _build_braille(uint8_t dots, std::vector<Rect>& rects) const;
+};
+} // namespace ImNeovim
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "im_neovim/gui/box_drawing.h"
+#include "imgui.h"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ImNeovim {
+/*
+ * Glyphs of the terminal font, rasterized on first use into a fixed-size
+ * atlas of cell-sized slots. Once the atlas is full the least recently used
+ * glyphs are evicted, so memory stays bounded however much of Unicode
+ * streams by. A glyph two cells wide takes a slot per half, every cell maps
+ * to exactly one slot. Only the main thread may use it.
+ */
+class GlyphCache {
+  public:
+    using Rune = uint_least32_t;
+
+    enum Style : uint8_t {
+        StyleBold = 1 << 0,
+        StyleWideLeft = 1 << 1, // Halves of a glyph two cells wide
+        StyleWideRight = 1 << 2,
+    };
+
+    static constexpr uint32_t g_no_slot = UINT32_MAX;
+    static constexpr int g_atlas_size = 1024;
+
+    GlyphCache();
+    ~GlyphCache();
+    GlyphCache(const GlyphCache&) = delete;
+    GlyphCache& operator=(const GlyphCache&) = delete;
+
+    // Each glyph comes from the first font that has it, in the order the
+    // fonts were added. `data` must outlive the cache.
+    bool add_font(const std::filesystem::path& path);
+    bool add_font(const void* data, size_t size);
+    bool has_fonts() const { return !m_fonts.empty(); }
+
+    // Starts a frame, dropping all glyphs when the cell or font size changed.
+    void begin_frame(const ImVec2& cell_size, float font_size);
+    // The slot holding `u`, rasterized if needed. `g_no_slot` if every slot
+    // holds a glyph used in this frame.
+    uint32_t find(Rune u, uint8_t style);
+    // Keeps a slot found in an earlier frame from being evicted in this one.
+    void touch(uint32_t slot);
+
+    ImTextureRef texture_ref() const;
+    ImVec2 slot_size() const;
+    uint32_t slot_count() const {
+        return static_cast<uint32_t>(m_slots.size());
+    }
+    void slot_uv(uint32_t slot, ImVec2& uv0, ImVec2& uv1) const;
+    // Bumped when all glyphs are dropped, slots found before are invalid.
+    uint64_t epoch() const { return m_epoch; }
+
+  private:
+    struct FontFace; // stb_truetype state
+
+    struct Slot {
+        uint64_t key{0}; // Rune << 8 | style
+        uint64_t last_used{0};
+        // Least recently used list, from `m_lru_head` (newest) to the tail
+        uint32_t prev{g_no_slot};
+        uint32_t next{g_no_slot};
+    };
+
+    // Second lookup level, the slots + 1 of 256 consecutive code points in
+    // one style, 0 if not cached
+    struct Page {
+        std::array<uint32_t, 256> slots{};
+        uint32_t used{0};
+    };
+
+    std::vector<std::unique_ptr<FontFace>> m_fonts;
+    std::unique_ptr<ImTextureData> m_texture;
+    ImVec2 m_cell_size;
+    float m_font_size{0.0f};
+    int m_slot_width{0};
+    int m_slot_height{0};
+    int m_slots_per_row{0};
+
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_free_slots;
+    uint32_t m_lru_head{g_no_slot};
+    uint32_t m_lru_tail{g_no_slot};
+    // First lookup level, keyed by style << 24 | code point >> 8. The last
+    // page is remembered, as text mostly stays within a script.
+    std::unordered_map<uint32_t, Page> m_pages;
+    uint32_t m_last_page_key{0};
+    Page* m_last_page{nullptr};
+
+    uint64_t m_frame{0};
+    uint64_t m_epoch{0};
+    std::vector<unsigned char> m_canvas; // Both cells of a wide glyph
+    std::vector<unsigned char> m_bitmap;
+    BoxDrawing m_box_drawing; // At the slot size, so boxes fill their slot
+
+    void _reset();
+    Page* _find_page(uint32_t page_key);
+    uint32_t _allocate_slot();
+    void _evict();
+    void _unlink(uint32_t slot);
+    void _link_front(uint32_t slot);
+    void _rasterize(uint32_t slot, Rune u, uint8_t style);
+    void _rasterize_box(Rune u);
+    void _rasterize_font(Rune u, uint8_t style, int canvas_width);
+    void _queue_upload(int x, int y, int width, int height);
+};
+} // namespace ImNeovim
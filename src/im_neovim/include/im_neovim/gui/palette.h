@@ -0,0 +1,57 @@
+#pragma once
+
+#include "imgui.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vterm.h>
+
+namespace ImNeovim {
+/*
+ * The 256 indexed colors and the default foreground and background, packed
+ * so a cell's colors resolve with a table lookup. Rebuilt only when dark
+ * mode changes or the child sets colors with OSC 4/10/11.
+ */
+class Palette {
+  public:
+    static constexpr int g_default_fg = 256;
+    static constexpr int g_default_bg = 257;
+    static constexpr int g_size = 258;
+    // Indexed like the palette, 0 where a color is not overridden
+    using Colors = std::array<ImU32, g_size>;
+
+    // `ansi` are the first 16 colors, the rest is xterm's color cube and
+    // gray ramp.
+    void rebuild(const ImVec4 (&ansi)[16], bool dark_mode,
+                 const Colors& overrides);
+    // Bumped by every rebuild, 0 before the first.
+    uint64_t version() const { return m_version; }
+    ImU32 operator[](int index) const { return m_colors[index]; }
+
+    ImU32 resolve(const VTermColor& color, int default_index) const {
+        if (color.type & VTERM_COLOR_DEFAULT_MASK) {
+            return m_colors[default_index];
+        }
+        if (VTERM_COLOR_IS_INDEXED(&color)) {
+            return m_colors[color.indexed.idx];
+        }
+        return IM_COL32(color.rgb.red, color.rgb.green, color.rgb.blue, 255);
+    }
+    // Resolves both colors of `count` cells.
+    void resolve_row(const VTermScreenCell* cells, int count, ImU32* fg,
+                     ImU32* bg) const;
+
+    static ImU32 default_color(int index, const ImVec4 (&ansi)[16],
+                               bool dark_mode);
+    // X11 color specs as used by OSC 4/10/11: rgb:R/G/B with 1 to 4 hex
+    // digits per channel, or #RGB, #RRGGBB and #RRRRGGGGBBBB.
+    static bool parse_color(std::string_view spec, ImU32& color);
+    // rgb:RRRR/GGGG/BBBB, how xterm answers color queries
+    static std::string format_color(ImU32 color);
+
+  private:
+    Colors m_colors{};
+    uint64_t m_version{0};
+};
+} // namespace ImNeovim
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "im_neovim/gui/palette.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <vterm.h>
+
+namespace ImNeovim {
+/*
+ * Everything the renderer needs to draw one frame of a terminal, copied out
+ * of libvterm by the parser thread. `cells` already holds the scrolled view,
+ * scrollback lines included, so drawing never touches libvterm state.
+ */
+struct ScreenSnapshot {
+    int rows{0};
+    int cols{0};
+    std::vector<VTermScreenCell> cells; // rows * cols, row-major
+    // Changes whenever a row's content does, equal versions mean equal rows.
+    std::vector<uint64_t> row_versions;
+
+    // Cursor in view coordinates, `cursor_y` is -1 when it is scrolled away.
+    int cursor_x{0};
+    int cursor_y{-1};
+    bool cursor_visible{true};
+    uint32_t mode{0}; // Terminal::Mode bits
+
+    int scrollback_size{0}; // lines in the scrollback buffer
+    int scroll_offset{0};   // lines scrolled back from the bottom
+    // Absolute lines, see `Scrollback`, of the first row and of screen row 0
+    int64_t first_line{0};
+    int64_t screen_line{0};
+    uint64_t sequence{0}; // increments on every publish
+
+    // Colors the child set with OSC 4/10/11, only copied when the version
+    // changed since this buffer was last published.
+    Palette::Colors osc_colors{};
+    uint64_t osc_colors_version{0};
+
+    const VTermScreenCell& cell(int x, int y) const {
+        return cells[static_cast<size_t>(y) * cols + x];
+    }
+};
+
+/*
+ * Lock-free triple buffer handing snapshots from one writer to one reader.
+ * The writer fills `back()` and calls `publish()`; the reader calls
+ * `acquire()` and may use the result until its next `acquire()`. Neither
+ * side ever waits and slots are reused, so steady state does not allocate.
+ */
+class SnapshotExchange {
+  public:
+    ScreenSnapshot& back() { return m_slots[m_back]; }
+
+    void publish() {
+        m_back = m_middle.exchange(m_back | g_fresh_bit,
+                                   std::memory_order_acq_rel) &
+                 g_index_mask;
+    }
+
+    const ScreenSnapshot& acquire() {
+        if (m_middle.load(std::memory_order_relaxed) & g_fresh_bit) {
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) &
+                      g_index_mask;
+        }
+        return m_slots[m_front];
+    }
+
+  private:
+    static constexpr int g_index_mask = 0x3;
+    static constexpr int g_fresh_bit = 0x4;
+
+    ScreenSnapshot m_slots[3];
+    int m_back{0};  // owned by the writer
+    int m_front{1}; // owned by the reader
+    std::atomic<int> m_middle{2};
+};
+} // namespace ImNeovim
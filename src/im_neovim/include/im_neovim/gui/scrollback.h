@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <vterm.h>
+
+namespace ImNeovim {
+/*
+ * Lines scrolled off the top of the screen, oldest first, in a ring of at
+ * most `capacity` lines. Once full, a push overwrites the oldest line and
+ * reuses its cells, so pushing, popping and indexing are all O(1).
+ *
+ * Lines also have absolute numbers, counting every line ever pushed. They
+ * do not change when older lines are dropped, which lets a selection stay
+ * on its text while output scrolls.
+ */
+class Scrollback {
+  public:
+    struct Line {
+        std::vector<VTermScreenCell> cells; // as wide as the screen was
+        uint64_t version{0};                // for the renderer's row cache
+    };
+
+    explicit Scrollback(size_t capacity) : m_capacity(capacity) {}
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    // Absolute number of the oldest line.
+    int64_t first_line() const { return m_first_line; }
+    // Absolute number after the newest line, that of screen row 0.
+    int64_t end_line() const { return m_first_line + m_size; }
+
+    // `index` counts from the oldest line.
+    const Line& operator[](size_t index) const {
+        return m_lines[_slot(index)];
+    }
+    const Line& back() const { return (*this)[m_size - 1]; }
+
+    void push(int cols, const VTermScreenCell* cells, uint64_t version);
+    void pop_back();
+    // Numbering continues after the dropped lines.
+    void clear();
+
+  private:
+    // Grows up to the capacity and then wraps, `m_head` stays 0 until then.
+    std::vector<Line> m_lines;
+    size_t m_capacity;
+    size_t m_head{0}; // slot of the oldest line
+    size_t m_size{0};
+    int64_t m_first_line{0};
+
+    size_t _slot(size_t index) const {
+        size_t slot = m_head + index;
+        return slot < m_lines.size() ? slot : slot - m_lines.size();
+    }
+};
+} // namespace ImNeovim
@@ -1,10 +1,27 @@
 #pragma once
 
 #include "im_app/pty.h"
+#include "im_neovim/bracketed_paste_mode.h"
+#include "im_neovim/byte_ring.h"
+#include "im_neovim/gui/box_drawing.h"
+#include "im_neovim/gui/glyph_cache.h"
+#include "im_neovim/gui/palette.h"
+#include "im_neovim/gui/screen_snapshot.h"
+#include "im_neovim/gui/scrollback.h"
+#include "im_neovim/output_flood.h"
+#include "im_neovim/paste_stream.h"
+#include "im_neovim/session_recording.h"
 #include "imgui.h"
+#include <im_app/cell_grid_renderer.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <unordered_map>
 #include <vector>
@@ -126,25 +143,77 @@ class Terminal {
         SelectionType type{SelectionRegular};
         int snap{0};
         struct {
-            int x, y;
+            int x;
+            int64_t y; // absolute line, see `Scrollback`
         } nb, ne, ob, oe; // normalized begin/end, original begin/end
         int alt{0};
     };
 
-    Terminal();
+    // Counters for measuring ingest and render throughput
+    struct ThroughputStats {
+        uint64_t parsed_bytes{0};
+        std::chrono::nanoseconds parse_time{0};
+        uint64_t rendered_frames{0};
+        std::chrono::nanoseconds render_time{0};
+        // Rows drawn from their cells, all others came from the row cache
+        uint64_t built_rows{0};
+    };
+
+    // Time from a keystroke to presenting the first frame that shows output
+    // the child wrote after it, usually the echo
+    struct LatencyStats {
+        size_t samples{0};
+        std::chrono::nanoseconds p50{0};
+        std::chrono::nanoseconds p99{0};
+        std::chrono::nanoseconds max{0};
+    };
+
+    // Geometry until the window is laid out
+    static constexpr uint16_t g_default_rows = 24;
+    static constexpr uint16_t g_default_cols = 80;
+
+    // Uses the platform PTY unless another one, e.g. a
+    // MemoryPseudoTerminal, is passed in. A PTY that is already launched is
+    // resized and used as is.
+    explicit Terminal(std::shared_ptr<ImApp::PseudoTerminal> pty = nullptr);
     ~Terminal();
 
     void render();
     void resize(int cols, int rows);
+    // Resizes and from then on ignores the window's size, e.g. to replay a
+    // recording at its own size. Callable from the reader thread, where the
+    // resize applies after all output read before it.
+    void set_fixed_size(int cols, int rows);
     const std::string& window_title() const { return m_window_title; }
     void set_window_title(const std::string& title) { m_window_title = title; }
     bool is_visible() const { return m_is_visible; }
     void set_visible(bool visible) { m_is_visible = visible; }
     bool is_embedded() const { return m_is_embedded; }
     void set_embedded(bool embedded) { m_is_embedded = embedded; }
-    void process_input(const std::string& input) const;
-    bool selected_text(int x, int y);
-    void paste_from_clipboard() const;
+    // Draws the cells with the backend's instanced cell grid renderer when
+    // it has one, instead of the ImGui draw list.
+    void set_cell_grid_enabled(bool enabled) { m_cell_grid_enabled = enabled; }
+    void set_dark_mode(bool dark_mode) { m_dark_mode = dark_mode; }
+    // Adds a TrueType font tried before ImGui's font, must be called before
+    // the first render.
+    void add_font(const std::filesystem::path& path) {
+        m_font_paths.push_back(path);
+    }
+    void process_input(std::string_view input) const;
+    // Like `process_input`, but counted as typed by the user.
+    void send_keys(std::string_view keys);
+    void on_frame_presented();
+    LatencyStats echo_latency_stats() const;
+    // `y` is an absolute line, see `Scrollback`.
+    bool selected_text(int x, int64_t y);
+    // Selects every cell of the view, kept as is while the view is unchanged.
+    void select_view();
+    void paste_from_clipboard();
+    ThroughputStats throughput_stats() const;
+    // True while the terminal has work to finish in `render`, e.g. a paste.
+    bool needs_frame() const { return m_paste.is_active(); }
+    // Saves all PTY output to `path`, must be called before the first render.
+    bool record_session(const std::filesystem::path& path);
 
   private:
     enum Charset {
@@ -155,8 +224,37 @@ class Terminal {
         CharsetGer,
         CharsetFin
     };
+    // What decides how a cell is drawn besides its text
+    struct CellStyle {
+        ImU32 fg{0};
+        ImU32 bg{0};
+        bool background{false}; // Default black backgrounds are not drawn
+        bool underline{false};
+        bool operator==(const CellStyle&) const = default;
+    };
+    // Indices start at 0
+    struct DrawBuffers {
+        std::vector<ImDrawVert> vertices;
+        std::vector<ImDrawIdx> indices;
+    };
+    // Vertices of one view row as drawn at `origin`
+    struct RowCache {
+        uint64_t version{0}; // 0 is never a valid row version
+        ImVec2 origin;
+        DrawBuffers shapes; // Backgrounds and underlines, ImGui's atlas
+        DrawBuffers glyphs; // The glyph cache's atlas
+        std::vector<uint32_t> slots; // Glyph cache slots the row uses
+    };
+
     void _start_shell();
     void _read_output();
+    void _parse_output();
+    void _publish_snapshot();
+    void _update_flood_state(size_t parsed,
+                             std::chrono::steady_clock::time_point now);
+    std::unique_lock<std::mutex> _lock_buffer();
+    void _note_keystroke();
+    void _wait_for_echo();
 
     void _write_to_buffer(const char* data, size_t length);
     void _write_char(Rune u);
@@ -169,41 +267,55 @@ class Terminal {
     void _check_font_size_changed();
     bool _setup_window();
     void _handle_terminal_resize();
-    void _handle_scrollback(const ImGuiIO& io, int new_rows);
+    void _handle_scrollback(const ImGuiIO& io);
     void _handle_mouse_input(const ImGuiIO& io);
-    void _handle_keyboard_input(const ImGuiIO& io) const;
+    void _handle_keyboard_input(const ImGuiIO& io);
     void _handle_special_keys(const ImGuiIO& io) const;
     void _handle_control_combos(const ImGuiIO& io) const;
     void _handle_regular_text_input(const ImGuiIO& io) const;
 
-    // RenderBuffer helper functions
+    // RenderBuffer helper functions, these only read `m_view`
     void _render_buffer();
-    void _render_alt_screen(ImDrawList* draw_list, const ImVec2& pos,
-                            float char_width, float line_height);
-    void _render_main_screen(ImDrawList* draw_list, const ImVec2& pos,
-                             float char_width, float line_height);
-
-    // Shared rendering helpers
+    void _render_rows(ImDrawList* draw_list, const ImVec2& pos,
+                      float char_width, float line_height);
+    void _create_glyph_cache();
+    void _build_row(int y, const ImVec2& origin, float char_width,
+                    float line_height);
+    static void _move_row(RowCache& row, const ImVec2& origin);
+    static void _splice(ImDrawList* draw_list, const DrawBuffers& buffers);
+    void _render_cell_grid(ImDrawList* draw_list, const ImVec2& pos,
+                           float char_width, float line_height);
+    // Returns false if a glyph is missing because the glyph cache is full.
+    bool _build_grid_row(int y);
+    bool _find_glyph(const VTermScreenCell* cells, int x, uint32_t& slot);
+    void _update_selection_spans();
     void _render_selection_highlight(ImDrawList* draw_list, const ImVec2& pos,
-                                     float char_width, float line_height,
-                                     int start_y, int end_y,
-                                     int screen_offset = 0);
+                                     float char_width, float line_height);
     void _render_cursor(ImDrawList* draw_list, const ImVec2& cursor_pos,
-                        VTermScreenCell& cursor_cell, float char_width,
+                        const VTermScreenCell& cursor_cell, float char_width,
                         float line_height, float alpha);
-    void _render_vterm_cell(ImDrawList* draw_list, VTermScreenCell& cell,
-                            const ImVec2& char_pos, float char_width,
-                            float line_height);
-    void _handle_vterm_cell_colors(VTermScreenCell& cell, ImVec4& fg,
-                                   ImVec4& bg);
+    // Draws a row of cells, batching adjacent cells of equal style into
+    // one background rect and one underline. Glyphs go to `glyph_list` and
+    // their slots to `slots`, returns false if the glyph cache was full.
+    bool _render_vterm_row(ImDrawList* draw_list, ImDrawList* glyph_list,
+                           const VTermScreenCell* cells, int cols,
+                           const ImVec2& row_pos, float char_width,
+                           float line_height, std::vector<uint32_t>& slots);
+    static void _render_vterm_run(ImDrawList* draw_list,
+                                  const CellStyle& style, const ImVec2& run_pos,
+                                  float run_width, float line_height);
+    void _update_palette();
+    // Resolves the colors of a row into `m_row_fg` and `m_row_bg`.
+    void _resolve_row_colors(const VTermScreenCell* cells, int cols);
+    CellStyle _vterm_cell_style(const VTermScreenCell& cell, int x) const;
     static void _render_glyph(ImDrawList* draw_list, const Glyph& glyph,
                               const ImVec2& char_pos, float char_width,
                               float line_height);
     static void _handle_glyph_colors(const Glyph& glyph, ImVec4& fg,
                                      ImVec4& bg);
 
-    void _selection_start(int col, int row);
-    void _selection_extend(int col, int row);
+    void _selection_start(int col, int64_t line);
+    void _selection_extend(int col, int64_t line);
     void _selection_clear();
     void _get_selection(std::string& selected);
     void _copy_selection();
@@ -229,6 +341,8 @@ class Terminal {
     void _add_to_scrollback(int cols, const VTermScreenCell* cells);
     int _pop_from_scrollback(int cols, VTermScreenCell* cells);
     void _scrollback_clear();
+    // Gives rows [first, last) of the screen new versions.
+    void _damage_rows(int first, int last);
 
     struct CSIEscape {
         char buf[256];         // Raw string
@@ -279,6 +393,14 @@ class Terminal {
     static int _vterm_sb_popline(int cols, VTermScreenCell* cells, void* data);
     static int _vterm_sb_clear(void* data);
     static void _vterm_output(const char* s, size_t len, void* data);
+    VTermStateFallbacks m_vterm_fallbacks{};
+    static int _vterm_osc(int command, VTermStringFragment frag, void* data);
+    void _handle_osc_colors(int command, std::string_view text);
+    // OSC color sequences, owned by the parser thread
+    static constexpr size_t g_max_osc_length = 4096;
+    std::string m_osc_text; // Fragments of the sequence being received
+    Palette::Colors m_osc_colors{};
+    uint64_t m_osc_colors_version{0};
 
     // Terminal state
     struct TermState {
@@ -298,10 +420,21 @@ class Terminal {
         std::vector<bool> dirty;                   // dirtyness of lines
         std::vector<bool> tabs;                    // Tab stops
     } m_state;
-    bool m_dark_mode = true;
+    std::atomic<bool> m_dark_mode{true}; // Also read by OSC color queries
 
     static constexpr float g_drag_threshold = 3.0f;
     Selection m_selection;
+    uint64_t m_selection_version{0}; // Bumped whenever `m_selection` changes
+    // Highlighted [x0, x1) of each view row, x0 == x1 if none
+    std::vector<std::pair<int, int>> m_selection_spans;
+    struct SelectionSpansKey {
+        uint64_t selection_version{0};
+        int64_t first_line{0}; // Absolute line of the first view row
+        int rows{0};
+        int cols{0};
+        bool alt_screen{false};
+        bool operator==(const SelectionSpansKey&) const = default;
+    } m_selection_spans_key;
 
     std::string m_window_title;
     bool m_is_visible{true};
@@ -315,10 +448,67 @@ class Terminal {
     // Thread and synchronization
     std::mutex m_buffer_mutex;
     std::thread m_read_thread;
-    bool m_should_terminate{false};
+    std::thread m_parse_thread;
+    std::atomic<bool> m_should_terminate{false};
+    // PTY output on its way from `m_read_thread` to `m_parse_thread`
+    ByteRing m_output_ring{256};
+    // Screen state on its way from `m_parse_thread` to the renderer. Writers
+    // publish with `m_buffer_mutex` held, `m_view` is the frame being drawn.
+    SnapshotExchange m_snapshots;
+    const ScreenSnapshot* m_view{nullptr};
+    uint64_t m_snapshot_sequence{0};
+    std::atomic<uint64_t> m_parsed_bytes{0};
+    std::atomic<int64_t> m_parse_time_ns{0};
+    uint64_t m_rendered_frames{0};
+    std::chrono::nanoseconds m_render_time{0};
+    uint64_t m_built_rows{0};
+    // Set by the parser when it held back a snapshot, the UI then wakes it
+    // up again every frame until it is published.
+    std::atomic<bool> m_publish_pending{false};
+
+    // Output flood detection, owned by `m_parse_thread`. While the input
+    // rate stays high, damage is merged per screen and snapshots are
+    // published at a capped rate.
+    OutputFlood m_flood;
 
     // PTY information
     std::shared_ptr<ImApp::PseudoTerminal> m_pty{nullptr};
+    // Records output from `m_read_thread` and resizes once the shell runs
+    std::unique_ptr<SessionRecorder> m_recorder;
+    // See `set_fixed_size`
+    std::atomic<bool> m_fixed_size{false};
+    static constexpr std::chrono::microseconds g_fixed_size_poll_period{100};
+    // Time to the shell's first output, which is dominated by spawn cost
+    std::chrono::steady_clock::time_point m_launch_time;
+    bool m_received_output{false};
+
+    // Keystroke-to-photon tracking. Output within `g_echo_window` of a key
+    // asks for an urgent frame, and in LowLatency mode the frame that sent a
+    // key waits up to `g_echo_wait` for its echo before drawing.
+    static constexpr std::chrono::milliseconds g_echo_window{50};
+    static constexpr std::chrono::microseconds g_echo_wait{2000};
+    static constexpr size_t g_max_echo_samples = 4096;
+    // steady_clock ticks of the last keystroke, read by the parser
+    std::atomic<int64_t> m_last_key_time{0};
+    // Notified with `m_buffer_mutex` held whenever a snapshot is published
+    std::condition_variable m_snapshot_published;
+    struct EchoProbe {
+        std::chrono::steady_clock::time_point key_time;
+        uint64_t sequence{0}; // last snapshot before the key
+        bool awaiting{false}; // no newer snapshot drawn yet
+        bool drawn{false};    // this frame shows it
+        bool sent_this_frame{false};
+    } m_echo;
+    std::deque<std::chrono::nanoseconds> m_echo_latencies;
+
+    // The cursor blinks in steps of this period. Each step needs one frame.
+    static constexpr std::chrono::milliseconds g_cursor_blink_period{500};
+
+    // Paste in progress, pumped once per frame
+    static constexpr size_t g_paste_budget_per_frame = 256 * 1024;
+    PasteStream m_paste;
+    // libvterm keeps DECSET 2004 to itself
+    BracketedPasteMode m_bracketed_paste;
 
     // libvterm related
     VTerm* m_vterm{nullptr};
@@ -329,9 +519,54 @@ class Terminal {
     TCursor m_saved_cursor; // For cursor save/restore
 
     std::vector<std::vector<Glyph>> m_scrollback_buffer;
-    std::vector<std::vector<VTermScreenCell>> m_sb_buffer;
     size_t m_max_scrollback_lines = 10000;
-    int m_scroll_offset = 0;
+    Scrollback m_sb_buffer{m_max_scrollback_lines};
+    std::atomic<int> m_scroll_offset{0};
+
+    // Row versions for the renderer's row cache, owned by the parser. Each
+    // is unique, so a row that moves keeps its cached vertices.
+    uint64_t m_last_row_version{0};
+    std::vector<uint64_t> m_row_versions; // screen rows, not scrollback lines
+    bool m_cursor_visible{true}; // DECTCEM, owned by the parser
+
+    // Vertices of each view row, rebuilt only when its version or the font
+    // changes and otherwise copied into the window draw list.
+    struct RowCacheKey {
+        const ImFont* font{nullptr};
+        int atlas_id{0};
+        uint64_t glyph_epoch{0};
+        uint64_t palette_version{0};
+        float char_width{0.0f};
+        float line_height{0.0f};
+        bool operator==(const RowCacheKey&) const = default;
+    } m_row_cache_key;
+    std::vector<RowCache> m_row_cache;
+    Palette m_palette;
+    bool m_palette_dark_mode{false};
+    uint64_t m_palette_osc_version{0};
+    std::vector<ImU32> m_row_fg; // Colors of the row being built
+    std::vector<ImU32> m_row_bg;
+    // Scratch lists the rows are drawn into before they are cached
+    std::unique_ptr<ImDrawList> m_row_builder;
+    std::unique_ptr<ImDrawList> m_glyph_builder;
+    // Box drawing, block and braille cells of the row being built, drawn as
+    // rects over its backgrounds
+    BoxDrawing m_box_drawing;
+    std::vector<std::pair<int, ImU32>> m_box_cells; // x, foreground
+    // Created on first render, once ImGui's font is loaded
+    std::unique_ptr<GlyphCache> m_glyph_cache;
+    std::vector<std::filesystem::path> m_font_paths;
+
+    // Replaces the row cache while enabled and supported. Only rows whose
+    // version changed are uploaded, glyph i + 1 is glyph cache slot i.
+    bool m_cell_grid_enabled{false};
+    bool m_cell_grid_created{false};
+    std::unique_ptr<ImApp::CellGridRenderer> m_cell_grid;
+    int m_grid_cols{0};
+    std::vector<uint64_t> m_grid_row_versions;
+    std::vector<ImApp::CellGridRenderer::Cell> m_grid_cells; // one row
+    std::vector<std::vector<uint32_t>> m_grid_row_slots;
+    uint64_t m_grid_glyph_epoch{UINT64_MAX};
 
     CSIEscape m_csiescseq;
     STREscape m_strescseq;
@@ -357,81 +592,5 @@ class Terminal {
         ImVec4(0.5f, 1.0f, 1.0f, 1.0f), // Ice Blue
         ImVec4(1.0f, 1.0f, 1.0f, 1.0f)  // Pure White
     };
-
-    const std::unordered_map<Rune, Rune> m_box_drawing_chars = {
-        // Basic box drawing - map proper Unicode box chars to themselves
-        {0x2500, L'─'}, // HORIZONTAL LINE
-        {0x2502, L'│'}, // VERTICAL LINE
-        {0x250C, L'┌'}, // DOWN AND RIGHT
-        {0x2510, L'┐'}, // DOWN AND LEFT
-        {0x2514, L'└'}, // UP AND RIGHT
-        {0x2518, L'┘'}, // UP AND LEFT
-        {0x251C, L'├'}, // VERTICAL AND RIGHT
-        {0x2524, L'┤'}, // VERTICAL AND LEFT
-        {0x252C, L'┬'}, // DOWN AND HORIZONTAL
-        {0x2534, L'┴'}, // UP AND HORIZONTAL
-        {0x253C, L'┼'}, // VERTICAL AND HORIZONTAL
-
-        // Double-line variants
-        {0x2550, L'═'}, // DOUBLE HORIZONTAL
-        {0x2551, L'║'}, // DOUBLE VERTICAL
-        {0x2554, L'╔'}, // DOUBLE DOWN AND RIGHT
-        {0x2557, L'╗'}, // DOUBLE DOWN AND LEFT
-        {0x255A, L'╚'}, // DOUBLE UP AND RIGHT
-        {0x255D, L'╝'}, // DOUBLE UP AND LEFT
-
-        // Rounded corners (often used in btop)
-        {0x256D, L'╭'}, // ROUNDED DOWN AND RIGHT
-        {0x256E, L'╮'}, // ROUNDED DOWN AND LEFT
-        {0x256F, L'╯'}, // ROUNDED UP AND LEFT
-        {0x2570, L'╰'}, // ROUNDED UP AND RIGHT
-
-        // Block elements
-        {0x2588, L'█'}, // FULL BLOCK
-        {0x2591, L'░'}, // LIGHT SHADE
-        {0x2592, L'▒'}, // MEDIUM SHADE
-        {0x2593, L'▓'}, // DARK SHADE
-        {0x2584, L'▄'}, // LOWER HALF BLOCK
-        {0x2580, L'▀'}, // UPPER HALF BLOCK
-        {0x2581, L'▁'}, // Lower one eighth block
-        {0x2582, L'▂'}, // Lower one quarter block
-        {0x2583, L'▃'}, // Lower three eighths block
-        {0x2584, L'▄'}, // Lower half block
-        {0x2585, L'▅'}, // Lower five eighths block
-        {0x2586, L'▆'}, // Lower three quarters block
-        {0x2587, L'▇'}, // Lower seven eighths block
-        {0x2588, L'█'}, // Full block
-        {0x2591, L'░'}, // Light shade
-        {0x2592, L'▒'}, // Medium shade
-        {0x2593, L'▓'}, // Dark shade
-
-        {0x2500, L'─'}, // Existing mappings...
-
-        // Add Braille patterns (0x28c0 is appearing a lot in the output)
-        {0x28c0, L'⣀'}, // BRAILLE PATTERN DOTS-78
-        {0x28c1, L'⣁'}, // BRAILLE PATTERN DOTS-1-78
-        {0x28c2, L'⣂'}, // BRAILLE PATTERN DOTS-2-78
-        {0x28c3, L'⣃'}, // BRAILLE PATTERN DOTS-12-78
-
-        // Block elements
-        {0x2588, L'█'}, // FULL BLOCK (this one appears in your output)
-        {0x2589, L'▉'}, // LEFT SEVEN EIGHTHS BLOCK
-        {0x258A, L'▊'}, // LEFT THREE QUARTERS BLOCK
-        {0x258B, L'▋'}, // LEFT FIVE EIGHTHS BLOCK
-        {0x258C, L'▌'}, // LEFT HALF BLOCK
-        {0x258D, L'▍'}, // LEFT THREE EIGHTHS BLOCK
-        {0x258E, L'▎'}, // LEFT ONE QUARTER BLOCK
-        {0x258F, L'▏'}, // LEFT ONE EIGHTH BLOCK
-        {0x2589, L'▉'},
-        {0x258A, L'▊'},
-        {0x258B, L'▋'},
-        {0x258C, L'▌'},
-        {0x258D, L'▍'},
-        {0x258E, L'▎'},
-        {0x258F, L'▏'},
-        {0x2840, 0x2840}, // ⡀
-        {0x2880, 0x2880}, // ⢀
-        {0x28c0, 0x28c0}, // ⣀
-    };
 };
 } // namespace ImNeovim
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace ImNeovim {
+/*
+ * Detects a child flooding the terminal with output and paces snapshot
+ * publishing while it lasts. Different rates for entering and leaving keep
+ * it from flapping. Owned by the parser thread.
+ */
+class OutputFlood {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr double g_enter_rate = 8.0 * 1024 * 1024; // bytes/s
+    static constexpr double g_exit_rate = 1.0 * 1024 * 1024;  // bytes/s
+    static constexpr std::chrono::milliseconds g_sample_period{100};
+    static constexpr std::chrono::milliseconds g_publish_period{33};
+
+    enum class Change : uint8_t { None, Entered, Left };
+
+    // Counts `parsed` bytes, returns whether flood mode started or ended.
+    Change update(size_t parsed, Clock::time_point now);
+    bool is_active() const { return m_active; }
+    // Until then a parsed state is held back instead of published.
+    Clock::time_point next_publish() const;
+    void published(Clock::time_point now) { m_last_publish = now; }
+    void held_back(size_t parsed);
+    // Frame that publishes a held-back state if no more output comes. Late
+    // enough that a busy parser publishes first, so it never adds a frame.
+    Clock::time_point fallback_frame() const {
+        return next_publish() + g_publish_period / 2;
+    }
+
+    // Rate of the last full sample
+    double rate() const { return m_rate; }
+    // Of the current or last flood
+    std::chrono::duration<double> duration(Clock::time_point now) const;
+    size_t bytes() const { return m_bytes; }
+    size_t skipped_snapshots() const { return m_skipped_snapshots; }
+
+  private:
+    bool m_active{false};
+    Clock::time_point m_sample_start;
+    size_t m_sample_bytes{0};
+    double m_rate{0.0};
+    Clock::time_point m_started;
+    Clock::time_point m_ended;
+    Clock::time_point m_last_publish;
+    size_t m_bytes{0};             // parsed since entering flood mode
+    size_t m_skipped_snapshots{0}; // batches never shown
+};
+} // namespace ImNeovim
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "im_app/pty.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace ImNeovim {
+/*
+ * Feeds a paste to a PTY a chunk at a time, as fast as its write queue
+ * accepts it, so multi-megabyte pastes neither block a frame nor get lost.
+ *
+ * ESC bytes are stripped from the payload, which can then neither end
+ * bracketed paste early nor smuggle in control sequences. When bracketed,
+ * the whole payload is wrapped once in `ESC[200~` / `ESC[201~`.
+ */
+class PasteStream {
+  public:
+    static constexpr size_t g_chunk_size = 16 * 1024;
+
+    void start(std::string payload, bool bracketed);
+    // Writes at most `budget` bytes. Returns true while there is more to send.
+    bool pump(ImApp::PseudoTerminal& pty, size_t budget);
+    // Drops the unsent payload. A started bracketed paste is still closed.
+    void cancel();
+
+    bool is_active() const { return m_stage != StageIdle; }
+    bool is_bracketed() const { return m_bracketed; }
+    size_t size() const { return m_size; }
+
+    // Removes every ESC byte in place.
+    static void strip_escapes(std::string& text);
+
+  private:
+    enum Stage { StageIdle, StagePrefix, StageBody, StageSuffix };
+
+    std::string_view _stage_data() const;
+    void _next_stage();
+
+    std::string m_payload;
+    size_t m_size{0};   // payload size before any cancel
+    size_t m_offset{0}; // bytes of the current stage already written
+    Stage m_stage{StageIdle};
+    bool m_bracketed{false};
+};
+} // namespace ImNeovim
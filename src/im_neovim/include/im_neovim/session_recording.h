@@ -0,0 +1,72 @@
+#pragma once
+
+#include "im_app/memory_pty.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+
+namespace ImNeovim {
+/*
+ * PTY session recordings.
+ *
+ * A recording is `g_recording_magic`, then the terminal's rows and columns
+ * when recording started, then one record per PTY read or resize. A record
+ * starts with the nanoseconds since the previous record and a tag. A tag
+ * with the low bit clear is the chunk size shifted left by one, followed by
+ * the raw chunk bytes. A tag of 1 is a resize, followed by rows and
+ * columns. All numbers are LEB128 varints, so most records only add a few
+ * bytes of overhead to the chunk itself.
+ */
+static constexpr std::string_view g_recording_magic{"IMNVREC\x02", 8};
+
+// Appends PTY output from the reader thread and resizes from the UI
+// thread to a recording.
+class SessionRecorder {
+  public:
+    SessionRecorder(const std::filesystem::path& path, uint16_t rows,
+                    uint16_t cols);
+    SessionRecorder(const SessionRecorder&) = delete;
+    SessionRecorder(SessionRecorder&&) = delete;
+    SessionRecorder& operator=(const SessionRecorder&) = delete;
+    SessionRecorder& operator=(SessionRecorder&&) = delete;
+
+    bool is_open() const { return m_file.is_open(); }
+    void record(const char* data, size_t size);
+    void record_resize(uint16_t rows, uint16_t cols);
+    size_t recorded_size() const { return m_recorded_size; }
+
+    static constexpr uint64_t g_resize_tag = 1;
+
+  private:
+    static constexpr size_t g_buffer_size = 1024 * 1024;
+
+    std::mutex m_mutex; // Only contended by a resize
+    std::unique_ptr<char[]> m_buffer;
+    std::ofstream m_file;
+    std::chrono::steady_clock::time_point m_last_record;
+    size_t m_recorded_size{0};
+
+    // Writes the time since the last record, returns the bytes written.
+    size_t _encode_delta(char* out);
+};
+
+struct SessionReplay {
+    std::shared_ptr<ImApp::MemoryPseudoTerminal> pty;
+    // Terminal size when recording started, later resizes are applied
+    // through `MemoryPseudoTerminal::set_resize_handler`.
+    uint16_t rows{0};
+    uint16_t cols{0};
+};
+
+// Memory-maps a recording and replays it with the original chunk
+// boundaries. Returns nullopt if the file is missing or not a recording.
+std::optional<SessionReplay>
+open_session_replay(const std::filesystem::path& path,
+                    ImApp::MemoryPseudoTerminal::Timing timing);
+} // namespace ImNeovim
@@ -0,0 +1,48 @@
+#include "im_neovim/output_flood.h"
+
+namespace ImNeovim {
+OutputFlood::Change OutputFlood::update(size_t parsed,
+                                        Clock::time_point now) {
+    m_sample_bytes += parsed;
+    if (m_active) {
+        m_bytes += parsed;
+    }
+    auto elapsed = now - m_sample_start;
+    if (elapsed < g_sample_period) {
+        return Change::None;
+    }
+    m_rate = m_sample_bytes / std::chrono::duration<double>(elapsed).count();
+    m_sample_start = now;
+    m_sample_bytes = 0;
+
+    if (!m_active && m_rate >= g_enter_rate) {
+        m_active = true;
+        m_started = now;
+        m_bytes = 0;
+        m_skipped_snapshots = 0;
+        return Change::Entered;
+    }
+    if (m_active && m_rate < g_exit_rate) {
+        m_active = false;
+        m_ended = now;
+        return Change::Left;
+    }
+    return Change::None;
+}
+
+OutputFlood::Clock::time_point OutputFlood::next_publish() const {
+    return m_active ? m_last_publish + g_publish_period
+                    : Clock::time_point::min();
+}
+
+void OutputFlood::held_back(size_t parsed) {
+    if (parsed > 0) {
+        m_skipped_snapshots++;
+    }
+}
+
+std::chrono::duration<double>
+OutputFlood::duration(Clock::time_point now) const {
+    return (m_active ? now : m_ended) - m_started;
+}
+} // namespace ImNeovim
@@ -0,0 +1,113 @@
+#include "im_neovim/paste_stream.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ImNeovim {
+static constexpr std::string_view g_paste_start = "\033[200~";
+static constexpr std::string_view g_paste_end = "\033[201~";
+
+void PasteStream::start(std::string payload, bool bracketed) {
+    m_payload = std::move(payload);
+    strip_escapes(m_payload);
+    m_size = m_payload.size();
+    m_offset = 0;
+    m_bracketed = bracketed;
+    m_stage = bracketed ? StagePrefix : StageBody;
+}
+
+bool PasteStream::pump(ImApp::PseudoTerminal& pty, size_t budget) {
+    while (m_stage != StageIdle) {
+        std::string_view data = _stage_data();
+        while (m_offset < data.size()) {
+            size_t size =
+                std::min({g_chunk_size, data.size() - m_offset, budget});
+            if (size == 0) {
+                return true;
+            }
+            size_t accepted = pty.write(data.data() + m_offset, size);
+            m_offset += accepted;
+            budget -= accepted;
+            if (accepted < size) {
+                // The write queue is full, carry on next time.
+                return true;
+            }
+        }
+        _next_stage();
+    }
+    return false;
+}
+
+void PasteStream::cancel() {
+    switch (m_stage) {
+    case StagePrefix:
+        if (m_offset == 0) {
+            // Nothing reached the child yet.
+            m_stage = StageSuffix;
+            _next_stage();
+        } else {
+            m_payload.clear();
+        }
+        break;
+    case StageBody:
+        m_payload.resize(m_offset);
+        break;
+    default:
+        break;
+    }
+}
+
+void PasteStream::strip_escapes(std::string& text) {
+    // memchr is vectorized by the C library, so the common case of a clean
+    // payload is a single fast scan without any copying.
+    char* begin = text.data();
+    char* end = begin + text.size();
+    char* out = static_cast<char*>(std::memchr(begin, '\033', text.size()));
+    if (out == nullptr) {
+        return;
+    }
+    const char* in = out + 1;
+    while (in < end) {
+        const char* next =
+            static_cast<const char*>(std::memchr(in, '\033', end - in));
+        if (next == nullptr) {
+            next = end;
+        }
+        std::memmove(out, in, next - in);
+        out += next - in;
+        in = next + 1;
+    }
+    text.resize(out - begin);
+}
+
+std::string_view PasteStream::_stage_data() const {
+    switch (m_stage) {
+    case StagePrefix:
+        return g_paste_start;
+    case StageBody:
+        return m_payload;
+    case StageSuffix:
+        return g_paste_end;
+    default:
+        return {};
+    }
+}
+
+void PasteStream::_next_stage() {
+    m_offset = 0;
+    switch (m_stage) {
+    case StagePrefix:
+        m_stage = StageBody;
+        break;
+    case StageBody:
+        m_stage = m_bracketed ? StageSuffix : StageIdle;
+        break;
+    default:
+        m_stage = StageIdle;
+        break;
+    }
+    if (m_stage == StageIdle) {
+        // Don't hold on to a multi-megabyte buffer after the paste.
+        std::string().swap(m_payload);
+    }
+}
+} // namespace ImNeovim
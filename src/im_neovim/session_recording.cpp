@@ -0,0 +1,159 @@
+#include "im_neovim/session_recording.h"
+#include "im_app/file_system.h"
+#include "im_neovim/logging.h"
+#include <cstdint>
+
+namespace ImNeovim {
+static size_t encode_varint(uint64_t value, char* out) {
+    size_t size = 0;
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        out[size++] = static_cast<char>(byte | (value != 0 ? 0x80 : 0));
+    } while (value != 0);
+    return size;
+}
+
+static bool decode_varint(const char*& cursor, const char* end,
+                          uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && cursor < end; shift += 7) {
+        auto byte = static_cast<uint8_t>(*cursor++);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool is_size(uint64_t rows, uint64_t cols) {
+    return rows > 0 && rows <= UINT16_MAX && cols > 0 && cols <= UINT16_MAX;
+}
+
+SessionRecorder::SessionRecorder(const std::filesystem::path& path,
+                                 uint16_t rows, uint16_t cols)
+    : m_buffer(std::make_unique<char[]>(g_buffer_size)) {
+    // Recording goes through a large buffer so the reader thread rarely
+    // ends up in a write syscall.
+    m_file.rdbuf()->pubsetbuf(m_buffer.get(), g_buffer_size);
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        LOG_ERROR("Failed to open recording '{}'.", path.string());
+        return;
+    }
+    m_file.write(g_recording_magic.data(), g_recording_magic.size());
+    char header[10];
+    size_t header_size = encode_varint(rows, header);
+    header_size += encode_varint(cols, header + header_size);
+    m_file.write(header, static_cast<std::streamsize>(header_size));
+    m_last_record = std::chrono::steady_clock::now();
+}
+
+void SessionRecorder::record(const char* data, size_t size) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open()) {
+        return;
+    }
+    char header[20];
+    size_t header_size = _encode_delta(header);
+    header_size += encode_varint(static_cast<uint64_t>(size) << 1,
+                                 header + header_size);
+    m_file.write(header, static_cast<std::streamsize>(header_size));
+    m_file.write(data, static_cast<std::streamsize>(size));
+    m_recorded_size += size;
+}
+
+void SessionRecorder::record_resize(uint16_t rows, uint16_t cols) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open()) {
+        return;
+    }
+    char record[24];
+    size_t record_size = _encode_delta(record);
+    record_size += encode_varint(g_resize_tag, record + record_size);
+    record_size += encode_varint(rows, record + record_size);
+    record_size += encode_varint(cols, record + record_size);
+    m_file.write(record, static_cast<std::streamsize>(record_size));
+}
+
+size_t SessionRecorder::_encode_delta(char* out) {
+    auto now = std::chrono::steady_clock::now();
+    auto delta = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        now - m_last_record);
+    m_last_record = now;
+    return encode_varint(static_cast<uint64_t>(delta.count()), out);
+}
+
+std::optional<SessionReplay>
+open_session_replay(const std::filesystem::path& path,
+                    ImApp::MemoryPseudoTerminal::Timing timing) {
+    auto file = ImApp::MappedFile::open(path);
+    if (!file) {
+        LOG_ERROR("Failed to map recording '{}'.", path.string());
+        return std::nullopt;
+    }
+    std::string_view contents(file->data(), file->size());
+    if (!contents.starts_with(g_recording_magic)) {
+        LOG_ERROR("'{}' is not a session recording.", path.string());
+        return std::nullopt;
+    }
+    const char* cursor = contents.data() + g_recording_magic.size();
+    const char* end = contents.data() + contents.size();
+    uint64_t rows, cols;
+    if (!decode_varint(cursor, end, rows) ||
+        !decode_varint(cursor, end, cols) || !is_size(rows, cols)) {
+        LOG_ERROR("Recording '{}' has no valid terminal size.", path.string());
+        return std::nullopt;
+    }
+    SessionReplay replay{.rows = static_cast<uint16_t>(rows),
+                         .cols = static_cast<uint16_t>(cols)};
+
+    // Chunks point straight into the mapping, nothing is copied. A resize
+    // is applied right before the output that followed it.
+    std::vector<ImApp::MemoryPseudoTerminal::Chunk> chunks;
+    ImApp::MemoryPseudoTerminal::Chunk next;
+    size_t resizes = 0;
+    auto truncated = [&]() {
+        LOG_WARN("Recording '{}' is truncated, replaying {} chunks.",
+                 path.string(), chunks.size());
+    };
+    while (cursor < end) {
+        uint64_t delta, tag;
+        if (!decode_varint(cursor, end, delta) ||
+            !decode_varint(cursor, end, tag)) {
+            truncated();
+            break;
+        }
+        next.timestamp += std::chrono::nanoseconds(delta);
+        if (tag == SessionRecorder::g_resize_tag) {
+            if (!decode_varint(cursor, end, rows) ||
+                !decode_varint(cursor, end, cols) || !is_size(rows, cols)) {
+                truncated();
+                break;
+            }
+            next.rows = static_cast<uint16_t>(rows);
+            next.cols = static_cast<uint16_t>(cols);
+            resizes++;
+            continue;
+        }
+        uint64_t size = tag >> 1;
+        if ((tag & 1) || size > static_cast<uint64_t>(end - cursor)) {
+            truncated();
+            break;
+        }
+        next.data = std::string_view(cursor, size);
+        chunks.push_back(next);
+        next = {.timestamp = next.timestamp};
+        cursor += size;
+    }
+    if (next.rows != 0) {
+        chunks.push_back(next); // A resize after the last output
+    }
+    LOG_INFO("Replaying {} chunks and {} resizes at {}x{} from '{}'.",
+             chunks.size(), resizes, replay.cols, replay.rows, path.string());
+    replay.pty = std::make_shared<ImApp::MemoryPseudoTerminal>(
+        std::move(chunks), std::move(file), timing);
+    return replay;
+}
+} // namespace ImNeovim
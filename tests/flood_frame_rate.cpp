@@ -0,0 +1,168 @@
+/*
+ * Floods an OutputFlood the way Terminal's parser thread does and renders
+ * on a HeadlessWindow through FrameRequests the way Application::exec does.
+ * While the flood lasts, snapshots and frames must stay within the publish
+ * cap, and flood mode must end once the output calms down.
+ */
+#include "im_app/frame_requests.h"
+#include "im_neovim/output_flood.h"
+#include "platforms/headless/headless_window.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+using ImNeovim::OutputFlood;
+
+constexpr size_t g_flood_chunk = 64 * 1024;
+constexpr auto g_flood_chunk_cost = std::chrono::microseconds(50);
+constexpr auto g_flood_duration = std::chrono::milliseconds(1500);
+constexpr size_t g_calm_chunk = 1024;
+constexpr auto g_calm_period = std::chrono::milliseconds(10);
+constexpr auto g_calm_duration = std::chrono::milliseconds(400);
+// Timer jitter and the publish that started the flood
+constexpr double g_cap_tolerance = 1.1;
+
+struct ParserResult {
+    Clock::time_point entered;
+    Clock::time_point left;
+    size_t flood_bytes{0};
+    size_t publishes_in_flood{0};
+    size_t skipped_snapshots{0};
+};
+
+// The publishing part of `Terminal::_parse_output`.
+class Parser {
+  public:
+    Parser(ImApp::FrameRequests& requests, ImApp::Window& window)
+        : m_requests(requests), m_window(window) {}
+
+    void parse(size_t size) {
+        auto now = Clock::now();
+        switch (m_flood.update(size, now)) {
+        case OutputFlood::Change::Entered:
+            m_result.entered = now;
+            break;
+        case OutputFlood::Change::Left:
+            m_result.left = now;
+            m_result.flood_bytes = m_flood.bytes();
+            m_result.skipped_snapshots = m_flood.skipped_snapshots();
+            break;
+        case OutputFlood::Change::None:
+            break;
+        }
+        if (now < m_flood.next_publish()) {
+            m_flood.held_back(size);
+            _request_frame(m_flood.fallback_frame() - now);
+            return;
+        }
+        if (m_flood.is_active()) {
+            m_result.publishes_in_flood++;
+        }
+        m_flood.published(now);
+        _request_frame({});
+    }
+
+    const ParserResult& result() const { return m_result; }
+
+  private:
+    ImApp::FrameRequests& m_requests;
+    ImApp::Window& m_window;
+    OutputFlood m_flood;
+    ParserResult m_result;
+
+    // Same as `Application::request_frame`.
+    void _request_frame(Clock::duration delay) {
+        if (m_requests.request(delay)) {
+            m_window.post_empty_event();
+        }
+    }
+};
+
+void spin_for(Clock::duration duration) {
+    auto end = Clock::now() + duration;
+    while (Clock::now() < end) {
+    }
+}
+} // namespace
+
+int main() {
+    ImApp::HeadlessWindow window({.title = "flood", .width = 800,
+                                  .height = 600, .no_border = false});
+    ImApp::FrameRequests requests;
+    Parser parser(requests, window);
+    std::atomic<bool> parsing{true};
+
+    std::thread parse_thread([&]() {
+        auto start = Clock::now();
+        while (Clock::now() - start < g_flood_duration) {
+            spin_for(g_flood_chunk_cost);
+            parser.parse(g_flood_chunk);
+        }
+        start = Clock::now();
+        while (Clock::now() - start < g_calm_duration) {
+            std::this_thread::sleep_for(g_calm_period);
+            parser.parse(g_calm_chunk);
+        }
+        parsing = false;
+        window.post_empty_event();
+    });
+
+    // `Application::exec` without the drawing
+    std::vector<Clock::time_point> frames;
+    size_t wakeups = 0;
+    while (parsing) {
+        requests.wait(
+            [&](double timeout_seconds) {
+                wakeups++;
+                window.wait_events(timeout_seconds);
+            },
+            []() { return false; });
+        frames.push_back(Clock::now());
+    }
+    parse_thread.join();
+
+    const ParserResult& result = parser.result();
+    if (result.entered == Clock::time_point{} ||
+        result.left == Clock::time_point{}) {
+        std::fprintf(stderr, "flood_frame_rate: flood mode %s\n",
+                     result.entered == Clock::time_point{} ? "never started"
+                                                           : "never ended");
+        return EXIT_FAILURE;
+    }
+    size_t flood_frames = 0;
+    for (auto frame : frames) {
+        if (frame > result.entered && frame <= result.left) {
+            flood_frames++;
+        }
+    }
+    double seconds =
+        std::chrono::duration<double>(result.left - result.entered).count();
+    double cap = 1.0 / std::chrono::duration<double>(
+                           OutputFlood::g_publish_period)
+                           .count();
+    double frame_rate = flood_frames / seconds;
+    double publish_rate = result.publishes_in_flood / seconds;
+    std::printf("flood of %.2f s at %.0f MB/s: %zu snapshots skipped, "
+                "%.1f publishes/s, %.1f frames/s (cap %.1f/s), %zu frames and "
+                "%zu waits in total\n",
+                seconds, result.flood_bytes / seconds / (1024 * 1024),
+                result.skipped_snapshots, publish_rate, frame_rate, cap,
+                frames.size(), wakeups);
+
+    bool ok = true;
+    if (publish_rate > cap * g_cap_tolerance) {
+        std::fprintf(stderr, "flood_frame_rate: publishes exceed the cap\n");
+        ok = false;
+    }
+    if (frame_rate > cap * g_cap_tolerance) {
+        std::fprintf(stderr, "flood_frame_rate: frames exceed the cap\n");
+        ok = false;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,109 @@
+/*
+ * Checks the event loop of HeadlessWindow, which the headless benchmarks
+ * time frames with. `post_empty_event` from another thread has to wake a
+ * waiting `wait_events` promptly, an event posted before the wait must not
+ * be lost, and a timeout must neither return early nor much late.
+ */
+#include "platforms/headless/headless_window.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t g_wakeups = 1000;
+constexpr size_t g_timeouts = 50;
+constexpr auto g_timeout = std::chrono::milliseconds(5);
+// Scheduler slack on a loaded single-core CI box
+constexpr auto g_max_lateness = std::chrono::milliseconds(20);
+
+double to_ms(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+bool check(bool condition, const char* message) {
+    if (!condition) {
+        std::fprintf(stderr, "headless_window: %s\n", message);
+    }
+    return condition;
+}
+
+void report(const char* name, std::vector<Clock::duration>& samples) {
+    std::ranges::sort(samples);
+    std::printf("%s: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", name,
+                to_ms(samples[samples.size() / 2]),
+                to_ms(samples[samples.size() * 99 / 100]),
+                to_ms(samples.back()));
+}
+
+ImApp::HeadlessWindow make_window() {
+    return ImApp::HeadlessWindow({.title = "headless", .width = 800,
+                                  .height = 600, .no_border = false});
+}
+
+// Time from `post_empty_event` on another thread to `wait_events`
+// returning, like the PTY reader waking the main loop.
+bool wake_waiting_loop() {
+    auto window = make_window();
+    std::atomic<int64_t> posted_at{0};
+    std::atomic<bool> waiting{false};
+    std::thread poster([&]() {
+        for (size_t i = 0; i < g_wakeups; i++) {
+            while (!waiting.exchange(false)) {
+                std::this_thread::yield();
+            }
+            // Let the main loop get into the wait
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            posted_at = Clock::now().time_since_epoch().count();
+            window.post_empty_event();
+        }
+    });
+    std::vector<Clock::duration> latencies;
+    for (size_t i = 0; i < g_wakeups; i++) {
+        waiting = true;
+        window.wait_events(-1.0);
+        latencies.push_back(Clock::now() -
+                            Clock::time_point(Clock::duration(posted_at)));
+    }
+    poster.join();
+    report("wakeup", latencies);
+    return check(latencies.back() <= g_max_lateness, "wakeup too late");
+}
+
+bool keep_early_event() {
+    auto window = make_window();
+    window.post_empty_event();
+    auto start = Clock::now();
+    window.wait_events(1.0);
+    return check(Clock::now() - start < std::chrono::milliseconds(100),
+                 "an event posted before the wait was lost");
+}
+
+bool time_out() {
+    auto window = make_window();
+    std::vector<Clock::duration> lateness;
+    for (size_t i = 0; i < g_timeouts; i++) {
+        auto start = Clock::now();
+        window.wait_events(std::chrono::duration<double>(g_timeout).count());
+        lateness.push_back(Clock::now() - start - g_timeout);
+    }
+    report("timeout lateness", lateness); // Sorts them
+    return check(lateness.front() >= Clock::duration::zero(),
+                 "a timeout returned early") &&
+           check(lateness.back() <= g_max_lateness, "a timeout was late");
+}
+} // namespace
+
+int main() {
+    bool ok = wake_waiting_loop();
+    ok = keep_early_event() && ok;
+    ok = time_out() && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,88 @@
+/*
+ * Runs the main loop of `Application::exec` on a HeadlessWindow through
+ * FrameRequests, with an idle terminal whose only requests are the cursor
+ * blink steps. It must sleep between the steps instead of rendering
+ * continuously, and burn next to no CPU while it does.
+ */
+#include "im_app/frame_requests.h"
+#include "platforms/headless/headless_window.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+using Seconds = std::chrono::duration<double>;
+
+constexpr auto g_idle_duration = std::chrono::seconds(3);
+// Same as `Terminal::g_cursor_blink_period`
+constexpr auto g_blink_period = std::chrono::milliseconds(500);
+// Same as `g_frames_per_wakeup` in application.cpp
+constexpr int g_frames_per_wakeup = 2;
+// A blink step, the frame settling after it and timer slack
+constexpr double g_max_frame_rate = 5.0;
+constexpr double g_max_cpu_share = 0.02;
+
+// The blink request `Terminal::_render_buffer` makes every frame.
+void request_blink_step(ImApp::FrameRequests& requests,
+                        ImApp::Window& window, Clock::time_point start) {
+    double period = Seconds(g_blink_period).count();
+    double phase = std::fmod(Seconds(Clock::now() - start).count(),
+                             2.0 * period);
+    Seconds until_step((phase < period ? period : 2.0 * period) - phase);
+    if (requests.request(
+            std::chrono::duration_cast<Clock::duration>(until_step))) {
+        window.post_empty_event();
+    }
+}
+} // namespace
+
+int main() {
+    ImApp::HeadlessWindow window({.title = "idle", .width = 800,
+                                  .height = 600, .no_border = false});
+    ImApp::FrameRequests requests;
+
+    // `Application::exec` without the drawing
+    size_t frames = 0, waits = 0;
+    int pending_frames = g_frames_per_wakeup;
+    std::clock_t cpu_start = std::clock();
+    auto start = Clock::now();
+    while (Clock::now() - start < g_idle_duration) {
+        if (pending_frames == 0) {
+            bool input = requests.wait(
+                [&](double timeout_seconds) {
+                    waits++;
+                    window.wait_events(timeout_seconds);
+                },
+                []() { return false; });
+            pending_frames = input ? g_frames_per_wakeup : 1;
+        }
+        pending_frames--;
+        frames++;
+        request_blink_step(requests, window, start);
+    }
+    double seconds = Seconds(Clock::now() - start).count();
+    double cpu_seconds =
+        static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+    double frame_rate = frames / seconds;
+    double cpu_share = cpu_seconds / seconds;
+    std::printf("idle for %.2f s: %zu frames (%.1f/s), %zu waits, %.2f ms "
+                "CPU (%.3f%% of a core)\n",
+                seconds, frames, frame_rate, waits, cpu_seconds * 1000.0,
+                cpu_share * 100.0);
+
+    bool ok = true;
+    if (frame_rate > g_max_frame_rate) {
+        std::fprintf(stderr, "idle_frame_rate: renders while idle\n");
+        ok = false;
+    }
+    if (cpu_share > g_max_cpu_share) {
+        std::fprintf(stderr, "idle_frame_rate: busy while idle\n");
+        ok = false;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,146 @@
+/*
+ * Replays streams through MemoryPseudoTerminal with the reader loop of
+ * `Terminal::_read_output`. At full speed every byte has to arrive in
+ * order and the replay must be far faster than the parser it feeds. With
+ * recorded timing no chunk may arrive early, and none much late.
+ */
+#include "im_app/memory_pty.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+using ImApp::MemoryPseudoTerminal;
+
+constexpr size_t g_stream_size = 256 * 1024 * 1024;
+constexpr size_t g_chunk_size = 4096;
+// Far above what libvterm parses, so the replay never is the bottleneck
+constexpr double g_min_megabytes_per_second = 1000;
+constexpr size_t g_timed_chunks = 200;
+constexpr auto g_timed_period = std::chrono::milliseconds(2);
+constexpr auto g_max_lateness = std::chrono::milliseconds(5);
+
+double to_ms(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+bool check(bool condition, const char* message) {
+    if (!condition) {
+        std::fprintf(stderr, "memory_pty: %s\n", message);
+    }
+    return condition;
+}
+
+bool replay_full_speed() {
+    std::string bytes(g_stream_size, '\0');
+    for (size_t i = 0; i < bytes.size(); i++) {
+        bytes[i] = static_cast<char>(i * 31 + i / 4099);
+    }
+    auto pty = MemoryPseudoTerminal::from_bytes(bytes, g_chunk_size);
+    pty->launch(24, 80);
+
+    auto start = Clock::now();
+    std::vector<char> buffer(g_chunk_size);
+    size_t total = 0, wakeups = 0;
+    bool in_order = true;
+    while (true) {
+        if (!pty->wait_readable(-1)) {
+            break;
+        }
+        wakeups++;
+        size_t got, drained = 0;
+        while ((got = pty->read(buffer.data(), buffer.size())) > 0) {
+            in_order = in_order && std::equal(buffer.begin(),
+                                              buffer.begin() + got,
+                                              bytes.begin() + total);
+            total += got;
+            drained += got;
+        }
+        if (drained == 0) {
+            break; // Hung up
+        }
+    }
+    auto elapsed = Clock::now() - start;
+    double megabytes_per_second = total / 1e6 / (to_ms(elapsed) / 1000);
+    std::printf("full speed: %zu MB in %.0f ms, %.0f MB/s, %zu wakeups\n",
+                total / 1000000, to_ms(elapsed), megabytes_per_second,
+                wakeups);
+    return check(total == bytes.size() && in_order,
+                 "full speed replay lost or reordered bytes") &&
+           check(pty->is_finished(), "stream did not finish") &&
+           check(megabytes_per_second >= g_min_megabytes_per_second,
+                 "full speed replay is too slow");
+}
+
+bool replay_recorded() {
+    auto storage = std::make_shared<const std::string>(g_timed_chunks, 'x');
+    std::vector<MemoryPseudoTerminal::Chunk> chunks;
+    for (size_t i = 0; i < g_timed_chunks; i++) {
+        chunks.push_back({.timestamp = g_timed_period * i,
+                          .data = std::string_view(*storage).substr(i, 1)});
+    }
+    MemoryPseudoTerminal pty(std::move(chunks), storage,
+                             MemoryPseudoTerminal::Timing::Recorded);
+    pty.launch(24, 80);
+    auto start = Clock::now();
+
+    std::vector<Clock::duration> lateness;
+    char byte;
+    while (pty.wait_readable(-1)) {
+        if (pty.read(&byte, 1) == 0) {
+            break;
+        }
+        lateness.push_back(Clock::now() - start -
+                           g_timed_period * lateness.size());
+    }
+    if (!check(lateness.size() == g_timed_chunks,
+               "recorded replay lost chunks")) {
+        return false;
+    }
+    std::ranges::sort(lateness);
+    std::printf("recorded: %zu chunks %.0f ms apart, late by p50 %.3f ms, "
+                "p99 %.3f ms, max %.3f ms\n",
+                lateness.size(), to_ms(g_timed_period),
+                to_ms(lateness[lateness.size() / 2]),
+                to_ms(lateness[lateness.size() * 99 / 100]),
+                to_ms(lateness.back()));
+    return check(lateness.front() >= Clock::duration::zero(),
+                 "a chunk arrived before its timestamp") &&
+           check(lateness.back() <= g_max_lateness,
+                 "a chunk arrived too late");
+}
+
+// `wake` has to get a reader out of a wait for a chunk that is not due.
+bool wake_waiting_reader() {
+    auto storage = std::make_shared<const std::string>("x");
+    MemoryPseudoTerminal pty({{.timestamp = std::chrono::hours(1),
+                               .data = *storage}},
+                             storage, MemoryPseudoTerminal::Timing::Recorded);
+    pty.launch(24, 80);
+    std::thread waker([&pty]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        pty.wake();
+    });
+    auto start = Clock::now();
+    bool readable = pty.wait_readable(-1);
+    auto waited = Clock::now() - start;
+    waker.join();
+    return check(!readable && waited < std::chrono::seconds(1),
+                 "wake did not interrupt wait_readable");
+}
+} // namespace
+
+int main() {
+    bool ok = replay_full_speed();
+    ok = replay_recorded() && ok;
+    ok = wake_waiting_reader() && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
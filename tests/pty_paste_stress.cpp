@@ -0,0 +1,231 @@
+/*
+ * Pastes 50 MB through PasteStream into a LinuxPseudoTerminal whose child
+ * reads slowly, the way a busy shell would. Pumping has to stay
+ * non-blocking while the child lags behind and every byte has to arrive
+ * in order. Output is read on a thread of its own, like `Terminal` does.
+ *
+ * The child is this executable again, launched as the PTY's shell.
+ */
+#include "im_neovim/paste_stream.h"
+#include "platforms/linux/linux_child_reaper.h"
+#include "platforms/linux/linux_pty.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+constexpr size_t g_paste_size = 50 * 1024 * 1024;
+// What `Terminal` pumps per frame, and a 1 ms frame
+constexpr size_t g_pump_budget = 256 * 1024;
+constexpr auto g_frame_time = std::chrono::milliseconds(1);
+constexpr size_t g_child_read_size = 4096;
+constexpr auto g_child_read_delay = std::chrono::microseconds(20);
+constexpr auto g_max_pump_latency = std::chrono::milliseconds(50);
+constexpr auto g_report_timeout = std::chrono::seconds(30);
+// Tells the child how many bytes to expect
+constexpr const char* g_child_env = "PTY_PASTE_STRESS_CHILD";
+
+uint64_t fnv1a(uint64_t hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+constexpr uint64_t g_fnv_basis = 0xcbf29ce484222325ull;
+
+// Runs as the PTY's shell. Reads the paste in small bites, then reports
+// size and hash as one line of output.
+int run_slow_reader(uint64_t expected) {
+    // Raw, so the line discipline neither echoes nor edits the paste.
+    termios attributes;
+    tcgetattr(STDIN_FILENO, &attributes);
+    cfmakeraw(&attributes);
+    tcsetattr(STDIN_FILENO, TCSANOW, &attributes);
+    std::fputs("ready\n", stdout);
+    std::fflush(stdout);
+
+    std::vector<char> buffer(g_child_read_size);
+    uint64_t hash = g_fnv_basis;
+    uint64_t total = 0;
+    while (total < expected) {
+        ssize_t got = read(STDIN_FILENO, buffer.data(), buffer.size());
+        if (got <= 0) {
+            break;
+        }
+        hash = fnv1a(hash, buffer.data(), static_cast<size_t>(got));
+        total += static_cast<uint64_t>(got);
+        std::this_thread::sleep_for(g_child_read_delay);
+    }
+    std::printf("received %llu %llx\n", static_cast<unsigned long long>(total),
+                static_cast<unsigned long long>(hash));
+    std::fflush(stdout);
+    // Stay until the parent read the report and hung up.
+    while (read(STDIN_FILENO, buffer.data(), buffer.size()) > 0) {
+    }
+    return EXIT_SUCCESS;
+}
+
+// Collects child output on a thread of its own, the way
+// `Terminal::_read_output` does, until the child hangs up or it is stopped.
+class OutputReader {
+  public:
+    explicit OutputReader(ImApp::PseudoTerminal& pty)
+        : m_pty(pty), m_thread(&OutputReader::_run, this) {}
+
+    ~OutputReader() {
+        m_should_stop = true;
+        m_pty.wake();
+        m_thread.join();
+    }
+
+    // Waits for a full line starting with `prefix`, moves it to `line` and
+    // drops everything before it.
+    bool wait_for_line(std::string_view prefix, std::string& line) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        size_t start = std::string::npos, end = std::string::npos;
+        bool found = m_changed.wait_for(lock, g_report_timeout, [&]() {
+            start = m_output.find(prefix);
+            end = m_output.find('\n', start);
+            return end != std::string::npos || m_done;
+        });
+        if (!found || end == std::string::npos) {
+            return false;
+        }
+        line = m_output.substr(start, end - start);
+        m_output.erase(0, end + 1);
+        return true;
+    }
+
+  private:
+    void _run() {
+        char buffer[4096];
+        while (!m_should_stop) {
+            if (!m_pty.wait_readable(-1)) {
+                if (!m_pty.is_valid()) {
+                    break;
+                }
+                continue;
+            }
+            size_t total = 0, got;
+            while ((got = m_pty.read(buffer, sizeof(buffer))) > 0) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_output.append(buffer, got);
+                total += got;
+            }
+            if (total == 0) {
+                break;
+            }
+            m_changed.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done = true;
+        m_changed.notify_all();
+    }
+
+    ImApp::PseudoTerminal& m_pty;
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::string m_output;
+    bool m_done{false};
+    std::atomic<bool> m_should_stop{false};
+    std::thread m_thread;
+};
+} // namespace
+
+int main() {
+    if (const char* expected = std::getenv(g_child_env)) {
+        return run_slow_reader(std::strtoull(expected, nullptr, 10));
+    }
+    ImApp::ChildReaper::block_child_signal();
+
+    std::string paste(g_paste_size, '\0');
+    for (size_t i = 0; i < paste.size(); i++) {
+        paste[i] = static_cast<char>(' ' + (i * 31 + i / 4099) % 95);
+    }
+    // Bracketed, so the markers are part of what has to arrive intact.
+    std::string expected = "\033[200~" + paste + "\033[201~";
+    uint64_t expected_hash =
+        fnv1a(g_fnv_basis, expected.data(), expected.size());
+
+    char self[4096];
+    ssize_t self_size = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (self_size <= 0) {
+        std::perror("pty_paste_stress: readlink");
+        return EXIT_FAILURE;
+    }
+    self[self_size] = '\0';
+    setenv("SHELL", self, 1);
+    setenv(g_child_env, std::to_string(expected.size()).c_str(), 1);
+
+    ImApp::LinuxPseudoTerminal pty;
+    if (!pty.launch(24, 80)) {
+        std::fprintf(stderr, "pty_paste_stress: launch failed\n");
+        return EXIT_FAILURE;
+    }
+    auto reader = std::make_unique<OutputReader>(pty);
+    std::string line;
+    if (!reader->wait_for_line("ready", line)) {
+        std::fprintf(stderr, "pty_paste_stress: child did not start\n");
+        return EXIT_FAILURE;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    Clock::duration max_pump_latency{};
+    size_t frames = 0;
+    ImNeovim::PasteStream stream;
+    stream.start(paste, true);
+    for (bool more = true; more; frames++) {
+        auto before = Clock::now();
+        more = stream.pump(pty, g_pump_budget);
+        max_pump_latency = std::max(max_pump_latency, Clock::now() - before);
+        if (more) {
+            std::this_thread::sleep_for(g_frame_time);
+        }
+    }
+    bool reported = reader->wait_for_line("received", line);
+    auto elapsed = Clock::now() - start;
+    reader.reset();
+    pty.terminate();
+
+    auto to_ms = [](Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+    std::printf("pasted %zu bytes in %.0f ms over %zu frames, max pump "
+                "latency %.3f ms\n",
+                expected.size(), to_ms(elapsed), frames,
+                to_ms(max_pump_latency));
+
+    bool ok = true;
+    unsigned long long total = 0, hash = 0;
+    if (!reported ||
+        std::sscanf(line.c_str(), "received %llu %llx", &total, &hash) != 2) {
+        std::fprintf(stderr, "pty_paste_stress: no report from the child\n");
+        ok = false;
+    } else if (total != expected.size() || hash != expected_hash) {
+        std::fprintf(stderr, "pty_paste_stress: child got %llu bytes, hash "
+                             "%s\n",
+                     total, hash == expected_hash ? "matches" : "differs");
+        ok = false;
+    }
+    if (max_pump_latency > g_max_pump_latency) {
+        std::fprintf(stderr, "pty_paste_stress: pump blocked for %.3f ms\n",
+                     to_ms(max_pump_latency));
+        ok = false;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
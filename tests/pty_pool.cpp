@@ -0,0 +1,149 @@
+/*
+ * Takes shells from a PseudoTerminalPool right after it was created, kills
+ * them behind the pool's back and checks that the pool notices and refills.
+ *
+ * The shells are this executable again, idling until they are killed.
+ */
+#include "im_app/pty_pool.h"
+#include "platforms/linux/linux_child_reaper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+constexpr size_t g_pool_size = 2;
+constexpr auto g_timeout = std::chrono::seconds(5);
+// Marks the child, which only waits to be killed
+constexpr const char* g_child_env = "PTY_POOL_CHILD";
+
+bool wait_until(const std::function<bool()>& condition) {
+    auto deadline = std::chrono::steady_clock::now() + g_timeout;
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+// Sends SIGKILL to every child of this process, i.e. every pooled shell.
+std::vector<pid_t> kill_children() {
+    std::vector<pid_t> killed;
+    DIR* proc = opendir("/proc");
+    if (!proc) {
+        return killed;
+    }
+    while (dirent* entry = readdir(proc)) {
+        pid_t pid = std::atoi(entry->d_name);
+        if (pid <= 0) {
+            continue;
+        }
+        // The parent pid is the 4th field, after the parenthesized name.
+        std::ifstream stat(std::string("/proc/") + entry->d_name + "/stat");
+        std::string line;
+        std::getline(stat, line);
+        size_t name_end = line.rfind(')');
+        if (name_end == std::string::npos) {
+            continue;
+        }
+        char state;
+        int parent = 0;
+        if (std::sscanf(line.c_str() + name_end + 1, " %c %d", &state,
+                        &parent) == 2 &&
+            parent == getpid() && kill(pid, SIGKILL) == 0) {
+            killed.push_back(pid);
+        }
+    }
+    closedir(proc);
+    return killed;
+}
+
+bool check(bool condition, const char* message) {
+    if (!condition) {
+        std::fprintf(stderr, "pty_pool: %s\n", message);
+    }
+    return condition;
+}
+} // namespace
+
+int main() {
+    if (std::getenv(g_child_env)) {
+        while (true) {
+            pause();
+        }
+    }
+    ImApp::ChildReaper::block_child_signal();
+
+    char self[4096];
+    ssize_t self_size = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (self_size <= 0) {
+        std::perror("pty_pool: readlink");
+        return EXIT_FAILURE;
+    }
+    self[self_size] = '\0';
+    setenv("SHELL", self, 1);
+    setenv(g_child_env, "1", 1);
+
+    ImApp::PseudoTerminalPool pool(g_pool_size, 24, 80);
+    // Taken before the refill thread got anywhere, it still has to wait for
+    // the first shell instead of handing out an unlaunched PTY.
+    auto start = std::chrono::steady_clock::now();
+    auto first = pool.acquire(30, 100);
+    auto waited = std::chrono::steady_clock::now() - start;
+    std::printf("first acquire took %.3f ms\n",
+                std::chrono::duration<double, std::milli>(waited).count());
+    if (!check(first->is_valid(), "first acquire returned no shell") ||
+        !check(wait_until([&]() { return pool.idle_count() == g_pool_size; }),
+               "pool did not refill")) {
+        return EXIT_FAILURE;
+    }
+
+    start = std::chrono::steady_clock::now();
+    auto warm = pool.acquire(24, 80);
+    waited = std::chrono::steady_clock::now() - start;
+    std::printf("warm acquire took %.3f ms\n",
+                std::chrono::duration<double, std::milli>(waited).count());
+    if (!check(warm->is_valid(), "warm acquire returned no shell") ||
+        !check(wait_until([&]() { return pool.idle_count() == g_pool_size; }),
+               "pool did not refill")) {
+        return EXIT_FAILURE;
+    }
+
+    // Two taken and two idle shells die.
+    auto killed = kill_children();
+    if (!check(killed.size() == 2 + g_pool_size, "could not kill shells") ||
+        !check(wait_until([&]() {
+                   return !first->is_valid() && !warm->is_valid();
+               }),
+               "taken shells still look alive") ||
+        !check(wait_until([&]() {
+                   return std::ranges::none_of(killed, [](pid_t pid) {
+                       return access(("/proc/" + std::to_string(pid)).c_str(),
+                                     F_OK) == 0;
+                   });
+               }),
+               "killed shells were not reaped")) {
+        return EXIT_FAILURE;
+    }
+    // Gone from /proc means reaped, give the reaper a moment to flag them.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto replacement = pool.acquire(24, 80);
+    if (!check(replacement->is_valid(), "pool handed out an exited shell") ||
+        !check(wait_until([&]() { return pool.idle_count() == g_pool_size; }),
+               "pool did not replace exited shells")) {
+        return EXIT_FAILURE;
+    }
+    std::puts("pool refilled after its shells exited");
+    return EXIT_SUCCESS;
+}